@@ -0,0 +1,438 @@
+#include "algebra.hpp"
+
+// algebra.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <optional>
+
+typedef struct ChainTerm
+{
+    NodePtr node;
+    // Subtracted from the sum, never set for products
+    bool negated;
+} ChainTerm;
+
+bool is_arithmetic_node(const NodeType type)
+{
+    return type == NODE_ADD || type == NODE_SUB || type == NODE_MUL || type == NODE_DIV || type == NODE_MOD;
+}
+
+bool is_relational_node(const NodeType type)
+{
+    return type == NODE_LT || type == NODE_GT || type == NODE_LE || type == NODE_GE || type == NODE_EQ || type == NODE_DIF;
+}
+
+bool is_expression_node(const NodeType type)
+{
+    return is_arithmetic_node(type) || is_relational_node(type) || type == NODE_AND || type == NODE_OR || type == NODE_NOT
+        || type == NODE_PARENTHESIS;
+}
+
+NodePtr unparenthesized(NodePtr node)
+{
+    while (node->get_node_type() == NODE_PARENTHESIS)
+    {
+        node = node->get_children()[0];
+    }
+    return node;
+}
+
+bool is_literal_leaf(const NodePtr &node, const SymbolType type)
+{
+    if (node->get_node_type() != NODE_SYMBOL)
+    {
+        return false;
+    }
+    const auto symbol = to_symbol_node(node)->get_symbol();
+    return symbol->is_literal() && symbol->type == type;
+}
+
+// Value of an integer literal, or of a real one, which is written as a fraction
+std::optional<double> literal_value(const NodePtr &node)
+{
+    if (is_literal_leaf(node, SYMBOL_INT))
+    {
+        return static_cast<double>(std::stol(to_symbol_node(node)->get_text()));
+    }
+    if (!is_literal_leaf(node, SYMBOL_REAL))
+    {
+        return std::nullopt;
+    }
+    const auto text = to_symbol_node(node)->get_text();
+    const auto slash = text.find('/');
+    const auto divisor = std::stod(text.substr(slash + 1));
+    if (divisor == 0)
+    {
+        return std::nullopt;
+    }
+    return std::stod(text.substr(0, slash)) / divisor;
+}
+
+bool is_literal_of(const NodePtr &node, const double value)
+{
+    const auto literal = literal_value(node);
+    return literal && *literal == value;
+}
+
+// Expressions that may be evaluated in another order: no calls, which may print, and no vector
+// reads when they are checked. The ones that may also be dropped have no divisions, as those trap.
+bool is_reorderable(const NodePtr &node, const OptimizerOptions &options, const bool droppable = false)
+{
+    const auto type = node->get_node_type();
+    if (type == NODE_FUN_CALL || (type == NODE_VEC && options.bounds_check) || (droppable && (type == NODE_DIV || type == NODE_MOD)))
+    {
+        return false;
+    }
+    for (const auto &child : node->get_children())
+    {
+        if (!is_reorderable(child, options, droppable))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_pure_expression(const NodePtr &node, const OptimizerOptions &options)
+{
+    return is_reorderable(node, options, true);
+}
+
+bool same_expression(const NodePtr &a, const NodePtr &b)
+{
+    return a->export_tree() == b->export_tree();
+}
+
+NodePtr make_int_literal(const long value, const LineNumber line)
+{
+    return std::make_shared<SymbolNode>(register_int_literal(value), line);
+}
+
+// Operators inside another one keep their parentheses, so the exported tree reads the same
+NodePtr grouped(const NodePtr &node, const LineNumber line)
+{
+    if (!is_arithmetic_node(node->get_node_type()))
+    {
+        return node;
+    }
+    return std::make_shared<ASTNode>(NODE_PARENTHESIS, line, NodeList{node});
+}
+
+NodePtr make_operation(const NodeType type, const NodePtr &left, const NodePtr &right, const LineNumber line)
+{
+    return std::make_shared<ASTNode>(type, line, NodeList{grouped(left, line), grouped(right, line)});
+}
+
+// The terms joined by the operator as a tree of logarithmic height, instead of a chain in which
+// every operation waits for the one before it
+NodePtr balanced_tree(const std::vector<NodePtr> &terms, const size_t begin, const size_t end, const NodeType type, const LineNumber line)
+{
+    if (end - begin == 1)
+    {
+        return terms[begin];
+    }
+    const auto middle = begin + (end - begin + 1) / 2;
+    return make_operation(type, balanced_tree(terms, begin, middle, type, line), balanced_tree(terms, middle, end, type, line), line);
+}
+
+NodePtr balanced_tree(const std::vector<NodePtr> &terms, const NodeType type, const LineNumber line)
+{
+    return balanced_tree(terms, 0, terms.size(), type, line);
+}
+
+bool is_chain_link(const NodePtr &node, const bool is_product, const DataType type)
+{
+    const auto node_type = node->get_node_type();
+    const auto in_chain = is_product ? node_type == NODE_MUL : node_type == NODE_ADD || node_type == NODE_SUB;
+    return in_chain && node->check_expr_type() == type;
+}
+
+// The child continues the chain of its parent, which is the one rebuilt
+bool continues_chain(const NodePtr &parent, const NodePtr &child)
+{
+    const auto parent_type = parent->get_node_type();
+    if (!is_arithmetic_node(parent_type) || parent_type == NODE_DIV || parent_type == NODE_MOD)
+    {
+        return false;
+    }
+    return is_chain_link(child, parent_type == NODE_MUL, parent->check_expr_type());
+}
+
+// Terms of a chain of additions and subtractions, or of multiplications, that all have the type
+// of the chain. Parentheses end the chain, as the values they group are often reused elsewhere.
+void flatten_chain(const NodePtr &node, const bool is_product, const DataType type, const bool negated, std::vector<ChainTerm> &terms)
+{
+    if (!is_chain_link(node, is_product, type))
+    {
+        terms.push_back({node, negated});
+        return;
+    }
+    const auto &children = node->get_children();
+    flatten_chain(children[0], is_product, type, negated, terms);
+    flatten_chain(children[1], is_product, type, node->get_node_type() == NODE_SUB ? !negated : negated, terms);
+}
+
+// Every term may be reordered and has the type of the chain, so no operation changes its type
+bool can_reorder(const std::vector<ChainTerm> &terms, const DataType type, const OptimizerOptions &options)
+{
+    for (const auto &term : terms)
+    {
+        if (term.node->check_expr_type() != type || !is_reorderable(term.node, options))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A sum with its integer literals added into one, which goes last, and the terms that cancel out
+// removed. The terms added and the ones subtracted are each summed as a balanced tree.
+NodePtr rebuild_sum(const NodePtr &node, const DataType type, const OptimizerOptions &options)
+{
+    const auto line = node->get_line_number();
+    std::vector<ChainTerm> terms;
+    flatten_chain(node, false, type, false, terms);
+    if (!can_reorder(terms, type, options))
+    {
+        return nullptr;
+    }
+
+    // Integers wrap around, so the literals are added as unsigned 32-bit values
+    uint32_t constant = 0;
+    std::vector<ChainTerm> kept;
+    for (const auto &term : terms)
+    {
+        if (type == TYPE_INT && is_literal_leaf(term.node, SYMBOL_INT))
+        {
+            const auto value = static_cast<uint32_t>(std::stol(to_symbol_node(term.node)->get_text()));
+            constant = term.negated ? constant - value : constant + value;
+        }
+        else if (!is_literal_of(term.node, 0))
+        {
+            kept.push_back(term);
+        }
+    }
+
+    std::vector<NodePtr> added;
+    std::vector<NodePtr> subtracted;
+    std::vector<bool> cancelled(kept.size(), false);
+    for (size_t i = 0; i < kept.size(); ++i)
+    {
+        if (!kept[i].negated)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < kept.size(); ++j)
+        {
+            if (!kept[j].negated && !cancelled[j] && is_pure_expression(kept[i].node, options) && same_expression(kept[i].node, kept[j].node))
+            {
+                cancelled[i] = cancelled[j] = true;
+                break;
+            }
+        }
+    }
+    // Real literals were not added up, they still go after the other terms
+    for (const auto literals : {false, true})
+    {
+        for (size_t i = 0; i < kept.size(); ++i)
+        {
+            if (cancelled[i] || literal_value(kept[i].node).has_value() != literals)
+            {
+                continue;
+            }
+            (kept[i].negated ? subtracted : added).push_back(kept[i].node);
+        }
+    }
+
+    const auto value = static_cast<int32_t>(constant);
+    if (value == INT_MIN || (added.empty() && type != TYPE_INT))
+    {
+        return nullptr;
+    }
+    NodePtr result;
+    auto remaining = value;
+    if (added.empty())
+    {
+        result = make_int_literal(std::max(value, 0), line);
+        remaining = std::min(value, 0);
+    }
+    else
+    {
+        result = balanced_tree(added, NODE_ADD, line);
+    }
+    if (!subtracted.empty())
+    {
+        result = make_operation(NODE_SUB, result, balanced_tree(subtracted, NODE_ADD, line), line);
+    }
+    if (remaining != 0)
+    {
+        result = make_operation(remaining > 0 ? NODE_ADD : NODE_SUB, result, make_int_literal(std::abs(remaining), line), line);
+    }
+    return result;
+}
+
+// A product with its integer literals multiplied into one, which goes last, and the factors of one
+// removed. A factor of zero makes the whole product zero.
+NodePtr rebuild_product(const NodePtr &node, const DataType type, const OptimizerOptions &options)
+{
+    const auto line = node->get_line_number();
+    std::vector<ChainTerm> terms;
+    flatten_chain(node, true, type, false, terms);
+    if (!can_reorder(terms, type, options))
+    {
+        return nullptr;
+    }
+
+    uint32_t constant = 1;
+    std::vector<NodePtr> factors;
+    std::vector<NodePtr> literals;
+    for (const auto &term : terms)
+    {
+        if (is_literal_of(term.node, 0))
+        {
+            const auto all_pure = std::all_of(terms.begin(), terms.end(), [&](const ChainTerm &other) { return is_pure_expression(other.node, options); });
+            return all_pure ? term.node : nullptr;
+        }
+        if (type == TYPE_INT && is_literal_leaf(term.node, SYMBOL_INT))
+        {
+            constant *= static_cast<uint32_t>(std::stol(to_symbol_node(term.node)->get_text()));
+        }
+        else if (!is_literal_of(term.node, 1))
+        {
+            (literal_value(term.node) ? literals : factors).push_back(term.node);
+        }
+    }
+    factors.insert(factors.end(), literals.begin(), literals.end());
+
+    const auto value = static_cast<int32_t>(constant);
+    if (value == 0)
+    {
+        const auto all_pure = std::all_of(factors.begin(), factors.end(), [&](const NodePtr &factor) { return is_pure_expression(factor, options); });
+        return all_pure ? make_int_literal(0, line) : nullptr;
+    }
+    if (value < 0 || (factors.empty() && type != TYPE_INT))
+    {
+        return nullptr;
+    }
+    if (factors.empty())
+    {
+        return make_int_literal(value, line);
+    }
+    auto result = balanced_tree(factors, NODE_MUL, line);
+    if (value != 1)
+    {
+        result = make_operation(NODE_MUL, result, make_int_literal(value, line), line);
+    }
+    return result;
+}
+
+// x / 1 is x and x % 1 is zero, and integer literals are divided right away
+NodePtr rebuild_division(const NodePtr &node, const DataType type, const OptimizerOptions &options)
+{
+    const auto &dividend = node->get_children()[0];
+    const auto &divisor = node->get_children()[1];
+    const auto is_mod = node->get_node_type() == NODE_MOD;
+    if (is_literal_of(divisor, 1))
+    {
+        if (!is_mod)
+        {
+            return dividend;
+        }
+        return type == TYPE_INT && is_pure_expression(dividend, options) ? make_int_literal(0, node->get_line_number()) : nullptr;
+    }
+    if (type != TYPE_INT || !is_literal_leaf(dividend, SYMBOL_INT) || !is_literal_leaf(divisor, SYMBOL_INT) || is_literal_of(divisor, 0))
+    {
+        return nullptr;
+    }
+    const auto first = std::stol(to_symbol_node(dividend)->get_text());
+    const auto second = std::stol(to_symbol_node(divisor)->get_text());
+    return make_int_literal(is_mod ? first % second : first / second, node->get_line_number());
+}
+
+// A literal compared with something else goes to the right, with the mirrored comparison
+NodePtr rebuild_comparison(const NodePtr &node)
+{
+    static const std::map<NodeType, NodeType> mirrored = {
+        {NODE_LT, NODE_GT}, {NODE_GT, NODE_LT}, {NODE_LE, NODE_GE}, {NODE_GE, NODE_LE}, {NODE_EQ, NODE_EQ}, {NODE_DIF, NODE_DIF},
+    };
+    const auto &left = node->get_children()[0];
+    const auto &right = node->get_children()[1];
+    const auto is_literal = [](const NodePtr &operand) {
+        return operand->get_node_type() == NODE_SYMBOL && to_symbol_node(operand)->get_symbol()->is_literal();
+    };
+    if (!is_literal(left) || is_literal(right))
+    {
+        return nullptr;
+    }
+    return std::make_shared<ASTNode>(mirrored.at(node->get_node_type()), node->get_line_number(), NodeList{right, left});
+}
+
+NodePtr rewrite_expression(const NodePtr &node, const OptimizerOptions &options)
+{
+    const auto node_type = node->get_node_type();
+    if (node_type == NODE_PARENTHESIS)
+    {
+        // Parentheses only matter around operators
+        const auto &inner = node->get_children()[0];
+        const auto inner_type = inner->get_node_type();
+        const auto is_operator = is_arithmetic_node(inner_type) || is_relational_node(inner_type) || inner_type == NODE_AND || inner_type == NODE_OR;
+        return is_operator ? nullptr : inner;
+    }
+    if (node_type == NODE_NOT)
+    {
+        const auto inner = unparenthesized(node->get_children()[0]);
+        return inner->get_node_type() == NODE_NOT ? inner->get_children()[0] : nullptr;
+    }
+    if (is_relational_node(node_type))
+    {
+        const auto operand_type = node->get_children()[0]->check_expr_type();
+        return operand_type != TYPE_REAL || options.fast_math ? rebuild_comparison(node) : nullptr;
+    }
+
+    const auto type = node->check_expr_type();
+    if (!is_arithmetic_node(node_type) || !(type == TYPE_INT || (type == TYPE_REAL && options.fast_math)))
+    {
+        return nullptr;
+    }
+    switch (node_type)
+    {
+    case NODE_ADD:
+    case NODE_SUB:
+        return rebuild_sum(node, type, options);
+    case NODE_MUL:
+        return rebuild_product(node, type, options);
+    default:
+        return rebuild_division(node, type, options);
+    }
+}
+
+void simplify_subexpressions(const NodePtr &node, const OptimizerOptions &options);
+
+// Links in the middle of a chain are only simplified below them, the whole chain is rebuilt at once
+NodePtr simplify_expression(const NodePtr &node, const OptimizerOptions &options, const bool chained = false)
+{
+    simplify_subexpressions(node, options);
+    if (!is_expression_node(node->get_node_type()) || chained)
+    {
+        return node;
+    }
+    const auto rewritten = rewrite_expression(node, options);
+    // Every rewrite keeps the type the semantic analysis gave to the expression
+    return rewritten && rewritten->check_expr_type() == node->check_expr_type() ? rewritten : node;
+}
+
+void simplify_subexpressions(const NodePtr &node, const OptimizerOptions &options)
+{
+    const auto children = node->get_children();
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        node->replace_child(i, simplify_expression(children[i], options, continues_chain(node, children[i])));
+    }
+}
+
+void simplify_expressions(const NodePtr &ast, const OptimizerOptions &options)
+{
+    simplify_subexpressions(ast, options);
+}
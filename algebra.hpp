@@ -0,0 +1,12 @@
+#pragma once
+
+// algebra.hpp file made by Ian Kersz Amaral - 2025/1
+// Algebraic simplification of the expressions of the AST, before the TAC is generated. Removes
+// identities like x * 1, x - x and ~~b, moves literals to the right, folds the literals of sums
+// and products into one and rebuilds long chains as balanced trees, so their operations do not
+// wait on each other. Reals are only rewritten with fast math, as they are not associative.
+
+#include "ast.hpp"
+#include "optimizer.hpp"
+
+void simplify_expressions(const NodePtr &ast, const OptimizerOptions &options);
@@ -1,54 +1,62 @@
 #include "asm.hpp"
 // asm.cpp file made by Ian Kersz Amaral - 2025/1
 
+#include "peephole.hpp"
+#include "regalloc.hpp"
+#include "isel.hpp"
+#include "layout.hpp"
+
 #include <sstream>
+#include <algorithm>
 #include <iomanip>
 #include <cstring>
 #include <string_view>
+#include <map>
+#include <set>
+#include <climits>
+
+std::string variables_asm(const TACList tac_list, const DataLayout &layout);
 
-std::string variables_asm(const TACList tac_list);
+std::string functions_asm(const TACList tac_list, const OptimizerOptions &options, std::set<SymbolTableEntry> &in_memory);
 
-std::string functions_asm(const TACList tac_list);
+std::string literals_asm(const SymbolTable &symbol_table, const std::string &functions_text);
 
-std::string literals_asm(const SymbolTable &symbol_table);
+std::string temporaries_asm(const DataLayout &layout);
 
-std::string temporaries_asm(const SymbolTable &symbol_table);
+std::vector<SymbolTableEntry> memory_temporaries(const SymbolTable &symbol_table, const std::set<SymbolTableEntry> &in_memory);
 
-std::string generate_asm(const TACList tac_list, const SymbolTable &symbol_table)
+std::string generate_asm(const TACList tac_list, const SymbolTable &symbol_table, const OptimizerOptions &options)
 {
     std::stringstream asm_stream;
     
     asm_stream << "\n\n## Functions\n";
-    asm_stream << functions_asm(tac_list);
+    std::set<SymbolTableEntry> in_memory;
+    auto functions_text = functions_asm(tac_list, options, in_memory);
+    if (options.level >= 1)
+    {
+        auto instructions = parse_instructions(functions_text);
+        peephole_optimize(instructions);
+        functions_text = instructions_to_string(instructions);
+    }
+    asm_stream << functions_text;
+
+    const auto layout = layout_data(tac_list, memory_temporaries(symbol_table, in_memory));
     
     asm_stream << "\n\n## Variables\n";
-    asm_stream << variables_asm(tac_list);
+    asm_stream << variables_asm(tac_list, layout);
 
     asm_stream << "\n\n## Temporary Variables\n";
-    asm_stream << temporaries_asm(symbol_table);
+    asm_stream << temporaries_asm(layout);
+
+    asm_stream << "\n\n## Data Layout\n";
+    asm_stream << layout_report(layout);
 
     asm_stream << "\n\n## Literals\n";
-    asm_stream << literals_asm(symbol_table);
+    asm_stream << literals_asm(symbol_table, functions_text);
 
     return asm_stream.str();
 }
 
-int get_data_type_size(const DataType data_type)
-{
-    switch (data_type)
-    {
-    case DataType::TYPE_INT:
-        return 4; // 4 bytes for int
-    case DataType::TYPE_CHAR:
-    case DataType::TYPE_BOOL:
-        return 1; // 1 byte for char
-    case DataType::TYPE_REAL:
-        return 4; // 4 bytes for real (float)
-    default:
-        throw std::runtime_error("Unsupported data type size requested.");
-    }
-}
-
 std::string get_storage_type(const DataType data_type)
 {
     switch (data_type)
@@ -60,6 +68,8 @@ std::string get_storage_type(const DataType data_type)
         return ".byte";
     case DataType::TYPE_REAL:
         return ".long";
+    case DataType::TYPE_POINTER:
+        return ".quad";
     default:
         throw std::runtime_error("Unsupported data type for storage type.");
     }
@@ -121,14 +131,51 @@ std::string value_representation(const std::string &value, const DataType data_t
     }
 }
 
-std::string variables_asm(const TACList tac_list)
+// Declarations of the globals in the order of the layout, each one from its VARBEGIN or VECBEGIN to its end
+TACList ordered_declarations(const TACList &tac_list, const DataLayout &layout)
+{
+    std::map<SymbolTableEntry, TACList> declarations;
+    TACList current;
+    for (const auto &tac : tac_list)
+    {
+        const auto type = tac->get_type();
+        if (type == TacType::TAC_BEGINCODE)
+        {
+            break;
+        }
+        if (type == TacType::TAC_VARBEGIN || type == TacType::TAC_VECBEGIN)
+        {
+            current = {tac};
+        }
+        else if (!current.empty())
+        {
+            current.push_back(tac);
+            if (type == TacType::TAC_VAREND || type == TacType::TAC_VECEND)
+            {
+                declarations[tac->get_result()] = current;
+                current.clear();
+            }
+        }
+    }
+
+    TACList ordered;
+    for (const auto &item : layout.globals)
+    {
+        const auto &declaration = declarations.at(item.symbol);
+        ordered.insert(ordered.end(), declaration.begin(), declaration.end());
+    }
+    return ordered;
+}
+
+std::string variables_asm(const TACList tac_list, const DataLayout &layout)
 {
     std::stringstream asm_stream;
     asm_stream << "    .data\n";
+    asm_stream << "    .p2align 6\n";
 
     DataType current_data_type = DataType::TYPE_INVALID;
 
-    for (const auto &tac : tac_list)
+    for (const auto &tac : ordered_declarations(tac_list, layout))
     {
         switch (tac->get_type())
         {
@@ -142,7 +189,7 @@ std::string variables_asm(const TACList tac_list)
 
                 if (tac->get_type() == TAC_VECBEGIN)
                 {
-                    // Vectors are aligned to 4 bytes
+                    // Vectors are aligned to 16 bytes
                     asm_stream << "    .p2align 4\n";
                 }
                 else
@@ -153,7 +200,6 @@ std::string variables_asm(const TACList tac_list)
                         asm_stream << "    .p2align 2\n";
                         break;
                     case DataType::TYPE_CHAR:
-                        break;
                     case DataType::TYPE_REAL:
                         asm_stream << "    .p2align 2\n";
                         break;
@@ -185,7 +231,12 @@ std::string variables_asm(const TACList tac_list)
                 const auto var_name = var->get_text();
 
                 const auto size = !is_vector ? 1 : std::stoi(tac->get_first_operator()->get_text());
-                const auto size_in_bytes = get_data_type_size(current_data_type) * size;
+                auto size_in_bytes = get_data_type_size(current_data_type) * size;
+                if (!is_vector && size_in_bytes < static_cast<int>(SCALAR_SIZE))
+                {
+                    asm_stream << "    .zero " << static_cast<int>(SCALAR_SIZE) - size_in_bytes << "\n";
+                    size_in_bytes = static_cast<int>(SCALAR_SIZE);
+                }
 
                 asm_stream << "    .size " << var_name << ", " << size_in_bytes << "\n";
                 current_data_type = DataType::TYPE_INVALID; // Reset current data type
@@ -229,6 +280,11 @@ std::string get_printf_label(const DataType data_type, const SymbolTableEntry sy
 
 std::string get_label_or_text(const SymbolTableEntry &symbol)
 {
+    if (symbol->ident_type == IdentType::IDENT_LIT && symbol->type == SymbolType::SYMBOL_REAL)
+    {
+        // Reals are named by their bits, so every literal with the same value shares one constant
+        return ".L.real." + value_representation(symbol->get_text(), DataType::TYPE_REAL).substr(2);
+    }
     if (symbol->ident_type == IdentType::IDENT_LIT)
     {
         const auto text_label = std::hash<std::string>()(symbol->get_text());
@@ -240,6 +296,338 @@ std::string get_label_or_text(const SymbolTableEntry &symbol)
     }
 }
 
+// Address of a slot of the frame, below rbp for spills and above it for stack arguments
+std::string frame_address(const long displacement)
+{
+    if (displacement < 0)
+    {
+        return "[rbp - " + std::to_string(-displacement) + "]";
+    }
+    return "[rbp + " + std::to_string(displacement) + "]";
+}
+
+std::string width_of(const unsigned size)
+{
+    switch (size)
+    {
+    case 1: return "byte";
+    case 4: return "dword";
+    case 8: return "qword";
+    default: throw std::runtime_error("Unsupported operand size.");
+    }
+}
+
+// Integer and character literals are encoded in the instructions that read them
+bool is_immediate(const SymbolTableEntry &symbol)
+{
+    return symbol->is_literal() && (symbol->type == SymbolType::SYMBOL_INT || symbol->type == SymbolType::SYMBOL_CHAR);
+}
+
+std::string immediate_of(const SymbolTableEntry &symbol)
+{
+    if (symbol->type == SymbolType::SYMBOL_CHAR)
+    {
+        // The text keeps the quotes, and '' is the null character
+        const auto text = symbol->get_text();
+        return std::to_string(text.size() > 2 ? static_cast<unsigned char>(text[1]) : 0);
+    }
+    return symbol->get_text();
+}
+
+// 0.0 is made with xorps, so it never goes to the constant pool
+bool is_zero_real(const SymbolTableEntry &symbol)
+{
+    return symbol->is_literal() && symbol->type == SymbolType::SYMBOL_REAL && value_representation(symbol->get_text(), DataType::TYPE_REAL) == int_to_hex(uint32_t{0});
+}
+
+// Where the symbol is kept, accessed with the given size in bytes: the register the allocator
+// gave it, its stack slot, or its label. Integer and character literals are immediates.
+std::string operand_of(const SymbolTableEntry &symbol, const unsigned size, const RegisterAllocation &allocation)
+{
+    if (is_immediate(symbol))
+    {
+        return immediate_of(symbol);
+    }
+    const auto reg = allocation.registers.find(symbol);
+    if (reg != allocation.registers.end())
+    {
+        return reg->second.rfind("xmm", 0) == 0 ? reg->second : register_with_size(reg->second, size);
+    }
+
+    const auto slot = allocation.stack_slots.find(symbol);
+    if (slot != allocation.stack_slots.end())
+    {
+        return width_of(size) + " ptr " + frame_address(slot->second);
+    }
+    return width_of(size) + " ptr [rip + " + get_label_or_text(symbol) + "]";
+}
+
+// Loads the value to the register with the given instruction, like movzx or movss. Immediates
+// need no extension, and 0.0 is made with xorps instead of read from memory.
+std::string load_asm(const std::string &instruction, const std::string &destination, const SymbolTableEntry &symbol, const unsigned size,
+                     const RegisterAllocation &allocation)
+{
+    if (is_immediate(symbol))
+    {
+        return "    mov " + destination + ", " + immediate_of(symbol) + "\n";
+    }
+    if (is_zero_real(symbol) && destination.rfind("xmm", 0) == 0)
+    {
+        return "    xorps " + destination + ", " + destination + "\n";
+    }
+    return "    " + instruction + " " + destination + ", " + operand_of(symbol, size, allocation) + "\n";
+}
+
+// Code that readies a real for the second operand of a scalar SSE instruction, with the operand.
+// 0.0 is made in xmm1.
+std::pair<std::string, std::string> real_operand(const SymbolTableEntry &symbol, const RegisterAllocation &allocation)
+{
+    if (is_zero_real(symbol))
+    {
+        return {"    xorps xmm1, xmm1\n", "xmm1"};
+    }
+    return {"", operand_of(symbol, 4, allocation)};
+}
+
+// Whether the allocator kept the symbol in an xmm register
+bool in_xmm_register(const SymbolTableEntry &symbol, const RegisterAllocation &allocation)
+{
+    const auto reg = allocation.registers.find(symbol);
+    return reg != allocation.registers.end() && reg->second.rfind("xmm", 0) == 0;
+}
+
+// Register the allocator gave to a pointer, empty when the pointer is kept in memory
+std::string pointer_register(const SymbolTableEntry &symbol, const RegisterAllocation &allocation)
+{
+    const auto reg = allocation.registers.find(symbol);
+    return reg == allocation.registers.end() ? "" : register_with_size(reg->second, 8);
+}
+
+// Whether the symbol is kept in a register or a stack slot, where bytes are zero extended to 32
+// bits because the instructions that read them use the width of their own operation
+bool in_frame_or_register(const SymbolTableEntry &symbol, const RegisterAllocation &allocation)
+{
+    return allocation.registers.count(symbol) != 0 || allocation.stack_slots.count(symbol) != 0;
+}
+
+// Stores the byte in al to the result, zero extended when it is kept in a register or a stack slot
+std::string store_byte_asm(const SymbolTableEntry &result, const RegisterAllocation &allocation)
+{
+    if (!in_frame_or_register(result, allocation))
+    {
+        return "    mov " + operand_of(result, 1, allocation) + ", al\n";
+    }
+    if (allocation.registers.count(result) != 0)
+    {
+        return "    movzx " + operand_of(result, 4, allocation) + ", al\n";
+    }
+    return "    movzx eax, al\n    mov " + operand_of(result, 4, allocation) + ", eax\n";
+}
+
+// One of a set of moves that happen at once, like the arguments of a call going to their registers
+typedef struct ParallelMove
+{
+    std::string instruction;
+    std::string destination;
+    std::string source;
+    // Full names of the registers, empty for memory and literals
+    std::string destination_register;
+    std::string source_register;
+    // Bytes written to the destination
+    unsigned size;
+} ParallelMove;
+
+ParallelMove make_move(const std::string &destination, const std::string &destination_register, const std::string &source,
+                       const std::string &source_register, const DataType data_type, const bool zero_extend)
+{
+    const auto to_xmm = destination_register.rfind("xmm", 0) == 0;
+    const auto from_xmm = source_register.rfind("xmm", 0) == 0;
+    std::string instruction = "mov";
+    if (zero_extend)
+    {
+        instruction = "movzx";
+    }
+    else if (data_type == DataType::TYPE_REAL && (to_xmm || from_xmm))
+    {
+        // Reals between an xmm and a general purpose register go through movd
+        const auto both_registers = !destination_register.empty() && !source_register.empty();
+        instruction = both_registers && to_xmm != from_xmm ? "movd" : "movss";
+    }
+    const auto size = zero_extend ? 4 : static_cast<unsigned>(get_data_type_size(data_type));
+    return {instruction, destination, source, destination_register, source_register, size};
+}
+
+// Orders the moves so none writes a register another one still has to read. When every one of
+// them does, the source of the first is kept in a register none of them uses.
+std::string parallel_moves_asm(std::vector<ParallelMove> moves)
+{
+    std::stringstream asm_stream;
+    // xorps of a register with itself clears it, it is not a move to itself
+    moves.erase(std::remove_if(moves.begin(), moves.end(), [](const ParallelMove &move) {
+        return move.destination == move.source && !move.source_register.empty();
+    }), moves.end());
+    while (!moves.empty())
+    {
+        const auto ready = std::find_if(moves.begin(), moves.end(), [&](const ParallelMove &move) {
+            return move.destination_register.empty() || std::none_of(moves.begin(), moves.end(), [&](const ParallelMove &other) {
+                return &other != &move && other.source_register == move.destination_register;
+            });
+        });
+        if (ready != moves.end())
+        {
+            asm_stream << "    " << ready->instruction << " " << ready->destination << ", " << ready->source << "\n";
+            moves.erase(ready);
+            continue;
+        }
+
+        // Nothing is ready only around a cycle, whose moves all read a register
+        auto &move = *std::find_if(moves.begin(), moves.end(), [](const ParallelMove &other) {
+            return !other.source_register.empty();
+        });
+        const auto is_xmm = move.destination_register.rfind("xmm", 0) == 0;
+        std::string scratch = "rax";
+        for (int i = 0; is_xmm && i < 16; ++i)
+        {
+            scratch = "xmm" + std::to_string(i);
+            const auto taken = std::any_of(moves.begin(), moves.end(), [&](const ParallelMove &other) {
+                return other.source_register == scratch || other.destination_register == scratch;
+            });
+            if (!taken)
+            {
+                break;
+            }
+        }
+        const auto sized = is_xmm ? scratch : register_with_size(scratch, move.size);
+        asm_stream << "    " << move.instruction << " " << sized << ", " << move.source << "\n";
+        move.instruction = is_xmm ? "movaps" : "mov";
+        move.source = sized;
+        move.source_register = scratch;
+    }
+    return asm_stream.str();
+}
+
+// Moves the value of the ARG to the register that passes it, from its slot if it was saved there
+ParallelMove argument_move(const TACptr &argument, const std::string &destination_register, const RegisterAllocation &allocation)
+{
+    // Bytes are passed zero extended to 32 bits, like they are kept in the callee
+    const auto declared_type = argument->get_result()->get_data_type();
+    const auto byte_parameter = declared_type == DataType::TYPE_CHAR || declared_type == DataType::TYPE_BOOL;
+    const auto parameter_type = byte_parameter ? DataType::TYPE_INT : declared_type;
+    const auto size = static_cast<unsigned>(get_data_type_size(parameter_type));
+    const auto destination = destination_register.rfind("xmm", 0) == 0 ? destination_register : register_with_size(destination_register, size);
+    const auto slot = allocation.argument_slots.find(argument);
+    if (slot != allocation.argument_slots.end())
+    {
+        return make_move(destination, destination_register, width_of(size) + " ptr " + frame_address(slot->second), "", parameter_type, false);
+    }
+
+    const auto value = argument->get_first_operator();
+    const auto value_type = value->get_data_type();
+    if (is_zero_real(value) && destination_register.rfind("xmm", 0) == 0)
+    {
+        return {"xorps", destination, destination, destination_register, "", 4};
+    }
+    if (value->is_literal() && parameter_type == DataType::TYPE_REAL && destination_register.rfind("xmm", 0) != 0)
+    {
+        // Reals passed on the stack are moved as their bits
+        return make_move(destination, destination_register, value_representation(value->get_text(), DataType::TYPE_REAL), "", DataType::TYPE_INT, false);
+    }
+    // Bytes, and values passed to a byte parameter, are zero extended like every other load of a byte. Immediates need no extension
+    const auto value_is_byte = value_type == DataType::TYPE_CHAR || value_type == DataType::TYPE_BOOL;
+    const auto zero_extend = parameter_type == DataType::TYPE_INT && (value_is_byte || byte_parameter) && !is_immediate(value);
+    const auto found = allocation.registers.find(value);
+    const auto source_register = found != allocation.registers.end() ? found->second : "";
+    const auto destination_text = zero_extend ? register_with_size(destination_register, 4) : destination;
+    return make_move(destination_text, destination_register, operand_of(value, zero_extend ? 1 : size, allocation), source_register, parameter_type, zero_extend);
+}
+
+// Passes the arguments of the call and calls it: the ones that do not fit in registers are
+// pushed in reverse order, with padding that keeps the stack aligned to 16 bytes
+std::string call_asm(const TACptr &call, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    const auto parameters = function_parameters(call->get_first_operator());
+    const auto registers = argument_registers(parameters);
+    const auto &arguments = allocation.call_arguments.at(call);
+
+    std::vector<size_t> on_stack;
+    std::vector<ParallelMove> moves;
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        if (registers[i].empty())
+        {
+            on_stack.push_back(i);
+        }
+        else if (arguments[i])
+        {
+            moves.push_back(argument_move(arguments[i], registers[i], allocation));
+        }
+    }
+
+    const auto padding = on_stack.size() % 2;
+    if (padding)
+    {
+        asm_stream << "    sub rsp, 8\n";
+    }
+    for (auto it = on_stack.rbegin(); it != on_stack.rend(); ++it)
+    {
+        if (!arguments[*it])
+        {
+            asm_stream << "    sub rsp, 8\n";
+            continue;
+        }
+        const auto move = argument_move(arguments[*it], "rax", allocation);
+        asm_stream << "    " << move.instruction << " " << move.destination << ", " << move.source << "\n";
+        asm_stream << "    push rax\n";
+    }
+    asm_stream << parallel_moves_asm(moves);
+    asm_stream << "    call " << call->get_first_operator()->get_text() << "\n";
+    if (!on_stack.empty())
+    {
+        asm_stream << "    add rsp, " << (on_stack.size() + padding) * 8 << "\n";
+    }
+    return asm_stream.str();
+}
+
+// Sets up the frame and moves each parameter from the register that passed it to where it is kept
+std::string prologue_asm(const SymbolTableEntry &function, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    asm_stream << "    push rbp\n";
+    asm_stream << "    mov rbp, rsp\n";
+    if (allocation.frame_size > 0)
+    {
+        asm_stream << "    sub rsp, " << allocation.frame_size << "\n";
+    }
+    for (const auto &[name, offset] : allocation.saved_registers)
+    {
+        asm_stream << "    mov qword ptr " << frame_address(offset) << ", " << name << "\n";
+    }
+
+    const auto parameters = function_parameters(function);
+    const auto registers = argument_registers(parameters);
+    std::vector<ParallelMove> moves;
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        const auto &parameter = parameters[i];
+        const auto found = allocation.registers.find(parameter);
+        // Parameters the function never reads have nowhere to go
+        if (registers[i].empty() || (found == allocation.registers.end() && !allocation.stack_slots.count(parameter)))
+        {
+            continue;
+        }
+        // Bytes come zero extended to 32 bits, and are kept that way
+        const auto declared_type = parameter->get_data_type();
+        const auto data_type = declared_type == DataType::TYPE_CHAR || declared_type == DataType::TYPE_BOOL ? DataType::TYPE_INT : declared_type;
+        const auto size = static_cast<unsigned>(get_data_type_size(data_type));
+        const auto source = data_type == DataType::TYPE_REAL ? registers[i] : register_with_size(registers[i], size);
+        const auto home = found != allocation.registers.end() ? found->second : "";
+        moves.push_back(make_move(operand_of(parameter, size, allocation), home, source, registers[i], data_type, false));
+    }
+    asm_stream << parallel_moves_asm(moves);
+    return asm_stream.str();
+}
+
 std::string math_operation_on_datatype(const TacType operation, const DataType data_type)
 {
     switch (data_type)
@@ -290,7 +678,9 @@ std::string cmp_operation_on_datatype(const TacType operation, const DataType da
         default: throw std::runtime_error("Unsupported integer comparison operation.");
         }
         break;
+    case DataType::TYPE_POINTER:
     case DataType::TYPE_REAL:
+        // Addresses are unsigned, and ucomiss sets the flags like an unsigned comparison
         switch (operation)
         {
         case TacType::TAC_LT: return "setb"; // Below
@@ -307,37 +697,832 @@ std::string cmp_operation_on_datatype(const TacType operation, const DataType da
     }
 }
 
-std::string functions_asm(const TACList tac_list)
+// Conditional jumps taken when the comparison is false, used when it is fused with the IFZ
+std::string false_jump_on_datatype(const TacType operation, const DataType data_type)
 {
-    std::stringstream asm_stream;
-    asm_stream << "    .text\n";
-    asm_stream << "    .p2align 4\n";
+    switch (data_type)
+    {
+    case DataType::TYPE_INT:
+    case DataType::TYPE_CHAR:
+        switch (operation)
+        {
+        case TacType::TAC_LT: return "jge";
+        case TacType::TAC_GT: return "jle";
+        case TacType::TAC_LE: return "jg";
+        case TacType::TAC_GE: return "jl";
+        case TacType::TAC_EQ: return "jne";
+        case TacType::TAC_DIF: return "je";
+        default: throw std::runtime_error("Unsupported integer comparison operation.");
+        }
+        break;
+    case DataType::TYPE_POINTER:
+    case DataType::TYPE_REAL:
+        // Addresses are unsigned, and ucomiss sets the flags like an unsigned comparison
+        switch (operation)
+        {
+        case TacType::TAC_LT: return "jae";
+        case TacType::TAC_GT: return "jbe";
+        case TacType::TAC_LE: return "ja";
+        case TacType::TAC_GE: return "jb";
+        case TacType::TAC_EQ: return "jne";
+        case TacType::TAC_DIF: return "je";
+        default: throw std::runtime_error("Unsupported real comparison operation.");
+        }
+        break;
+    default:
+        throw std::runtime_error("Unsupported data type for comparison operation.");
+    }
+}
+
+// IFZs right after the comparison that computes their condition, when nothing else reads it
+std::set<TACptr> find_fused_branches(const TACList &tac_list)
+{
+    std::map<SymbolTableEntry, size_t> uses;
+    for (const auto &tac : tac_list)
+    {
+        for (const auto &used : tac->get_uses())
+        {
+            uses[used]++;
+        }
+    }
+
+    std::set<TACptr> fused_branches;
+    for (size_t i = 0; i + 1 < tac_list.size(); ++i)
+    {
+        const auto &compare = tac_list[i];
+        const auto &branch = tac_list[i + 1];
+        const auto condition = compare->get_result();
+        if (!compare->is_relational() || branch->get_type() != TacType::TAC_IFZ || branch->get_first_operator() != condition)
+        {
+            continue;
+        }
+        if (condition->is_temporary() && uses[condition] == 1)
+        {
+            fused_branches.insert(branch);
+        }
+    }
+    return fused_branches;
+}
 
+// Labels reached by a jump placed after them, which start a loop
+std::set<SymbolTableEntry> find_loop_headers(const TACList &tac_list)
+{
+    std::set<SymbolTableEntry> defined;
+    std::set<SymbolTableEntry> headers;
     for (const auto &tac : tac_list)
     {
-        switch (tac->get_type())
+        const auto type = tac->get_type();
+        if (type == TacType::TAC_LABEL)
         {
-        case TacType::TAC_BEGINFUN:
-            {
-                const auto func_name = tac->get_result()->get_text();
-                asm_stream << "    .globl " << func_name << "\n";
-                asm_stream << func_name << ":\n";
-                if (func_name == "_main")
-                {
-                    asm_stream << "    .global main\n";
-                    asm_stream << "main:\n";
-                }
+            defined.insert(tac->get_result());
+        }
+        else if ((type == TacType::TAC_JUMP || type == TacType::TAC_IFZ) && defined.count(tac->get_result()))
+        {
+            headers.insert(tac->get_result());
+        }
+    }
+    return headers;
+}
 
-                asm_stream << "    .cfi_startproc\n";
-                asm_stream << "    push rbp\n";
-                break;
+// Moves between memory and the registers holding packed values, which may not be aligned
+std::string packed_move_on_datatype(const DataType data_type, const bool avx2)
+{
+    const std::string move = data_type == DataType::TYPE_PACKED_REAL ? "movups" : "movdqu";
+    return avx2 ? "v" + move : move;
+}
+
+std::string packed_operation_on_datatype(const TacType operation, const DataType data_type)
+{
+    switch (data_type)
+    {
+    case DataType::TYPE_PACKED_INT:
+        switch (operation)
+        {
+        case TacType::TAC_ADD: return "paddd";
+        case TacType::TAC_SUB: return "psubd";
+        case TacType::TAC_MUL: return "pmulld";
+        case TacType::TAC_MIN: return "pminsd";
+        case TacType::TAC_MAX: return "pmaxsd";
+        default: throw std::runtime_error("Unsupported packed integer operation.");
+        }
+    case DataType::TYPE_PACKED_CHAR:
+        switch (operation)
+        {
+        case TacType::TAC_ADD: return "paddb";
+        case TacType::TAC_SUB: return "psubb";
+        default: throw std::runtime_error("Unsupported packed character operation.");
+        }
+    case DataType::TYPE_PACKED_REAL:
+        switch (operation)
+        {
+        case TacType::TAC_ADD: return "addps";
+        case TacType::TAC_SUB: return "subps";
+        case TacType::TAC_MUL: return "mulps";
+        case TacType::TAC_DIV: return "divps";
+        case TacType::TAC_MIN: return "minps";
+        case TacType::TAC_MAX: return "maxps";
+        default: throw std::runtime_error("Unsupported packed real operation.");
+        }
+    default:
+        throw std::runtime_error("Unsupported data type for packed operation.");
+    }
+}
+
+// Loads, stores, broadcasts and arithmetic on the packed values made by the vectorizer.
+// SSE2 uses the 16 byte xmm registers, AVX2 the 32 byte ymm ones.
+std::string packed_asm(const TACptr &tac, const bool avx2, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    const auto reg = avx2 ? "ymm" : "xmm";
+    const auto width = avx2 ? "ymmword" : "xmmword";
+    const auto type = tac->get_type();
+
+    if (type == TacType::TAC_PACKED_LOAD || type == TacType::TAC_PACKED_STORE)
+    {
+        const auto is_load = type == TacType::TAC_PACKED_LOAD;
+        const auto vec_var = is_load ? tac->get_first_operator() : tac->get_result();
+        const auto packed_var = is_load ? tac->get_result() : tac->get_first_operator();
+        const auto packed_text = get_label_or_text(packed_var);
+        const auto move = packed_move_on_datatype(packed_var->get_data_type(), avx2);
+
+        asm_stream << load_asm("movsxd", "rcx", tac->get_second_operator(), 4, allocation);
+        asm_stream << "    lea rax, [rip + " << get_label_or_text(vec_var) << "]\n";
+        const auto element = "[rax + rcx * " + std::to_string(get_data_type_size(vec_var->get_data_type())) + "]";
+        if (is_load)
+        {
+            asm_stream << "    " << move << " " << reg << "0, " << width << " ptr " << element << "\n";
+            asm_stream << "    " << move << " " << width << " ptr [rip + " << packed_text << "], " << reg << "0\n";
+        }
+        else
+        {
+            asm_stream << "    " << move << " " << reg << "0, " << width << " ptr [rip + " << packed_text << "]\n";
+            asm_stream << "    " << move << " " << width << " ptr " << element << ", " << reg << "0\n";
+        }
+    }
+    else if (type == TacType::TAC_BROADCAST)
+    {
+        const auto result_var = tac->get_result();
+        const auto value = tac->get_first_operator();
+        // Immediates are broadcast from a register, like the values the allocator kept in one
+        const auto in_register = allocation.registers.count(value) != 0 || is_immediate(value);
+        const auto source = is_immediate(value) ? "eax" : operand_of(value, 4, allocation);
+        switch (result_var->get_data_type())
+        {
+        case DataType::TYPE_PACKED_INT:
+            if (is_immediate(value))
+            {
+                asm_stream << "    mov eax, " << immediate_of(value) << "\n";
+            }
+            if (avx2 && in_register)
+            {
+                // vpbroadcastd only reads memory or an xmm register
+                asm_stream << "    vmovd xmm0, " << source << "\n";
+                asm_stream << "    vpbroadcastd ymm0, xmm0\n";
+                break;
+            }
+            if (avx2)
+            {
+                asm_stream << "    vpbroadcastd ymm0, " << source << "\n";
+                break;
+            }
+            asm_stream << "    movd xmm0, " << source << "\n";
+            asm_stream << "    pshufd xmm0, xmm0, 0\n";
+            break;
+        case DataType::TYPE_PACKED_CHAR:
+            if (avx2 && in_register)
+            {
+                asm_stream << load_asm("movzx", "eax", value, 1, allocation);
+                asm_stream << "    vmovd xmm0, eax\n";
+                asm_stream << "    vpbroadcastb ymm0, xmm0\n";
+                break;
+            }
+            if (avx2)
+            {
+                asm_stream << "    vpbroadcastb ymm0, " << operand_of(value, 1, allocation) << "\n";
+                break;
+            }
+            // Multiplying by 0x01010101 copies the byte to the four bytes of the dword
+            asm_stream << load_asm("movzx", "eax", value, 1, allocation);
+            asm_stream << "    imul eax, eax, 16843009\n";
+            asm_stream << "    movd xmm0, eax\n";
+            asm_stream << "    pshufd xmm0, xmm0, 0\n";
+            break;
+        case DataType::TYPE_PACKED_REAL:
+            if (avx2 && is_zero_real(value))
+            {
+                asm_stream << "    vxorps ymm0, ymm0, ymm0\n";
+                break;
+            }
+            if (avx2)
+            {
+                asm_stream << "    vbroadcastss ymm0, " << source << "\n";
+                break;
+            }
+            asm_stream << load_asm("movss", "xmm0", value, 4, allocation);
+            asm_stream << "    shufps xmm0, xmm0, 0\n";
+            break;
+        default:
+            throw std::runtime_error("Unsupported data type for broadcast operation.");
+        }
+        const auto move = packed_move_on_datatype(result_var->get_data_type(), avx2);
+        asm_stream << "    " << move << " " << width << " ptr [rip + " << get_label_or_text(result_var) << "], " << reg << "0\n";
+    }
+    else if (tac->is_relational())
+    {
+        const auto operand_type = tac->get_first_operator()->get_data_type();
+        auto first_text = get_label_or_text(tac->get_first_operator());
+        auto second_text = get_label_or_text(tac->get_second_operator());
+        std::string compare;
+        std::string predicate;
+        bool negate = false;
+        if (operand_type == DataType::TYPE_PACKED_REAL)
+        {
+            // The predicates of cmpps are only equal, less, less or equal and not equal
+            compare = "cmpps";
+            if (type == TacType::TAC_GT || type == TacType::TAC_GE)
+            {
+                std::swap(first_text, second_text);
+            }
+            switch (type)
+            {
+            case TacType::TAC_EQ: predicate = ", 0"; break;
+            case TacType::TAC_LT:
+            case TacType::TAC_GT: predicate = ", 1"; break;
+            case TacType::TAC_LE:
+            case TacType::TAC_GE: predicate = ", 2"; break;
+            default: predicate = ", 4"; break;
+            }
+        }
+        else
+        {
+            // pcmpgtd and pcmpeqd are the only integer comparisons, the others swap or invert them
+            switch (type)
+            {
+            case TacType::TAC_GT: compare = "pcmpgtd"; break;
+            case TacType::TAC_LT: std::swap(first_text, second_text); compare = "pcmpgtd"; break;
+            case TacType::TAC_LE: compare = "pcmpgtd"; negate = true; break;
+            case TacType::TAC_GE: std::swap(first_text, second_text); compare = "pcmpgtd"; negate = true; break;
+            case TacType::TAC_EQ: compare = "pcmpeqd"; break;
+            default: compare = "pcmpeqd"; negate = true; break;
+            }
+        }
+
+        const auto move = packed_move_on_datatype(operand_type, avx2);
+        asm_stream << "    " << move << " " << reg << "0, " << width << " ptr [rip + " << first_text << "]\n";
+        asm_stream << "    " << move << " " << reg << "1, " << width << " ptr [rip + " << second_text << "]\n";
+        if (avx2)
+        {
+            asm_stream << "    v" << compare << " ymm0, ymm0, ymm1" << predicate << "\n";
+            if (negate)
+            {
+                asm_stream << "    vpcmpeqd ymm1, ymm1, ymm1\n";
+                asm_stream << "    vpxor ymm0, ymm0, ymm1\n";
+            }
+            asm_stream << "    vpsrld ymm0, ymm0, 31\n";
+        }
+        else
+        {
+            asm_stream << "    " << compare << " xmm0, xmm1" << predicate << "\n";
+            if (negate)
+            {
+                asm_stream << "    pcmpeqd xmm1, xmm1\n";
+                asm_stream << "    pxor xmm0, xmm1\n";
+            }
+            asm_stream << "    psrld xmm0, 31\n";
+        }
+        // Lanes where the comparison holds are all ones, the shift leaves the 0 or 1 of the scalar code
+        const auto result_move = packed_move_on_datatype(tac->get_result()->get_data_type(), avx2);
+        asm_stream << "    " << result_move << " " << width << " ptr [rip + " << get_label_or_text(tac->get_result()) << "], " << reg << "0\n";
+    }
+    else if (!avx2 && (type == TacType::TAC_MIN || type == TacType::TAC_MAX) && tac->get_result()->get_data_type() == DataType::TYPE_PACKED_INT)
+    {
+        // SSE2 has no pminsd or pmaxsd, the mask of a comparison picks the lanes of each operand
+        const auto result_text = get_label_or_text(tac->get_result());
+        asm_stream << "    movdqu xmm0, xmmword ptr [rip + " << get_label_or_text(tac->get_first_operator()) << "]\n";
+        asm_stream << "    movdqu xmm1, xmmword ptr [rip + " << get_label_or_text(tac->get_second_operator()) << "]\n";
+        asm_stream << "    movdqa xmm2, " << (type == TacType::TAC_MAX ? "xmm0" : "xmm1") << "\n";
+        asm_stream << "    pcmpgtd xmm2, " << (type == TacType::TAC_MAX ? "xmm1" : "xmm0") << "\n";
+        asm_stream << "    pand xmm0, xmm2\n";
+        asm_stream << "    pandn xmm2, xmm1\n";
+        asm_stream << "    por xmm0, xmm2\n";
+        asm_stream << "    movdqu xmmword ptr [rip + " << result_text << "], xmm0\n";
+    }
+    else
+    {
+        const auto result_var = tac->get_result();
+        const auto data_type = result_var->get_data_type();
+        const auto move = packed_move_on_datatype(data_type, avx2);
+        const auto operation = packed_operation_on_datatype(type, data_type);
+        asm_stream << "    " << move << " " << reg << "0, " << width << " ptr [rip + " << get_label_or_text(tac->get_first_operator()) << "]\n";
+        asm_stream << "    " << move << " " << reg << "1, " << width << " ptr [rip + " << get_label_or_text(tac->get_second_operator()) << "]\n";
+        if (avx2)
+        {
+            asm_stream << "    v" << operation << " ymm0, ymm0, ymm1\n";
+        }
+        else
+        {
+            asm_stream << "    " << operation << " xmm0, xmm1\n";
+        }
+        asm_stream << "    " << move << " " << width << " ptr [rip + " << get_label_or_text(result_var) << "], " << reg << "0\n";
+    }
+    return asm_stream.str();
+}
+
+// Restores the callee saved registers and leaves the function
+std::string epilogue_asm(const RegisterAllocation &allocation)
+{
+    if (allocation.frame_size == 0)
+    {
+        return "    pop rbp\n    ret\n";
+    }
+    std::stringstream asm_stream;
+    for (const auto &[name, offset] : allocation.saved_registers)
+    {
+        asm_stream << "    mov " << name << ", qword ptr " << frame_address(offset) << "\n";
+    }
+    asm_stream << "    leave\n";
+    asm_stream << "    ret\n";
+    return asm_stream.str();
+}
+
+// TACs of the function that begins at the given index, up to its ENDFUN
+TACList function_tacs_at(const TACList &tac_list, const size_t begin)
+{
+    TACList function_tacs;
+    for (size_t i = begin; i < tac_list.size(); ++i)
+    {
+        function_tacs.push_back(tac_list[i]);
+        if (tac_list[i]->get_type() == TacType::TAC_ENDFUN)
+        {
+            break;
+        }
+    }
+    return function_tacs;
+}
+
+// Scratch registers the tiles of an expression tree are computed in, in order
+static const std::vector<std::string> TILE_REGISTERS = {"eax", "ecx", "edx", "esi", "edi"};
+
+bool in_register(const ExpressionNodePtr &node, const RegisterAllocation &allocation)
+{
+    return node->is_leaf() && allocation.registers.count(node->symbol) != 0;
+}
+
+bool tree_reads(const ExpressionNodePtr &node, const SymbolTableEntry &symbol)
+{
+    if (node->is_leaf())
+    {
+        return node->symbol == symbol;
+    }
+    return std::any_of(node->children.begin(), node->children.end(), [&](const ExpressionNodePtr &child) {
+        return tree_reads(child, symbol);
+    });
+}
+
+std::string address_text(const std::vector<std::string> &terms, const long displacement)
+{
+    std::string text = "[";
+    for (const auto &term : terms)
+    {
+        text += (text.size() > 1 ? " + " : "") + term;
+    }
+    if (displacement != 0 || terms.empty())
+    {
+        const auto sign = displacement < 0 ? " - " : " + ";
+        text += (terms.empty() ? "" : sign) + std::to_string(terms.empty() ? displacement : std::abs(displacement));
+    }
+    return text + "]";
+}
+
+// Computes the node into the destination, a 32 bit register, with the tile selected for it.
+// The values below it are computed in the scratch registers from the given one on.
+std::string tile_asm(const ExpressionNodePtr &node, const std::string &destination, const size_t scratch, const TileSelection &selection,
+                     const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    if (node->is_leaf())
+    {
+        asm_stream << "    mov " << destination << ", " << operand_of(node->symbol, 4, allocation) << "\n";
+        return asm_stream.str();
+    }
+
+    const auto &tile = selection.at(node.get());
+    const auto type = node->tac->get_type();
+    const auto &first = node->children[0];
+    const auto &second = node->children[1];
+    const auto literal_first = is_literal_node(first) && !is_literal_node(second);
+    const auto &other = literal_first ? second : first;
+    const auto &constant = literal_first ? first : second;
+    switch (tile.kind)
+    {
+    case TILE_INCREMENT:
+        {
+            const auto step = type == TacType::TAC_SUB ? -literal_of(constant) : literal_of(constant);
+            asm_stream << tile_asm(other, destination, scratch, selection, allocation);
+            asm_stream << "    " << (step > 0 ? "inc " : "dec ") << destination << "\n";
+            break;
+        }
+    case TILE_SHIFT:
+        {
+            const auto factor = literal_of(constant);
+            long shift = 0;
+            while ((1L << shift) < factor)
+            {
+                shift++;
+            }
+            asm_stream << tile_asm(other, destination, scratch, selection, allocation);
+            asm_stream << "    shl " << destination << ", " << shift << "\n";
+            break;
+        }
+    case TILE_SCALE:
+        {
+            // x * 3 is x + x * 2, and so on
+            auto source = in_register(other, allocation) ? allocation.registers.at(other->symbol) : register_with_size(destination, 8);
+            if (!in_register(other, allocation))
+            {
+                asm_stream << tile_asm(other, destination, scratch, selection, allocation);
+            }
+            asm_stream << "    lea " << destination << ", " << address_text({source, source + " * " + std::to_string(literal_of(constant) - 1)}, 0) << "\n";
+            break;
+        }
+    case TILE_ADDRESS:
+        {
+            // The parts not in a register go to the destination first, then to the scratch registers
+            std::vector<std::string> terms;
+            auto target = destination;
+            auto next = scratch;
+            for (const auto &part : {tile.base, tile.index})
+            {
+                if (!part)
+                {
+                    continue;
+                }
+                auto name = in_register(part, allocation) ? allocation.registers.at(part->symbol) : register_with_size(target, 8);
+                if (!in_register(part, allocation))
+                {
+                    asm_stream << tile_asm(part, target, next, selection, allocation);
+                    target = TILE_REGISTERS.at(next++);
+                }
+                terms.push_back(part == tile.index && tile.scale != 1 ? name + " * " + std::to_string(tile.scale) : name);
+            }
+            // Adding zero leaves a copy, which is no instruction at all when it is already in place
+            if (!tile.index && tile.displacement == 0 && terms.size() == 1)
+            {
+                if (terms[0] != register_with_size(destination, 8))
+                {
+                    asm_stream << "    mov " << destination << ", " << register_with_size(terms[0], 4) << "\n";
+                }
+                break;
+            }
+            asm_stream << "    lea " << destination << ", " << address_text(terms, tile.displacement) << "\n";
+            break;
+        }
+    default:
+        {
+            const auto operation = type == TacType::TAC_ADD ? "add" : (type == TacType::TAC_SUB ? "sub" : "imul");
+            if (type == TacType::TAC_MUL && is_literal_node(constant) && !is_literal_node(other) && other->is_leaf())
+            {
+                // x * 1 is a copy
+                const auto factor = literal_of(constant);
+                asm_stream << "    " << (factor == 1 ? "mov " : "imul ") << destination << ", " << operand_of(other->symbol, 4, allocation);
+                asm_stream << (factor == 1 ? "" : ", " + std::to_string(factor)) << "\n";
+            }
+            else if (type != TacType::TAC_SUB && first->is_leaf() && !second->is_leaf())
+            {
+                asm_stream << tile_asm(second, destination, scratch, selection, allocation);
+                asm_stream << "    " << operation << " " << destination << ", " << operand_of(first->symbol, 4, allocation) << "\n";
+            }
+            else if (second->is_leaf())
+            {
+                asm_stream << tile_asm(first, destination, scratch, selection, allocation);
+                asm_stream << "    " << operation << " " << destination << ", " << operand_of(second->symbol, 4, allocation) << "\n";
+            }
+            else
+            {
+                const auto &temporary = TILE_REGISTERS.at(scratch);
+                asm_stream << tile_asm(first, destination, scratch, selection, allocation);
+                asm_stream << tile_asm(second, temporary, scratch + 1, selection, allocation);
+                asm_stream << "    " << operation << " " << destination << ", " << temporary << "\n";
+            }
+            break;
+        }
+    }
+    return asm_stream.str();
+}
+
+// Stores the value of the tree in the result. An addition to the result itself updates it in
+// place, and a result in a register not read by the tree is computed right there.
+std::string value_tree_asm(const SymbolTableEntry &result, const ExpressionNodePtr &value, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    const auto selection = select_tiles(value, allocation);
+    const auto destination = operand_of(result, 4, allocation);
+    const auto result_in_register = allocation.registers.count(result) != 0;
+    const auto type = value->tac->get_type();
+    if (type == TacType::TAC_ADD || type == TacType::TAC_SUB)
+    {
+        const auto &first = value->children[0];
+        const auto &second = value->children[1];
+        const auto updates_first = first->is_leaf() && first->symbol == result;
+        const auto updates_second = type == TacType::TAC_ADD && second->is_leaf() && second->symbol == result && !updates_first;
+        if (updates_first || updates_second)
+        {
+            const auto &other = updates_first ? second : first;
+            const auto operation = type == TacType::TAC_ADD ? "add" : "sub";
+            if (is_literal_node(other) && std::abs(literal_of(other)) == 1)
+            {
+                const auto step = type == TacType::TAC_SUB ? -literal_of(other) : literal_of(other);
+                asm_stream << "    " << (step > 0 ? "inc " : "dec ") << destination << "\n";
+            }
+            else if (is_literal_node(other) || in_register(other, allocation) || (other->is_leaf() && result_in_register))
+            {
+                asm_stream << "    " << operation << " " << destination << ", " << operand_of(other->symbol, 4, allocation) << "\n";
+            }
+            else
+            {
+                asm_stream << tile_asm(other, "eax", 1, selection, allocation);
+                asm_stream << "    " << operation << " " << destination << ", eax\n";
+            }
+            return asm_stream.str();
+        }
+    }
+    if (result_in_register && !tree_reads(value, result))
+    {
+        asm_stream << tile_asm(value, destination, 0, selection, allocation);
+        return asm_stream.str();
+    }
+    asm_stream << tile_asm(value, "eax", 1, selection, allocation);
+    asm_stream << "    mov " << destination << ", eax\n";
+    return asm_stream.str();
+}
+
+// Compares the two operands of an integer comparison, test takes the place of a comparison with zero
+std::string compare_tree_asm(const ExpressionNodePtr &root, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    const auto selection = select_tiles(root, allocation);
+    const auto &first = root->children[0];
+    const auto &second = root->children[1];
+    // Only one of the operands may be in memory
+    const auto first_in_memory = first->is_leaf() && !is_literal_node(first) && !in_register(first, allocation);
+    const auto second_in_memory = second->is_leaf() && !is_literal_node(second) && !in_register(second, allocation);
+    std::string left = "eax";
+    if (in_register(first, allocation) || (first_in_memory && !second_in_memory))
+    {
+        left = operand_of(first->symbol, 4, allocation);
+    }
+    else
+    {
+        asm_stream << tile_asm(first, "eax", 1, selection, allocation);
+    }
+
+    if (is_literal_node(second) && literal_of(second) == 0 && !first_in_memory)
+    {
+        asm_stream << "    test " << left << ", " << left << "\n";
+    }
+    else if (second->is_leaf())
+    {
+        asm_stream << "    cmp " << left << ", " << operand_of(second->symbol, 4, allocation) << "\n";
+    }
+    else
+    {
+        asm_stream << tile_asm(second, "ecx", 2, selection, allocation);
+        asm_stream << "    cmp " << left << ", ecx\n";
+    }
+    return asm_stream.str();
+}
+
+// Computes the index of a vector access into rcx, and gives the part of the address after the
+// vector in rax. A literal added to the index goes to the displacement.
+std::pair<std::string, std::string> index_tree_asm(const ExpressionNodePtr &root, const long element_size, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    auto [term, offset] = split_offset(root->children[0]);
+    if (std::abs(offset * element_size) > INT_MAX)
+    {
+        term = root->children[0];
+        offset = 0;
+    }
+    std::string address;
+    if (term)
+    {
+        if (term->is_leaf())
+        {
+            asm_stream << load_asm("movsxd", "rcx", term->symbol, 4, allocation);
+        }
+        else
+        {
+            asm_stream << tile_asm(term, "ecx", 2, select_tiles(root, allocation), allocation);
+            asm_stream << "    movsxd rcx, ecx\n";
+        }
+        address = " + rcx * " + std::to_string(element_size);
+    }
+    const auto displacement = offset * element_size;
+    if (displacement != 0)
+    {
+        address += (displacement < 0 ? " - " : " + ") + std::to_string(std::abs(displacement));
+    }
+    return {asm_stream.str(), address};
+}
+
+// Divisors the division of a dividend in ecx by a constant handles: any literal but 0, whose size
+// fits a signed 32-bit value
+bool is_constant_divisor(const SymbolTableEntry &symbol)
+{
+    if (!is_immediate(symbol))
+    {
+        return false;
+    }
+    const auto divisor = std::stol(immediate_of(symbol));
+    return divisor != 0 && std::abs(divisor) <= INT_MAX;
+}
+
+// Quotient or remainder of the dividend in ecx by a constant, into eax, rounded toward zero like
+// idiv. Powers of two add divisor - 1 to negative dividends before the shift, and the other
+// divisors take the high half of a multiplication by their magic number, plus one when negative.
+// A remainder is the dividend minus the quotient times the divisor.
+std::string constant_division_asm(const TacType operation, const long divisor)
+{
+    std::stringstream asm_stream;
+    const auto magnitude = std::abs(divisor);
+    if (magnitude == 1)
+    {
+        if (operation == TacType::TAC_MOD)
+        {
+            asm_stream << "    xor eax, eax\n";
+            return asm_stream.str();
+        }
+        asm_stream << "    mov eax, ecx\n";
+    }
+    else if ((magnitude & (magnitude - 1)) == 0)
+    {
+        asm_stream << "    lea eax, [rcx + " << magnitude - 1 << "]\n";
+        asm_stream << "    test ecx, ecx\n";
+        asm_stream << "    cmovns eax, ecx\n";
+        if (operation == TacType::TAC_MOD)
+        {
+            asm_stream << "    and eax, " << -magnitude << "\n";
+            asm_stream << "    neg eax\n";
+            asm_stream << "    add eax, ecx\n";
+            return asm_stream.str();
+        }
+        long shift = 0;
+        while ((1L << shift) < magnitude)
+        {
+            shift++;
+        }
+        asm_stream << "    sar eax, " << shift << "\n";
+    }
+    else
+    {
+        const auto magic = division_magic(magnitude);
+        asm_stream << "    mov eax, " << static_cast<int32_t>(magic.multiplier) << "\n";
+        asm_stream << "    imul ecx\n";
+        if (magic.multiplier > INT_MAX)
+        {
+            asm_stream << "    add edx, ecx\n";
+        }
+        if (magic.shift > 0)
+        {
+            asm_stream << "    sar edx, " << magic.shift << "\n";
+        }
+        asm_stream << "    mov eax, ecx\n";
+        asm_stream << "    shr eax, 31\n";
+        asm_stream << "    add eax, edx\n";
+        if (operation == TacType::TAC_MOD)
+        {
+            asm_stream << "    imul eax, eax, " << magnitude << "\n";
+            asm_stream << "    neg eax\n";
+            asm_stream << "    add eax, ecx\n";
+            return asm_stream.str();
+        }
+    }
+    if (divisor < 0)
+    {
+        asm_stream << "    neg eax\n";
+    }
+    return asm_stream.str();
+}
+
+// Signed division or modulo of integers or characters, which are zero extended to 32 bits. The
+// dividend goes to ecx and the result to eax; constant divisors are reduced when optimizing, the
+// others sign extend the dividend to edx with cdq for idiv.
+std::string division_asm(const TACptr &tac, const bool reduce_constants, const RegisterAllocation &allocation)
+{
+    std::stringstream asm_stream;
+    const auto load = [&](const std::string &destination, const SymbolTableEntry &symbol) {
+        return symbol->get_data_type() == DataType::TYPE_INT ? load_asm("mov", destination, symbol, 4, allocation)
+                                                             : load_asm("movzx", destination, symbol, 1, allocation);
+    };
+    const auto divisor = tac->get_second_operator();
+    asm_stream << load("ecx", tac->get_first_operator());
+    if (reduce_constants && is_constant_divisor(divisor))
+    {
+        asm_stream << constant_division_asm(tac->get_type(), std::stol(immediate_of(divisor)));
+    }
+    else
+    {
+        asm_stream << load("esi", divisor);
+        asm_stream << "    mov eax, ecx\n";
+        asm_stream << "    cdq\n";
+        asm_stream << "    idiv esi\n";
+        if (tac->get_type() == TacType::TAC_MOD)
+        {
+            asm_stream << "    mov eax, edx\n";
+        }
+    }
+    const auto result = tac->get_result();
+    asm_stream << (result->get_data_type() == DataType::TYPE_INT ? "    mov " + operand_of(result, 4, allocation) + ", eax\n" : store_byte_asm(result, allocation));
+    return asm_stream.str();
+}
+
+bool is_packed_tac(const TACptr &tac)
+{
+    const auto type = tac->get_type();
+    if (type == TacType::TAC_PACKED_LOAD || type == TacType::TAC_PACKED_STORE || type == TacType::TAC_BROADCAST)
+    {
+        return true;
+    }
+    const auto result = tac->get_result();
+    return tac->is_expression() && result && is_packed_type(result->get_data_type());
+}
+
+// Temporaries and parameters of the function that got neither a register nor a frame slot, so
+// the emitter reads them from their global storage. The results of folded TACs never leave the
+// scratch registers, and the parameters an ARG names are passed in the registers of the call.
+void add_memory_temporaries(const TACList &function_tacs, const RegisterAllocation &allocation, const std::map<TACptr, TACptr> &folded,
+                            std::set<SymbolTableEntry> &in_memory)
+{
+    std::set<SymbolTableEntry> scratch;
+    for (const auto &[tac, root] : folded)
+    {
+        scratch.insert(tac->get_result());
+    }
+    for (const auto &tac : function_tacs)
+    {
+        const auto operands = {tac->get_type() == TAC_ARG ? nullptr : tac->get_result(), tac->get_first_operator(), tac->get_second_operator()};
+        for (const auto &symbol : operands)
+        {
+            const auto is_temporary = symbol
+                && ((symbol->ident_type == IdentType::IDENT_VAR && symbol->type == SymbolType::SYMBOL_TEMP) || symbol->ident_type == IdentType::IDENT_PARAM);
+            if (is_temporary && scratch.count(symbol) == 0 && allocation.registers.count(symbol) == 0 && allocation.stack_slots.count(symbol) == 0)
+            {
+                in_memory.insert(symbol);
+            }
+        }
+    }
+}
+
+std::string functions_asm(const TACList tac_list, const OptimizerOptions &options, std::set<SymbolTableEntry> &in_memory)
+{
+    std::stringstream asm_stream;
+    asm_stream << "    .text\n";
+    asm_stream << "    .p2align 4\n";
+
+    const auto fused_branches = options.level >= 1 ? find_fused_branches(tac_list) : std::set<TACptr>();
+    const auto loop_headers = options.level >= 1 ? find_loop_headers(tac_list) : std::set<SymbolTableEntry>();
+    bool has_bounds_checks = false;
+    const auto shared = shared_temporaries(tac_list);
+    RegisterAllocation allocation;
+    ExpressionForest forest;
+
+    for (size_t index = 0; index < tac_list.size(); ++index)
+    {
+        const auto &tac = tac_list[index];
+        // The root of the tree computes the TAC
+        if (forest.folded.count(tac))
+        {
+            continue;
+        }
+        const auto tree = forest.trees.find(tac);
+        const auto has_tree = tree != forest.trees.end();
+        switch (tac->get_type())
+        {
+        case TacType::TAC_BEGINFUN:
+            {
+                const auto func_name = tac->get_result()->get_text();
+                asm_stream << "    .globl " << func_name << "\n";
+                asm_stream << func_name << ":\n";
+                if (func_name == "_main")
+                {
+                    asm_stream << "    .global main\n";
+                    asm_stream << "main:\n";
+                }
+
+                asm_stream << "    .cfi_startproc\n";
+                // Level 0 keeps every value of the function in its frame, and computes each TAC on its own
+                const auto function_tacs = function_tacs_at(tac_list, index);
+                forest = options.level >= 1 ? build_expression_forest(function_tacs) : ExpressionForest();
+                allocation = allocate_registers(function_tacs, shared, options.level >= 1, forest.folded);
+                add_memory_temporaries(function_tacs, allocation, forest.folded, in_memory);
+                asm_stream << prologue_asm(tac->get_result(), allocation);
+                break;
             }
         case TacType::TAC_ENDFUN:
             {
                 static size_t func_counter = 0;
                 const auto func_name = tac->get_result()->get_text();
-                asm_stream << "    pop rbp\n";
-                asm_stream << "    ret\n";
+                asm_stream << epilogue_asm(allocation);
                 // asm_stream << ".Lfunc_end" << func_counter << ":\n";
                 // asm_stream << "    .size " << func_name << ", .Lfunc_end" << func_counter << " - " << func_name << "\n";
                 asm_stream << "    .cfi_endproc\n";
@@ -352,53 +1537,106 @@ std::string functions_asm(const TACList tac_list)
                 switch (print_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov esi, dword ptr [rip + " << print_var->get_text() << "]\n";
+                    asm_stream << "    mov esi, " << operand_of(print_var, 4, allocation) << "\n";
+                    break;
+                case DataType::TYPE_CHAR:
+                case DataType::TYPE_BOOL:
+                    asm_stream << load_asm("movsx", "esi", print_var, 1, allocation);
+                    break;
+                case DataType::TYPE_REAL:
+                    asm_stream << load_asm("movss", "xmm0", print_var, 4, allocation);
+                    asm_stream << "    cvtss2sd xmm0, xmm0\n"; // Convert float to double for printf
+                    break;
+                case DataType::TYPE_STRING:
+                    break;
+                default:
+                    throw std::runtime_error("Unsupported data type for print operation.");
+                }
+
+                const auto label = get_printf_label(print_var->get_data_type(), print_var);
+                asm_stream << "    lea rdi, [rip + " << label << "]\n";
+
+                asm_stream << "    mov al, " << (print_type == DataType::TYPE_REAL ? '1' : '0') << "\n";
+                asm_stream << "    call printf\n";
+                break;
+            }
+        case TacType::TAC_ARG:
+            {
+                // Only arguments whose value may change before the call are saved, the call reads the others
+                const auto slot = allocation.argument_slots.find(tac);
+                if (slot == allocation.argument_slots.end())
+                {
+                    break;
+                }
+                const auto value = tac->get_first_operator();
+                const auto address = frame_address(slot->second);
+                switch (tac->get_result()->get_data_type())
+                {
+                case DataType::TYPE_INT:
+                    if (value->get_data_type() == DataType::TYPE_CHAR || value->get_data_type() == DataType::TYPE_BOOL)
+                    {
+                        asm_stream << load_asm("movzx", "eax", value, 1, allocation);
+                    }
+                    else
+                    {
+                        asm_stream << "    mov eax, " << operand_of(value, 4, allocation) << "\n";
+                    }
+                    asm_stream << "    mov dword ptr " << address << ", eax\n";
                     break;
                 case DataType::TYPE_CHAR:
                 case DataType::TYPE_BOOL:
-                    asm_stream << "    movsx esi, byte ptr [rip + " << print_var->get_text() << "]\n";
+                    asm_stream << load_asm("movzx", "eax", value, 1, allocation);
+                    asm_stream << "    mov dword ptr " << address << ", eax\n";
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << print_var->get_text() << "]\n";
-                    asm_stream << "    cvtss2sd xmm0, xmm0\n"; // Convert float to double for printf
-                    break;
-                case DataType::TYPE_STRING:
+                    asm_stream << load_asm("movss", "xmm0", value, 4, allocation);
+                    asm_stream << "    movss dword ptr " << address << ", xmm0\n";
                     break;
                 default:
-                    throw std::runtime_error("Unsupported data type for print operation.");
+                    throw std::runtime_error("Unsupported data type for argument.");
                 }
-
-                const auto label = get_printf_label(print_var->get_data_type(), print_var);
-                asm_stream << "    lea rdi, [rip + " << label << "]\n";
-
-                asm_stream << "    mov al, " << (print_type == DataType::TYPE_REAL ? '1' : '0') << "\n";
-                asm_stream << "    call printf\n";
                 break;
             }
         case TacType::TAC_MOVE:
-        case TacType::TAC_ARG:
             {
                 const auto move_to_var = tac->get_result();
-                const auto move_to_text = get_label_or_text(move_to_var);
 
                 const auto moved_var = tac->get_first_operator();
-                const auto moved_text = get_label_or_text(moved_var);
 
                 const auto move_to_type = move_to_var->get_data_type();
 
+                // Literals are stored without a register, reals as their bits unless they go to an xmm register
+                if (is_immediate(moved_var))
+                {
+                    const auto size = move_to_type == DataType::TYPE_INT || in_frame_or_register(move_to_var, allocation) ? 4 : 1;
+                    asm_stream << "    mov " << operand_of(move_to_var, size, allocation) << ", " << immediate_of(moved_var) << "\n";
+                    break;
+                }
+                if (moved_var->is_literal() && move_to_type == DataType::TYPE_REAL && !in_xmm_register(move_to_var, allocation))
+                {
+                    asm_stream << "    mov " << operand_of(move_to_var, 4, allocation) << ", " << value_representation(moved_var->get_text(), DataType::TYPE_REAL) << "\n";
+                    break;
+                }
+
                 switch (move_to_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov eax, dword ptr [rip + " << moved_text << "]\n";
-                    asm_stream << "    mov dword ptr [rip + " << move_to_text << "], eax\n";
+                    if (has_tree)
+                    {
+                        asm_stream << value_tree_asm(move_to_var, tree->second->children[0], allocation);
+                        break;
+                    }
+                    asm_stream << "    mov eax, " << operand_of(moved_var, 4, allocation) << "\n";
+                    asm_stream << "    mov " << operand_of(move_to_var, 4, allocation) << ", eax\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx eax, byte ptr [rip + " << moved_text << "]\n";
-                    asm_stream << "    mov byte ptr [rip + " << move_to_text << "], al\n";
+                case DataType::TYPE_BOOL:
+                    asm_stream << load_asm("movzx", "eax", moved_var, 1, allocation);
+                    asm_stream << store_byte_asm(move_to_var, allocation);
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << moved_text << "]\n";
-                    asm_stream << "    movss dword ptr [rip + " << move_to_text << "], xmm0\n";
+                    asm_stream << load_asm("movss", "xmm0", moved_var, 4, allocation);
+                    asm_stream << "    movss " << operand_of(move_to_var, 4, allocation) << ", xmm0\n";
                     break;
                 default:
                     throw std::runtime_error("Unsupported data type for assignment operation.");
@@ -412,34 +1650,51 @@ std::string functions_asm(const TACList tac_list)
         case TacType::TAC_MOD:
             {
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto first_op = tac->get_first_operator();
-                const auto first_op_text = get_label_or_text(first_op);
                 const auto second_op = tac->get_second_operator();
-                const auto second_op_text = get_label_or_text(second_op);
 
                 const auto result_type = result_var->get_data_type();
+                if (is_packed_type(result_type))
+                {
+                    asm_stream << packed_asm(tac, options.avx2, allocation);
+                    break;
+                }
+
+                if (has_tree)
+                {
+                    asm_stream << value_tree_asm(result_var, tree->second, allocation);
+                    break;
+                }
+
+                const auto is_division = tac->get_type() == TacType::TAC_DIV || tac->get_type() == TacType::TAC_MOD;
+                if (is_division && (result_type == DataType::TYPE_INT || result_type == DataType::TYPE_CHAR))
+                {
+                    asm_stream << division_asm(tac, options.level >= 1, allocation);
+                    break;
+                }
 
                 const auto operation = math_operation_on_datatype(tac->get_type(), result_type);
                 switch (result_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov eax, dword ptr [rip + " << first_op_text << "]\n";
-                    asm_stream << "    " << operation << " eax, dword ptr [rip + " << second_op_text << "]\n";
-                    asm_stream << "    mov dword ptr [rip + " << result_text << "], ";
-                    asm_stream << (tac->get_type() != TacType::TAC_MOD ? "eax\n" : "edx\n");
+                    asm_stream << "    mov eax, " << operand_of(first_op, 4, allocation) << "\n";
+                    asm_stream << "    " << operation << " eax, " << operand_of(second_op, 4, allocation) << "\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", eax\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx eax, byte ptr [rip + " << first_op_text << "]\n";
-                    asm_stream << "    movzx ebx, byte ptr [rip + " << second_op_text << "]\n";
-                    asm_stream << "    " << operation << " eax, ebx\n";
-                    asm_stream << "    mov byte ptr [rip + " << result_text << "], ";
-                    asm_stream << (tac->get_type() != TacType::TAC_MOD ? "al\n" : "dl\n");
+                    asm_stream << load_asm("movzx", "eax", first_op, 1, allocation);
+                    asm_stream << load_asm("movzx", "ecx", second_op, 1, allocation);
+                    asm_stream << "    " << operation << " eax, ecx\n";
+                    asm_stream << store_byte_asm(result_var, allocation);
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << first_op_text << "]\n";
-                    asm_stream << "    " << operation << " xmm0, dword ptr [rip + " << second_op_text << "]\n";
-                    asm_stream << "    movss dword ptr [rip + " << result_text << "], xmm0\n";
+                    asm_stream << load_asm("movss", "xmm0", first_op, 4, allocation);
+                    {
+                        const auto [setup, second_text] = real_operand(second_op, allocation);
+                        asm_stream << setup;
+                        asm_stream << "    " << operation << " xmm0, " << second_text << "\n";
+                    }
+                    asm_stream << "    movss " << operand_of(result_var, 4, allocation) << ", xmm0\n";
                     if (tac->get_type() == TacType::TAC_MOD)
                     {
                         throw std::runtime_error("Real numbers do not support mod operation.");
@@ -458,18 +1713,20 @@ std::string functions_asm(const TACList tac_list)
         case TacType::TAC_DIF:
             {
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto first_op = tac->get_first_operator();
-                const auto first_op_text = get_label_or_text(first_op);
                 const auto first_type = first_op->get_data_type();
                 const auto second_op = tac->get_second_operator();
-                const auto second_op_text = get_label_or_text(second_op);
                 const auto second_type = second_op->get_data_type();
 
-                const auto first_load_type = first_type == DataType::TYPE_CHAR ? "byte" : "dword";
-                const auto second_load_type = second_type == DataType::TYPE_CHAR ? "byte" : "dword";
+                const auto first_size = first_type == DataType::TYPE_CHAR ? 1 : 4;
+                const auto second_size = second_type == DataType::TYPE_CHAR ? 1 : 4;
 
                 const auto first_op_data_type = first_op->get_data_type();
+                if (is_packed_type(first_op_data_type))
+                {
+                    asm_stream << packed_asm(tac, options.avx2, allocation);
+                    break;
+                }
 
                 const auto mov_type_first= first_type == DataType::TYPE_CHAR ? "movzx" : "mov";
                 const auto mov_type_second = second_type == DataType::TYPE_CHAR ? "movzx" : "mov";
@@ -477,56 +1734,129 @@ std::string functions_asm(const TACList tac_list)
                 {
                 case DataType::TYPE_INT:
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    " << mov_type_first << " eax, " << first_load_type <<" ptr [rip + " << first_op_text << "]\n";
-                    asm_stream << "    " << mov_type_second << " ebx, " << second_load_type <<" ptr [rip + " << second_op_text << "]\n";
-                    asm_stream << "    cmp eax, ebx\n";
-                    asm_stream << "    " << cmp_operation_on_datatype(tac->get_type(), first_op_data_type) << " al\n";
-                    asm_stream << "    and al, 1\n";
-                    asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                    if (has_tree)
+                    {
+                        asm_stream << compare_tree_asm(tree->second, allocation);
+                        break;
+                    }
+                    asm_stream << load_asm(mov_type_first, "eax", first_op, first_size, allocation);
+                    asm_stream << load_asm(mov_type_second, "ecx", second_op, second_size, allocation);
+                    asm_stream << "    cmp eax, ecx\n";
+                    break;
+                case DataType::TYPE_POINTER:
+                    {
+                        auto first_reg = pointer_register(first_op, allocation);
+                        if (first_reg.empty())
+                        {
+                            asm_stream << "    mov rax, " << operand_of(first_op, 8, allocation) << "\n";
+                            first_reg = "rax";
+                        }
+                        asm_stream << "    cmp " << first_reg << ", " << operand_of(second_op, 8, allocation) << "\n";
+                    }
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << first_op_text << "]\n";
-                    asm_stream << "    ucomiss xmm0, dword ptr [rip + " << second_op_text << "]\n";
-                    asm_stream << "    " << cmp_operation_on_datatype(tac->get_type(), first_op_data_type) << " al\n";
-                    asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                    asm_stream << load_asm("movss", "xmm0", first_op, 4, allocation);
+                    {
+                        const auto [setup, second_text] = real_operand(second_op, allocation);
+                        asm_stream << setup;
+                        asm_stream << "    ucomiss xmm0, " << second_text << "\n";
+                    }
                     break;
                 default:
                     throw std::runtime_error("Unsupported data type for comparison operation.");
                 }
+
+                // The IFZ that reads the result jumps on the flags, the bool is never stored
+                if (index + 1 < tac_list.size() && fused_branches.count(tac_list[index + 1]))
+                {
+                    const auto jump_label = tac_list[index + 1]->get_result()->get_text();
+                    asm_stream << "    " << false_jump_on_datatype(tac->get_type(), first_op_data_type) << " " << jump_label << "\n";
+                    break;
+                }
+                asm_stream << "    " << cmp_operation_on_datatype(tac->get_type(), first_op_data_type) << " al\n";
+                if (first_op_data_type == DataType::TYPE_INT || first_op_data_type == DataType::TYPE_CHAR)
+                {
+                    asm_stream << "    and al, 1\n";
+                }
+                // Comparisons turned into a 0 or 1 to add have an integer result
+                if (result_var->get_data_type() == DataType::TYPE_INT)
+                {
+                    asm_stream << "    movzx eax, al\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", eax\n";
+                    break;
+                }
+                asm_stream << store_byte_asm(result_var, allocation);
+                break;
+            }
+        case TacType::TAC_MIN:
+        case TacType::TAC_MAX:
+            {
+                const auto result_var = tac->get_result();
+                const auto is_min = tac->get_type() == TacType::TAC_MIN;
+
+                const auto result_type = result_var->get_data_type();
+                if (is_packed_type(result_type))
+                {
+                    asm_stream << packed_asm(tac, options.avx2, allocation);
+                    break;
+                }
+                switch (result_type)
+                {
+                case DataType::TYPE_INT:
+                    // The second operand is kept unless the first one is smaller, or greater
+                    asm_stream << "    mov eax, " << operand_of(tac->get_first_operator(), 4, allocation) << "\n";
+                    asm_stream << "    mov ecx, " << operand_of(tac->get_second_operator(), 4, allocation) << "\n";
+                    asm_stream << "    cmp eax, ecx\n";
+                    asm_stream << "    " << (is_min ? "cmovl" : "cmovg") << " ecx, eax\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", ecx\n";
+                    break;
+                case DataType::TYPE_REAL:
+                    // minss and maxss also give the second operand on ties and NaNs
+                    asm_stream << load_asm("movss", "xmm0", tac->get_first_operator(), 4, allocation);
+                    {
+                        const auto [setup, second_text] = real_operand(tac->get_second_operator(), allocation);
+                        asm_stream << setup;
+                        asm_stream << "    " << (is_min ? "minss" : "maxss") << " xmm0, " << second_text << "\n";
+                    }
+                    asm_stream << "    movss " << operand_of(result_var, 4, allocation) << ", xmm0\n";
+                    break;
+                default:
+                    throw std::runtime_error("Unsupported data type for min and max operations.");
+                }
                 break;
             }
         case TacType::TAC_AND:
         case TacType::TAC_OR:
             {
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto first_op = tac->get_first_operator();
-                const auto first_op_text = get_label_or_text(first_op);
                 const auto second_op = tac->get_second_operator();
-                const auto second_op_text = get_label_or_text(second_op);
                 const auto function = tac->get_type() == TacType::TAC_AND ? "and" : "or";
 
-                asm_stream << "    movzx eax, byte ptr [rip + " << first_op_text << "]\n";
-                asm_stream << "    movzx ebx, byte ptr [rip + " << second_op_text << "]\n";
-                asm_stream << "    " << function << " al, bl\n";
-                asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                asm_stream << load_asm("movzx", "eax", first_op, 1, allocation);
+                asm_stream << load_asm("movzx", "ecx", second_op, 1, allocation);
+                asm_stream << "    " << function << " al, cl\n";
+                asm_stream << store_byte_asm(result_var, allocation);
                 break;
             }
         case TacType::TAC_NOT:
             {
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto condition_var = tac->get_first_operator();
-                const auto condition_text = get_label_or_text(condition_var);
             
-                asm_stream << "    movzx eax, byte ptr [rip + " << condition_text << "]\n";
+                asm_stream << load_asm("movzx", "eax", condition_var, 1, allocation);
                 asm_stream << "    xor eax, 1\n"; // The not instruction results in -1 or 0, but xor gives 1 or 0
-                asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                asm_stream << store_byte_asm(result_var, allocation);
                 break;
             }
         case TacType::TAC_LABEL:
             {
                 const auto label = tac->get_result()->get_text();
+                if (loop_headers.count(tac->get_result()))
+                {
+                    // Aligns the start of the loop to 16 bytes, unless that takes more than 10 bytes of padding
+                    asm_stream << "    .p2align 4,,10\n";
+                }
                 asm_stream << label << ":\n";
                 break;
             }
@@ -538,11 +1868,14 @@ std::string functions_asm(const TACList tac_list)
             }
         case TacType::TAC_IFZ:
             {
+                if (fused_branches.count(tac))
+                {
+                    break;
+                }
                 const auto condition_var = tac->get_first_operator();
-                const auto condition_text = get_label_or_text(condition_var);
                 const auto jump_label = tac->get_result()->get_text();
                 // Conditions will always be of type bool (char)
-                asm_stream << "    movzx eax, byte ptr [rip + " << condition_text << "]\n";
+                asm_stream << load_asm("movzx", "eax", condition_var, 1, allocation);
                 asm_stream << "    cmp eax, 0\n";
                 asm_stream << "    je " << jump_label << "\n"; // Jump if zero
                 break;
@@ -550,42 +1883,41 @@ std::string functions_asm(const TACList tac_list)
         case TacType::TAC_RET:
             {
                 const auto ret_val = tac->get_result();
-                const auto ret_val_text = get_label_or_text(ret_val);
                 const auto ret_type = ret_val->get_data_type();
                 switch (ret_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov eax, dword ptr [rip + " << ret_val_text << "]\n";
+                    asm_stream << "    mov eax, " << operand_of(ret_val, 4, allocation) << "\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx al, byte ptr [rip + " << ret_val_text << "]\n";
+                    asm_stream << load_asm("movzx", "eax", ret_val, 1, allocation);
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << ret_val_text << "]\n";
+                    asm_stream << load_asm("movss", "xmm0", ret_val, 4, allocation);
                     break;
                 default:
                     throw std::runtime_error("Unsupported data type for return operation.");
                 }
+                // Return leaves the function right away, the code after it is not executed
+                asm_stream << epilogue_asm(allocation);
                 break;
             }
         case TacType::TAC_CALL:
             {
-                const auto func_name = tac->get_first_operator()->get_text();
-                asm_stream << "    call " << func_name << "\n";
+                asm_stream << call_asm(tac, allocation);
                 // If the function returns a value, we need to move it to the result variable
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto result_type = result_var->get_data_type();
                 switch (result_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov dword ptr [rip + " << result_text << "], eax\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", eax\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                    asm_stream << store_byte_asm(result_var, allocation);
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss dword ptr [rip + " << result_text << "], xmm0\n";
+                    asm_stream << "    movss " << operand_of(result_var, 4, allocation) << ", xmm0\n";
                     break;
                 default:
                     throw std::runtime_error("Unsupported data type for function call result.");
@@ -607,24 +1939,33 @@ std::string functions_asm(const TACList tac_list)
         case TacType::TAC_VECLOAD:
             {
                 const auto result_var = tac->get_result();
-                const auto result_text = get_label_or_text(result_var);
                 const auto vec_var = tac->get_first_operator();
                 const auto vec_text = get_label_or_text(vec_var);
 
                 const auto index_var = tac->get_second_operator();
-                const auto index_text = get_label_or_text(index_var);
                 const auto index_type = index_var->get_data_type();
+                const auto element_size = get_data_type_size(vec_var->get_data_type());
 
-                switch (index_type)
+                auto index_address = " + rcx * " + std::to_string(element_size);
+                if (has_tree)
                 {
-                case DataType::TYPE_INT:
-                    asm_stream << "    movsxd rcx, dword ptr [rip + " << index_text << "]\n";
-                    break;
-                case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx rcx, byte ptr [rip + " << index_text << "]\n";
-                    break;
-                default:
-                    throw std::runtime_error("Unsupported data type for vector index.");
+                    const auto [index_code, address] = index_tree_asm(tree->second, element_size, allocation);
+                    asm_stream << index_code;
+                    index_address = address;
+                }
+                else
+                {
+                    switch (index_type)
+                    {
+                    case DataType::TYPE_INT:
+                        asm_stream << load_asm("movsxd", "rcx", index_var, 4, allocation);
+                        break;
+                    case DataType::TYPE_CHAR:
+                        asm_stream << load_asm("movzx", "rcx", index_var, 1, allocation);
+                        break;
+                    default:
+                        throw std::runtime_error("Unsupported data type for vector index.");
+                    }
                 }
 
                 asm_stream << "    lea rax, [rip + " << vec_text << "]\n";
@@ -633,16 +1974,16 @@ std::string functions_asm(const TACList tac_list)
                 switch (vec_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov eax, dword ptr [rax + rcx * " << get_data_type_size(vec_type) << "]\n";
-                    asm_stream << "    mov dword ptr [rip + " << result_text << "], eax\n";
+                    asm_stream << "    mov eax, dword ptr [rax" << index_address << "]\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", eax\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx eax, byte ptr [rax + rcx * " << get_data_type_size(vec_type) << "]\n";
-                    asm_stream << "    mov byte ptr [rip + " << result_text << "], al\n";
+                    asm_stream << "    movzx eax, byte ptr [rax" << index_address << "]\n";
+                    asm_stream << store_byte_asm(result_var, allocation);
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rax + rcx * " << get_data_type_size(vec_type) << "]\n";
-                    asm_stream << "    movss dword ptr [rip + " << result_text << "], xmm0\n";
+                    asm_stream << "    movss xmm0, dword ptr [rax" << index_address << "]\n";
+                    asm_stream << "    movss " << operand_of(result_var, 4, allocation) << ", xmm0\n";
                     break;
                 default:
                     throw std::runtime_error("Unsupported data type for vector load operation.");
@@ -655,49 +1996,303 @@ std::string functions_asm(const TACList tac_list)
                 const auto vec_text = get_label_or_text(vec_var);
 
                 const auto index_var = tac->get_second_operator();
-                const auto index_text = get_label_or_text(index_var);
                 const auto index_type = index_var->get_data_type();
+                const auto element_size = get_data_type_size(vec_var->get_data_type());
+
+                auto index_address = " + rcx * " + std::to_string(element_size);
+                if (has_tree)
+                {
+                    const auto [index_code, address] = index_tree_asm(tree->second, element_size, allocation);
+                    asm_stream << index_code;
+                    index_address = address;
+                }
+                else
+                {
+                    switch (index_type)
+                    {
+                    case DataType::TYPE_INT:
+                        asm_stream << load_asm("movsxd", "rcx", index_var, 4, allocation);
+                        break;
+                    case DataType::TYPE_CHAR:
+                        asm_stream << load_asm("movzx", "rcx", index_var, 1, allocation);
+                        break;
+                    default:
+                        throw std::runtime_error("Unsupported data type for vector index.");
+                    }
+                }
 
-                switch (index_type)
+                asm_stream << "    lea rax, [rip + " << vec_text << "]\n";
+
+                const auto value_var = tac->get_first_operator();
+                const auto value_type = value_var->get_data_type();
+
+                switch (value_type)
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    movsxd rcx, dword ptr [rip + " << index_text << "]\n";
+                    asm_stream << "    mov edx, " << operand_of(value_var, 4, allocation) << "\n";
+                    asm_stream << "    mov dword ptr [rax" << index_address << "], edx\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx rcx, byte ptr [rip + " << index_text << "]\n";
+                    asm_stream << load_asm("movzx", "edx", value_var, 1, allocation);
+                    asm_stream << "    mov byte ptr [rax" << index_address << "], dl\n";
+                    break;
+                case DataType::TYPE_REAL:
+                    asm_stream << load_asm("movss", "xmm0", value_var, 4, allocation);
+                    asm_stream << "    movss dword ptr [rax" << index_address << "], xmm0\n";
                     break;
                 default:
-                    throw std::runtime_error("Unsupported data type for vector index.");
+                    throw std::runtime_error("Unsupported data type for vector store operation.");
                 }
+                break;   
+            }
+        case TacType::TAC_ADDR:
+            {
+                const auto pointer_var = tac->get_result();
+                const auto vec_var = tac->get_first_operator();
+                const auto vec_text = get_label_or_text(vec_var);
 
                 asm_stream << "    lea rax, [rip + " << vec_text << "]\n";
+                const auto index_var = tac->get_second_operator();
+                if (has_tree)
+                {
+                    const auto [index_code, address] = index_tree_asm(tree->second, get_data_type_size(vec_var->get_data_type()), allocation);
+                    if (!address.empty())
+                    {
+                        asm_stream << index_code;
+                        asm_stream << "    lea rax, [rax" << address << "]\n";
+                    }
+                }
+                else if (index_var)
+                {
+                    switch (index_var->get_data_type())
+                    {
+                    case DataType::TYPE_INT:
+                        asm_stream << load_asm("movsxd", "rcx", index_var, 4, allocation);
+                        break;
+                    case DataType::TYPE_CHAR:
+                        asm_stream << load_asm("movzx", "rcx", index_var, 1, allocation);
+                        break;
+                    default:
+                        throw std::runtime_error("Unsupported data type for vector index.");
+                    }
+                    asm_stream << "    lea rax, [rax + rcx * " << get_data_type_size(vec_var->get_data_type()) << "]\n";
+                }
+                asm_stream << "    mov " << operand_of(pointer_var, 8, allocation) << ", rax\n";
+                break;
+            }
+        case TacType::TAC_PTRADD:
+            {
+                // The offset is a byte count, added as an immediate when it is a literal. Pointers in
+                // registers are added to in place.
+                const auto result_var = tac->get_result();
+                const auto offset_var = tac->get_second_operator();
+                auto offset = std::string("rcx");
+                if (is_immediate(offset_var))
+                {
+                    offset = immediate_of(offset_var);
+                }
+                else
+                {
+                    asm_stream << load_asm("movsxd", "rcx", offset_var, 4, allocation);
+                }
+                const auto result_reg = pointer_register(result_var, allocation);
+                const auto target = result_reg.empty() ? std::string("rax") : result_reg;
+                const auto base = operand_of(tac->get_first_operator(), 8, allocation);
+                if (base != target)
+                {
+                    asm_stream << "    mov " << target << ", " << base << "\n";
+                }
+                asm_stream << "    add " << target << ", " << offset << "\n";
+                if (result_reg.empty())
+                {
+                    asm_stream << "    mov " << operand_of(result_var, 8, allocation) << ", rax\n";
+                }
+                break;
+            }
+        case TacType::TAC_PTRLOAD:
+            {
+                const auto result_var = tac->get_result();
+                // Values in registers are loaded straight from the pointer, the others through the scratch registers
+                const auto result_reg = allocation.registers.find(result_var);
+                const auto in_register = result_reg != allocation.registers.end();
 
+                auto pointer_reg = pointer_register(tac->get_first_operator(), allocation);
+                if (pointer_reg.empty())
+                {
+                    asm_stream << "    mov rax, " << operand_of(tac->get_first_operator(), 8, allocation) << "\n";
+                    pointer_reg = "rax";
+                }
+                const auto address = " ptr [" + pointer_reg + "]";
+                switch (result_var->get_data_type())
+                {
+                case DataType::TYPE_INT:
+                    if (in_register)
+                    {
+                        asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", dword" << address << "\n";
+                        break;
+                    }
+                    asm_stream << "    mov eax, dword" << address << "\n";
+                    asm_stream << "    mov " << operand_of(result_var, 4, allocation) << ", eax\n";
+                    break;
+                case DataType::TYPE_CHAR:
+                    if (in_register)
+                    {
+                        asm_stream << "    movzx " << register_with_size(result_reg->second, 4) << ", byte" << address << "\n";
+                        break;
+                    }
+                    asm_stream << "    movzx eax, byte" << address << "\n";
+                    asm_stream << store_byte_asm(result_var, allocation);
+                    break;
+                case DataType::TYPE_REAL:
+                    if (in_register)
+                    {
+                        asm_stream << "    movss " << result_reg->second << ", dword" << address << "\n";
+                        break;
+                    }
+                    asm_stream << "    movss xmm0, dword" << address << "\n";
+                    asm_stream << "    movss " << operand_of(result_var, 4, allocation) << ", xmm0\n";
+                    break;
+                default:
+                    throw std::runtime_error("Unsupported data type for pointer load operation.");
+                }
+                break;
+            }
+        case TacType::TAC_PTRSTORE:
+            {
                 const auto value_var = tac->get_first_operator();
-                const auto value_text = get_label_or_text(value_var);
-                const auto value_type = value_var->get_data_type();
 
-                switch (value_type)
+                auto pointer_reg = pointer_register(tac->get_result(), allocation);
+                if (pointer_reg.empty())
+                {
+                    asm_stream << "    mov rax, " << operand_of(tac->get_result(), 8, allocation) << "\n";
+                    pointer_reg = "rax";
+                }
+                const auto address = " ptr [" + pointer_reg + "]";
+                switch (value_var->get_data_type())
                 {
                 case DataType::TYPE_INT:
-                    asm_stream << "    mov edx, dword ptr [rip + " << value_text << "]\n";
-                    asm_stream << "    mov dword ptr [rax + rcx * " << get_data_type_size(value_type) << "], edx\n";
+                    // Immediates and registers are stored as they are, memory goes through edx
+                    if (is_immediate(value_var) || allocation.registers.count(value_var))
+                    {
+                        asm_stream << "    mov dword" << address << ", " << operand_of(value_var, 4, allocation) << "\n";
+                        break;
+                    }
+                    asm_stream << "    mov edx, " << operand_of(value_var, 4, allocation) << "\n";
+                    asm_stream << "    mov dword" << address << ", edx\n";
                     break;
                 case DataType::TYPE_CHAR:
-                    asm_stream << "    movzx edx, byte ptr [rip + " << value_text << "]\n";
-                    asm_stream << "    mov byte ptr [rax + rcx * " << get_data_type_size(value_type) << "], dl\n";
+                    asm_stream << load_asm("movzx", "edx", value_var, 1, allocation);
+                    asm_stream << "    mov byte" << address << ", dl\n";
                     break;
                 case DataType::TYPE_REAL:
-                    asm_stream << "    movss xmm0, dword ptr [rip + " << value_text << "]\n";
-                    asm_stream << "    movss dword ptr [rax + rcx * " << get_data_type_size(value_type) << "], xmm0\n";
+                    asm_stream << load_asm("movss", "xmm0", value_var, 4, allocation);
+                    asm_stream << "    movss dword" << address << ", xmm0\n";
                     break;
                 default:
-                    throw std::runtime_error("Unsupported data type for vector store operation.");
+                    throw std::runtime_error("Unsupported data type for pointer store operation.");
                 }
-                break;   
+                break;
+            }
+        case TacType::TAC_PACKED_LOAD:
+        case TacType::TAC_PACKED_STORE:
+        case TacType::TAC_BROADCAST:
+            asm_stream << packed_asm(tac, options.avx2, allocation);
+            break;
+        case TacType::TAC_EXTRACT:
+            {
+                // Every lane of the packed values that are reduced is 4 bytes long
+                const auto lane = std::stol(tac->get_second_operator()->get_text());
+                const auto offset = lane == 0 ? "" : " + " + std::to_string(lane * 4);
+                asm_stream << "    mov eax, dword ptr [rip + " << get_label_or_text(tac->get_first_operator()) << offset << "]\n";
+                // The lanes of a real sum go to an xmm register through movd
+                const auto move = in_xmm_register(tac->get_result(), allocation) ? "movd" : "mov";
+                asm_stream << "    " << move << " " << operand_of(tac->get_result(), 4, allocation) << ", eax\n";
+                break;
+            }
+        case TacType::TAC_FILL:
+            {
+                const auto value_var = tac->get_first_operator();
+
+                asm_stream << "    mov rdi, " << operand_of(tac->get_result(), 8, allocation) << "\n";
+                switch (value_var->get_data_type())
+                {
+                case DataType::TYPE_INT:
+                case DataType::TYPE_REAL:
+                    if (value_var->is_literal() && value_var->get_data_type() == DataType::TYPE_REAL)
+                    {
+                        // rep stosd stores the bits of the real
+                        asm_stream << "    mov eax, " << value_representation(value_var->get_text(), DataType::TYPE_REAL) << "\n";
+                    }
+                    else
+                    {
+                        asm_stream << "    " << (in_xmm_register(value_var, allocation) ? "movd" : "mov") << " eax, " << operand_of(value_var, 4, allocation) << "\n";
+                    }
+                    asm_stream << load_asm("movsxd", "rcx", tac->get_second_operator(), 4, allocation);
+                    asm_stream << "    rep stosd\n";
+                    break;
+                case DataType::TYPE_CHAR:
+                    asm_stream << load_asm("movzx", "esi", value_var, 1, allocation);
+                    asm_stream << load_asm("movsxd", "rdx", tac->get_second_operator(), 4, allocation);
+                    asm_stream << "    call memset\n";
+                    break;
+                default:
+                    throw std::runtime_error("Unsupported data type for fill operation.");
+                }
+                break;
+            }
+        case TacType::TAC_BOUNDS:
+            {
+                // A negative index compares as a large unsigned one, so one jae covers both ends
+                const auto index_var = tac->get_first_operator();
+                if (index_var->get_data_type() == DataType::TYPE_CHAR)
+                {
+                    asm_stream << load_asm("movzx", "eax", index_var, 1, allocation);
+                }
+                else
+                {
+                    asm_stream << "    mov eax, " << operand_of(index_var, 4, allocation) << "\n";
+                }
+                asm_stream << "    cmp eax, " << tac->get_second_operator()->get_text() << "\n";
+                asm_stream << "    jae .Lbounds_trap\n";
+                has_bounds_checks = true;
+                break;
+            }
+        case TacType::TAC_COPY:
+            {
+                // The count of a COPY is in bytes
+                asm_stream << "    mov rdi, " << operand_of(tac->get_result(), 8, allocation) << "\n";
+                asm_stream << "    mov rsi, " << operand_of(tac->get_first_operator(), 8, allocation) << "\n";
+                asm_stream << load_asm("movsxd", "rdx", tac->get_second_operator(), 4, allocation);
+                asm_stream << "    call memcpy\n";
+                break;
             }
         default:
             break;
         }
+
+        // Clearing the upper halves of the ymm registers after a run of AVX code spares the SSE
+        // code that follows the penalty for mixing both
+        const auto ends_avx = index + 1 == tac_list.size() || !is_packed_tac(tac_list[index + 1]);
+        if (options.avx2 && is_packed_tac(tac) && ends_avx)
+        {
+            asm_stream << "    vzeroupper\n";
+        }
+    }
+
+    // Every failed bounds check jumps here, still aligned like the function body it came from
+    if (has_bounds_checks)
+    {
+        asm_stream << ".Lbounds_trap:\n";
+        asm_stream << "    mov rdi, qword ptr [rip + stderr]\n";
+        asm_stream << "    lea rsi, [rip + .Lbounds_message]\n";
+        asm_stream << "    xor eax, eax\n";
+        asm_stream << "    call fprintf\n";
+        asm_stream << "    mov edi, 1\n";
+        asm_stream << "    call exit\n";
+        asm_stream << "    .section .rodata\n";
+        asm_stream << ".Lbounds_message:\n";
+        asm_stream << "    .string \"Vector index out of bounds\\n\"\n";
+        asm_stream << "    .text\n";
     }
 
     return asm_stream.str();
@@ -724,7 +2319,8 @@ int get_processed_string_length(std::string_view s) {
     return length;
 }
 
-std::string literals_asm(const SymbolTable &symbol_table)
+// Only the literals the functions still read from memory are emitted, once per label
+std::string literals_asm(const SymbolTable &symbol_table, const std::string &functions_text)
 {
     std::stringstream asm_stream;
     // asm_stream << ".data\n";
@@ -736,12 +2332,18 @@ std::string literals_asm(const SymbolTable &symbol_table)
 
     const auto literals = filtered_table_entries(symbol_table, literal_filter);
 
+    std::set<std::string> emitted;
     for (const auto &entry : literals)
     {
         const auto &symbol = entry;
         const auto text = symbol->get_text();
         const auto data_type = symbol->get_data_type();
         const auto label = get_label_or_text(symbol);
+        // Every read of a literal is a rip relative address that ends with its label
+        if (functions_text.find(label + "]") == std::string::npos || !emitted.insert(label).second)
+        {
+            continue;
+        }
         const auto size_in_bytes = symbol->type == SymbolType::SYMBOL_STRING
             ? get_processed_string_length(text) + 1 // +1 for null terminator
             : get_data_type_size(data_type);
@@ -759,50 +2361,71 @@ std::string literals_asm(const SymbolTable &symbol_table)
         asm_stream << "    .size " << label << ", " << size_in_bytes << "\n";
     }
 
-    // return ".L.str.int";
-    // return ".L.str.char";
-    // return ".L.str.real";
-    // Always preload the printf strings
-    asm_stream << "\n.L.str.int:\n";
-    asm_stream << "    .asciz \"%d\"\n";
-    asm_stream << "    .size .L.str.int, 3\n";
-
-    asm_stream << "\n.L.str.char:\n";
-    asm_stream << "    .asciz \"%c\"\n";
-    asm_stream << "    .size .L.str.char, 3\n";
-
-    asm_stream << "\n.L.str.scanf_char:\n";
-    asm_stream << "    .asciz \" %c\"\n"; // Space before %c to skip whitespace
-    asm_stream << "    .size .L.str.scanf_char, 4\n";
-
-    asm_stream << "\n.L.str.real:\n";
-    asm_stream << "    .asciz \"%f\"\n";
-    asm_stream << "    .size .L.str.real, 3\n\n";
+    // The formats of printf and scanf, only the ones some call passes
+    const std::vector<std::pair<std::string, std::string>> formats = {
+        {".L.str.int", "\"%d\""},
+        {".L.str.char", "\"%c\""},
+        {".L.str.scanf_char", "\" %c\""}, // Space before %c to skip whitespace
+        {".L.str.real", "\"%f\""},
+    };
+    for (const auto &[label, format] : formats)
+    {
+        if (functions_text.find(label + "]") == std::string::npos)
+        {
+            continue;
+        }
+        asm_stream << "\n" << label << ":\n";
+        asm_stream << "    .asciz " << format << "\n";
+        asm_stream << "    .size " << label << ", " << format.size() - 1 << "\n";
+    }
+    asm_stream << "\n";
 
     return asm_stream.str();
 }
 
-std::string temporaries_asm(const SymbolTable &symbol_table)
+// Temporaries and parameters some function still reads from memory, the others are kept in registers or in the frame
+std::vector<SymbolTableEntry> memory_temporaries(const SymbolTable &symbol_table, const std::set<SymbolTableEntry> &in_memory)
+{
+    const auto temp_filter = [&](const SymbolTableEntry &entry) { return in_memory.count(entry) != 0; };
+    return filtered_table_entries(symbol_table, temp_filter);
+}
+
+std::string temporaries_asm(const DataLayout &layout)
 {
     std::stringstream asm_stream;
     asm_stream << "    .bss\n"; // Uninitialized data section for temporaries
 
-    const auto temp_filter = [](const SymbolTableEntry &entry) {
-        return (entry->ident_type == IdentType::IDENT_VAR && entry->type == SymbolType::SYMBOL_TEMP)
-            || entry->ident_type == IdentType::IDENT_PARAM;
-    };
-
-    const auto temporaries = filtered_table_entries(symbol_table, temp_filter);
-
-    for (const auto &entry : temporaries)
+    std::string owner;
+    for (size_t i = 0; i < layout.temporaries.size(); ++i)
     {
-        const auto &symbol = entry;
-        const auto temp_name = symbol->get_text();
-        const auto temp_type = symbol->get_data_type();
-        const auto size_in_bytes = get_data_type_size(temp_type);
+        const auto &item = layout.temporaries[i];
+        // The temporaries of each function start a cache line
+        if (i == 0 || item.owner != owner)
+        {
+            asm_stream << "    .p2align 6\n";
+            owner = item.owner;
+        }
+        if (item.alignment > 1)
+        {
+            asm_stream << "    .balign " << item.alignment << "\n";
+        }
+        const auto temp_name = item.symbol->get_text();
+        const auto temp_type = item.symbol->get_data_type();
         asm_stream << temp_name << ":\n";
-        asm_stream << "    " << get_storage_type(temp_type) << " 0\n"; // Initialize to zero
-        asm_stream << "    .size " << temp_name << ", " << size_in_bytes << "\n";
+        if (is_packed_type(temp_type))
+        {
+            asm_stream << "    .zero " << item.size << "\n";
+        }
+        else
+        {
+            asm_stream << "    " << get_storage_type(temp_type) << " 0\n"; // Initialize to zero
+            const auto size = static_cast<size_t>(get_data_type_size(temp_type));
+            if (size < item.size)
+            {
+                asm_stream << "    .zero " << item.size - size << "\n";
+            }
+        }
+        asm_stream << "    .size " << temp_name << ", " << item.size << "\n";
     }
 
     return asm_stream.str();
@@ -3,5 +3,6 @@
 
 #include "symbol.hpp"
 #include "tac.hpp"
+#include "optimizer.hpp"
 
-std::string generate_asm(const TACList tac_list, const SymbolTable &symbol_table);
+std::string generate_asm(const TACList tac_list, const SymbolTable &symbol_table, const OptimizerOptions &options = OptimizerOptions());
@@ -109,6 +109,11 @@ void Node::add_child(NodePtr child)
     children.insert(children.begin(), child);
 }
 
+void Node::replace_child(size_t index, NodePtr child)
+{
+    children.at(index) = child;
+}
+
 std::string Node::tree_string(size_t level) const
 {
     std::stringstream ss;
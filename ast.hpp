@@ -76,6 +76,8 @@ public:
         : children(children), line_number(line_number) {}
 
     void add_child(NodePtr child);
+    // Puts another subtree in place of a child, for the passes that rewrite expressions
+    void replace_child(size_t index, NodePtr child);
 
     const NodeList &get_children() const
     {
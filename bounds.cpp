@@ -0,0 +1,533 @@
+#include "bounds.hpp"
+
+// bounds.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "induction.hpp"
+#include "unroll.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <set>
+
+// Visits to a block after which growing bounds jump to the next constant of the function
+static constexpr size_t WIDEN_AFTER_VISITS = 3;
+// Passes that shrink the widened ranges back with the branch conditions
+static constexpr size_t NARROWING_PASSES = 2;
+
+static constexpr long INT_LOW = INT32_MIN;
+static constexpr long INT_HIGH = INT32_MAX;
+
+// Values an integer may hold, both ends included
+typedef struct ValueRange
+{
+    long low;
+    long high;
+
+    bool operator==(const ValueRange &other) const { return low == other.low && high == other.high; }
+} ValueRange;
+
+// Integers not in the map may hold any value of their type
+typedef std::map<SymbolTableEntry, ValueRange> RangeMap;
+
+TACList insert_bounds_checks(const TACList &tac_list)
+{
+    std::map<SymbolTableEntry, SymbolTableEntry> sizes;
+    for (const auto &tac : tac_list)
+    {
+        if (tac->get_type() == TAC_VECEND)
+        {
+            sizes[tac->get_result()] = tac->get_first_operator();
+        }
+    }
+
+    TACList checked;
+    for (const auto &tac : tac_list)
+    {
+        const auto type = tac->get_type();
+        if (type == TAC_VECLOAD || type == TAC_VECSTORE)
+        {
+            const auto vector = type == TAC_VECLOAD ? tac->get_first_operator() : tac->get_result();
+            checked.push_back(make_tac(TAC_BOUNDS, vector, tac->get_second_operator(), sizes.at(vector)));
+        }
+        checked.push_back(tac);
+    }
+    TAC::relink(checked);
+    return checked;
+}
+
+std::map<SymbolTableEntry, long> initial_values(const Program &program, const CallGraph &call_graph, const ControlFlowGraph &cfg)
+{
+    // Only main starts with the globals as declared, and only if nothing calls it again
+    const auto main = call_graph.function_index.find(cfg.function_name());
+    if (cfg.function_name() != "_main" || main == call_graph.function_index.end())
+    {
+        return {};
+    }
+    for (const auto &callees : call_graph.callees)
+    {
+        if (callees.count(main->second))
+        {
+            return {};
+        }
+    }
+
+    std::map<SymbolTableEntry, long> values;
+    const auto &declarations = program.declarations;
+    for (size_t i = 0; i + 1 < declarations.size(); ++i)
+    {
+        const auto variable = declarations[i]->get_result();
+        const auto &init = declarations[i + 1];
+        if (declarations[i]->get_type() == TAC_VARBEGIN && init->get_type() == TAC_VARINIT && variable->get_data_type() == TYPE_INT
+            && is_int_literal(init->get_result()))
+        {
+            values[variable] = std::stol(init->get_result()->get_text());
+        }
+    }
+    return values;
+}
+
+ValueRange range_of(const RangeMap &ranges, const SymbolTableEntry &symbol)
+{
+    if (is_int_literal(symbol))
+    {
+        const auto value = std::stol(symbol->get_text());
+        return {value, value};
+    }
+    const auto found = ranges.find(symbol);
+    if (found != ranges.end())
+    {
+        return found->second;
+    }
+    // Characters are loaded with movzx, so they are never negative
+    if (symbol->get_data_type() == TYPE_CHAR)
+    {
+        return {0, 255};
+    }
+    return {INT_LOW, INT_HIGH};
+}
+
+// Stores the range, or forgets the symbol when the int could wrap around or hold anything
+void set_range(RangeMap &ranges, const SymbolTableEntry &symbol, const ValueRange range)
+{
+    const auto wraps = range.low < INT_LOW || range.high > INT_HIGH;
+    if (wraps || (range.low == INT_LOW && range.high == INT_HIGH))
+    {
+        ranges.erase(symbol);
+        return;
+    }
+    ranges[symbol] = range;
+}
+
+ValueRange definition_range(const RangeMap &ranges, const TACptr &tac)
+{
+    const auto type = tac->get_type();
+    if (tac->is_relational())
+    {
+        return {0, 1};
+    }
+    const auto first = tac->get_first_operator();
+    const auto second = tac->get_second_operator();
+    switch (type)
+    {
+    case TAC_MOVE:
+        return range_of(ranges, first);
+    case TAC_ADD:
+    case TAC_SUB:
+    case TAC_MUL:
+    case TAC_MIN:
+    case TAC_MAX:
+        break;
+    case TAC_DIV:
+    case TAC_MOD:
+        {
+            // Only division by a positive constant keeps the order of the values
+            const auto divisor = is_int_literal(second) ? std::stol(second->get_text()) : 0;
+            const auto dividend = range_of(ranges, first);
+            if (divisor <= 0)
+            {
+                return {INT_LOW, INT_HIGH};
+            }
+            if (type == TAC_DIV)
+            {
+                return {dividend.low / divisor, dividend.high / divisor};
+            }
+            // The remainder has the sign of the dividend
+            return {dividend.low >= 0 ? 0 : 1 - divisor, std::min(std::max(dividend.high, 0L), divisor - 1)};
+        }
+    default:
+        return {INT_LOW, INT_HIGH};
+    }
+
+    const auto a = range_of(ranges, first);
+    const auto b = range_of(ranges, second);
+    switch (type)
+    {
+    case TAC_ADD: return {a.low + b.low, a.high + b.high};
+    case TAC_SUB: return {a.low - b.high, a.high - b.low};
+    case TAC_MIN: return {std::min(a.low, b.low), std::min(a.high, b.high)};
+    case TAC_MAX: return {std::max(a.low, b.low), std::max(a.high, b.high)};
+    default:
+        {
+            const auto products = {a.low * b.low, a.low * b.high, a.high * b.low, a.high * b.high};
+            return {std::min(products), std::max(products)};
+        }
+    }
+}
+
+void transfer(RangeMap &ranges, const TACptr &tac, const CallSummaries &summaries, const std::string &caller)
+{
+    const auto type = tac->get_type();
+    // Without a summary the called function may change any variable, and recursion reuses the temporaries
+    if (type == TAC_CALL)
+    {
+        const auto summary = summaries.of_call(caller, tac);
+        if (!summary)
+        {
+            ranges.clear();
+        }
+        else
+        {
+            for (const auto &written : summary->writes)
+            {
+                ranges.erase(written);
+            }
+        }
+    }
+    if (type == TAC_BOUNDS && !tac->get_first_operator()->is_literal())
+    {
+        // Past the check the index is inside the vector
+        const auto index = tac->get_first_operator();
+        const auto range = range_of(ranges, index);
+        const auto size = std::stol(tac->get_second_operator()->get_text());
+        set_range(ranges, index, {std::max(range.low, 0L), std::min(range.high, size - 1)});
+        return;
+    }
+    const auto definition = tac->get_definition();
+    if (!definition)
+    {
+        return;
+    }
+    if (definition->get_data_type() != TYPE_INT)
+    {
+        ranges.erase(definition);
+        return;
+    }
+    set_range(ranges, definition, definition_range(ranges, tac));
+}
+
+// Narrows the operands of "first REL second" to the values that make it true.
+// Returns false when no values can.
+bool assume_comparison(RangeMap &ranges, TacType type, SymbolTableEntry first, SymbolTableEntry second)
+{
+    if (type == TAC_GT || type == TAC_GE)
+    {
+        type = mirrored_comparison(type);
+        std::swap(first, second);
+    }
+    auto a = range_of(ranges, first);
+    auto b = range_of(ranges, second);
+    switch (type)
+    {
+    case TAC_LT:
+        a.high = std::min(a.high, b.high - 1);
+        b.low = std::max(b.low, a.low + 1);
+        break;
+    case TAC_LE:
+        a.high = std::min(a.high, b.high);
+        b.low = std::max(b.low, a.low);
+        break;
+    case TAC_EQ:
+        a = b = {std::max(a.low, b.low), std::min(a.high, b.high)};
+        break;
+    default:
+        return true;
+    }
+    if (a.low > a.high || b.low > b.high)
+    {
+        return false;
+    }
+    for (const auto &[symbol, range] : {std::make_pair(first, a), std::make_pair(second, b)})
+    {
+        if (!symbol->is_literal() && symbol->get_data_type() == TYPE_INT)
+        {
+            set_range(ranges, symbol, range);
+        }
+    }
+    return true;
+}
+
+// A compared temporary set in the block from "x + c", "x - c" or x also limits x, as long as x
+// keeps its value until the comparison
+void refine_offset_source(RangeMap &ranges, const TACList &tacs, const SymbolTableEntry &compared)
+{
+    if (!compared->is_temporary())
+    {
+        return;
+    }
+    for (size_t i = tacs.size() - 2; i-- > 0;)
+    {
+        const auto &tac = tacs[i];
+        if (tac->get_definition() != compared)
+        {
+            continue;
+        }
+        auto source = tac->get_first_operator();
+        auto other = tac->get_second_operator();
+        long offset = 0;
+        switch (tac->get_type())
+        {
+        case TAC_MOVE:
+            break;
+        case TAC_ADD:
+            if (is_int_literal(source))
+            {
+                std::swap(source, other);
+            }
+            [[fallthrough]];
+        case TAC_SUB:
+            if (!is_int_literal(other))
+            {
+                return;
+            }
+            offset = tac->get_type() == TAC_ADD ? std::stol(other->get_text()) : -std::stol(other->get_text());
+            break;
+        default:
+            return;
+        }
+        if (source->is_literal() || source->get_data_type() != TYPE_INT)
+        {
+            return;
+        }
+        for (size_t j = i + 1; j < tacs.size(); ++j)
+        {
+            if (tacs[j]->get_definition() == source || tacs[j]->get_type() == TAC_CALL)
+            {
+                return;
+            }
+        }
+        const auto range = range_of(ranges, compared);
+        const auto current = range_of(ranges, source);
+        // On a wrap around the temporary is far from x + c
+        if (current.low + offset < INT_LOW || current.high + offset > INT_HIGH)
+        {
+            return;
+        }
+        const ValueRange shifted = {std::max(current.low, range.low - offset), std::min(current.high, range.high - offset)};
+        if (shifted.low <= shifted.high)
+        {
+            set_range(ranges, source, shifted);
+        }
+        return;
+    }
+}
+
+// Ranges on the edge from the end of the block to the successor, nullopt if it can not be taken
+std::optional<RangeMap> edge_ranges(const ControlFlowGraph &cfg, const size_t block, const RangeMap &ranges, const size_t successor)
+{
+    const auto &tacs = cfg.blocks[block].tacs;
+    const auto branch = cfg.blocks[block].get_terminator();
+    if (!branch || branch->get_type() != TAC_IFZ || tacs.size() < 2)
+    {
+        return ranges;
+    }
+    const auto taken = cfg.find_label_block(branch->get_result());
+    const auto &compare = tacs[tacs.size() - 2];
+    const auto first = compare->get_first_operator();
+    const auto second = compare->get_second_operator();
+    if (taken == block + 1 || !compare->is_relational() || compare->get_result() != branch->get_first_operator()
+        || first->get_data_type() != TYPE_INT || second->get_data_type() != TYPE_INT)
+    {
+        return ranges;
+    }
+
+    // IFZ jumps when the comparison is false and falls through when it is true
+    auto refined = ranges;
+    const auto type = successor == taken ? opposite_comparison(compare->get_type()) : compare->get_type();
+    if (!assume_comparison(refined, type, first, second))
+    {
+        return std::nullopt;
+    }
+    refine_offset_source(refined, tacs, first);
+    refine_offset_source(refined, tacs, second);
+    return refined;
+}
+
+RangeMap join_ranges(const RangeMap &a, const RangeMap &b)
+{
+    RangeMap joined;
+    for (const auto &[symbol, range] : a)
+    {
+        const auto other = b.find(symbol);
+        if (other != b.end())
+        {
+            set_range(joined, symbol, {std::min(range.low, other->second.low), std::max(range.high, other->second.high)});
+        }
+    }
+    return joined;
+}
+
+// Constants a growing bound may stop at: the literals of the function and their neighbours,
+// so a counter tested against a literal keeps a bound it can not wrap around from
+std::set<long> widening_thresholds(const ControlFlowGraph &cfg)
+{
+    std::set<long> thresholds = {INT_LOW, INT_HIGH};
+    for (const auto &block : cfg.blocks)
+    {
+        for (const auto &tac : block.tacs)
+        {
+            for (const auto &operand : {tac->get_first_operator(), tac->get_second_operator()})
+            {
+                if (!operand || !is_int_literal(operand))
+                {
+                    continue;
+                }
+                const auto value = std::stol(operand->get_text());
+                for (const auto threshold : {value - 1, value, value + 1})
+                {
+                    thresholds.insert(std::clamp(threshold, INT_LOW, INT_HIGH));
+                }
+            }
+        }
+    }
+    return thresholds;
+}
+
+// Bounds that keep growing jump to the next threshold, so loops reach a fixed point
+RangeMap widen_ranges(const RangeMap &old_ranges, const RangeMap &new_ranges, const std::set<long> &thresholds)
+{
+    RangeMap widened;
+    for (const auto &[symbol, range] : new_ranges)
+    {
+        const auto old = range_of(old_ranges, symbol);
+        auto low = range.low;
+        auto high = range.high;
+        if (low < old.low)
+        {
+            low = *std::prev(thresholds.upper_bound(low));
+        }
+        if (high > old.high)
+        {
+            high = *thresholds.lower_bound(high);
+        }
+        set_range(widened, symbol, {low, high});
+    }
+    return widened;
+}
+
+std::vector<std::optional<RangeMap>> analyze_ranges(const ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &entry_values,
+                                                    const CallSummaries &summaries)
+{
+    std::vector<std::optional<RangeMap>> in(cfg.blocks.size());
+    RangeMap entry;
+    for (const auto &[symbol, value] : entry_values)
+    {
+        set_range(entry, symbol, {value, value});
+    }
+    in[0] = entry;
+
+    const auto thresholds = widening_thresholds(cfg);
+    const auto caller = cfg.function_name();
+    const auto order = cfg.reverse_postorder();
+    const auto block_out = [&](const size_t block) {
+        auto ranges = *in[block];
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            transfer(ranges, tac, summaries, caller);
+        }
+        return ranges;
+    };
+
+    std::vector<size_t> visits(cfg.blocks.size(), 0);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto block : order)
+        {
+            if (!in[block])
+            {
+                continue;
+            }
+            const auto out = block_out(block);
+            for (const auto successor : cfg.blocks[block].successors)
+            {
+                const auto edge = edge_ranges(cfg, block, out, successor);
+                if (!edge)
+                {
+                    continue;
+                }
+                auto joined = in[successor] ? join_ranges(*in[successor], *edge) : *edge;
+                if (in[successor] && ++visits[successor] > WIDEN_AFTER_VISITS)
+                {
+                    joined = widen_ranges(*in[successor], joined, thresholds);
+                }
+                if (!in[successor] || joined != *in[successor])
+                {
+                    in[successor] = joined;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // The widened ranges hold, recomputing them from the predecessors only makes them tighter
+    for (size_t pass = 0; pass < NARROWING_PASSES; ++pass)
+    {
+        for (const auto block : order)
+        {
+            if (block == 0 || !in[block])
+            {
+                continue;
+            }
+            std::optional<RangeMap> joined;
+            for (const auto predecessor : cfg.blocks[block].predecessors)
+            {
+                if (!in[predecessor])
+                {
+                    continue;
+                }
+                const auto edge = edge_ranges(cfg, predecessor, block_out(predecessor), block);
+                if (edge)
+                {
+                    joined = joined ? join_ranges(*joined, *edge) : *edge;
+                }
+            }
+            if (joined)
+            {
+                in[block] = joined;
+            }
+        }
+    }
+    return in;
+}
+
+void eliminate_bounds_checks(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &entry_values, const CallSummaries &summaries)
+{
+    const auto in = analyze_ranges(cfg, entry_values, summaries);
+    const auto caller = cfg.function_name();
+    for (size_t block = 0; block < cfg.blocks.size(); ++block)
+    {
+        if (!in[block])
+        {
+            continue;
+        }
+        auto ranges = *in[block];
+        TACList kept;
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            if (tac->get_type() == TAC_BOUNDS)
+            {
+                const auto range = range_of(ranges, tac->get_first_operator());
+                const auto size = std::stol(tac->get_second_operator()->get_text());
+                if (range.low >= 0 && range.high < size)
+                {
+                    continue;
+                }
+            }
+            transfer(ranges, tac, summaries, caller);
+            kept.push_back(tac);
+        }
+        cfg.blocks[block].tacs = kept;
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// bounds.hpp file made by Ian Kersz Amaral - 2025/1
+// Vector bounds checking: with --bounds-check every vector access is preceded by a BOUNDS
+// TAC that stops the program when the index is outside the declared size. A range analysis
+// over each function then removes the checks whose index is known to always be inside.
+
+#include "cfg.hpp"
+#include "summaries.hpp"
+
+// Puts a BOUNDS before each VECLOAD and VECSTORE, with the size of the vector from its VECEND
+TACList insert_bounds_checks(const TACList &tac_list);
+
+// Integer values the variables are known to have when the function starts
+std::map<SymbolTableEntry, long> initial_values(const Program &program, const CallGraph &call_graph, const ControlFlowGraph &cfg);
+
+void eliminate_bounds_checks(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &entry_values, const CallSummaries &summaries);
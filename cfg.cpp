@@ -0,0 +1,700 @@
+#include "cfg.hpp"
+
+// cfg.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <sstream>
+#include <algorithm>
+#include <functional>
+
+SymbolTableEntry BasicBlock::get_label() const
+{
+    if (!tacs.empty() && tacs.front()->get_type() == TAC_LABEL)
+    {
+        return tacs.front()->get_result();
+    }
+    return nullptr;
+}
+
+TACptr BasicBlock::get_terminator() const
+{
+    if (!tacs.empty() && tacs.back()->is_block_terminator())
+    {
+        return tacs.back();
+    }
+    return nullptr;
+}
+
+ControlFlowGraph ControlFlowGraph::build(const TACList &function_tacs)
+{
+    if (function_tacs.size() < 2 || function_tacs.front()->get_type() != TAC_BEGINFUN || function_tacs.back()->get_type() != TAC_ENDFUN)
+    {
+        throw std::runtime_error("Control flow graph must be built from a BEGINFUN to an ENDFUN.");
+    }
+
+    ControlFlowGraph cfg;
+    cfg.begin_function = function_tacs.front();
+    cfg.end_function = function_tacs.back();
+
+    BasicBlock current;
+    for (size_t i = 1; i + 1 < function_tacs.size(); ++i)
+    {
+        const auto &tac = function_tacs[i];
+        // Symbol TACs only carry operands for the generator, they produce no code
+        if (tac->get_type() == TAC_SYMBOL)
+        {
+            continue;
+        }
+
+        // A label always starts a new block
+        if (tac->get_type() == TAC_LABEL && !current.tacs.empty())
+        {
+            cfg.blocks.push_back(current);
+            current = BasicBlock();
+        }
+
+        current.tacs.push_back(tac);
+
+        if (tac->is_block_terminator())
+        {
+            cfg.blocks.push_back(current);
+            current = BasicBlock();
+        }
+    }
+
+    if (!current.tacs.empty() || cfg.blocks.empty())
+    {
+        cfg.blocks.push_back(current);
+    }
+
+    cfg.connect_blocks();
+    return cfg;
+}
+
+size_t ControlFlowGraph::find_label_block(const SymbolTableEntry &label) const
+{
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (blocks[i].get_label() == label)
+        {
+            return i;
+        }
+    }
+    return NO_BLOCK;
+}
+
+void ControlFlowGraph::connect_blocks()
+{
+    std::map<SymbolTableEntry, size_t> label_blocks;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        blocks[i].predecessors.clear();
+        blocks[i].successors.clear();
+        const auto label = blocks[i].get_label();
+        if (label)
+        {
+            label_blocks[label] = i;
+        }
+    }
+
+    const auto add_edge = [this](size_t from, size_t to) {
+        auto &successors = blocks[from].successors;
+        if (std::find(successors.begin(), successors.end(), to) == successors.end())
+        {
+            successors.push_back(to);
+            blocks[to].predecessors.push_back(from);
+        }
+    };
+
+    const auto target_of = [&label_blocks](const TACptr &tac) {
+        const auto found = label_blocks.find(tac->get_result());
+        if (found == label_blocks.end())
+        {
+            throw std::runtime_error("Jump to a label outside of its function: " + tac->get_result()->get_text());
+        }
+        return found->second;
+    };
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const auto terminator = blocks[i].get_terminator();
+        const auto falls_through = i + 1 < blocks.size();
+        if (!terminator)
+        {
+            if (falls_through)
+            {
+                add_edge(i, i + 1);
+            }
+            continue;
+        }
+
+        switch (terminator->get_type())
+        {
+        case TAC_JUMP:
+            add_edge(i, target_of(terminator));
+            break;
+        case TAC_IFZ:
+            if (falls_through)
+            {
+                add_edge(i, i + 1);
+            }
+            add_edge(i, target_of(terminator));
+            break;
+        default:
+            // RET leaves the function
+            break;
+        }
+    }
+
+    compute_dominators();
+}
+
+std::vector<size_t> ControlFlowGraph::reverse_postorder() const
+{
+    std::vector<size_t> postorder;
+    std::vector<bool> visited(blocks.size(), false);
+
+    // Iterative depth first search, so deep graphs do not overflow the stack
+    std::vector<std::pair<size_t, size_t>> stack;
+    if (!blocks.empty())
+    {
+        stack.push_back({0, 0});
+        visited[0] = true;
+    }
+    while (!stack.empty())
+    {
+        auto &[block, next_successor] = stack.back();
+        if (next_successor < blocks[block].successors.size())
+        {
+            const auto successor = blocks[block].successors[next_successor++];
+            if (!visited[successor])
+            {
+                visited[successor] = true;
+                stack.push_back({successor, 0});
+            }
+        }
+        else
+        {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    std::reverse(postorder.begin(), postorder.end());
+    return postorder;
+}
+
+// Iterative algorithm from Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+void ControlFlowGraph::compute_dominators()
+{
+    const auto order = reverse_postorder();
+    std::vector<size_t> order_index(blocks.size(), NO_BLOCK);
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order_index[order[i]] = i;
+    }
+
+    std::vector<size_t> idom(blocks.size(), NO_BLOCK);
+    if (!blocks.empty())
+    {
+        idom[0] = 0;
+    }
+
+    const auto intersect = [&idom, &order_index](size_t first, size_t second) {
+        while (first != second)
+        {
+            while (order_index[first] > order_index[second])
+            {
+                first = idom[first];
+            }
+            while (order_index[second] > order_index[first])
+            {
+                second = idom[second];
+            }
+        }
+        return first;
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto block : order)
+        {
+            if (block == 0)
+            {
+                continue;
+            }
+            size_t new_idom = NO_BLOCK;
+            for (const auto predecessor : blocks[block].predecessors)
+            {
+                if (idom[predecessor] == NO_BLOCK)
+                {
+                    continue;
+                }
+                new_idom = new_idom == NO_BLOCK ? predecessor : intersect(predecessor, new_idom);
+            }
+            if (new_idom != idom[block])
+            {
+                idom[block] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    if (!blocks.empty())
+    {
+        idom[0] = NO_BLOCK;
+    }
+    immediate_dominators = idom;
+
+    dominator_children.assign(blocks.size(), {});
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (idom[i] != NO_BLOCK)
+        {
+            dominator_children[idom[i]].push_back(i);
+        }
+    }
+}
+
+bool ControlFlowGraph::is_reachable(size_t block) const
+{
+    return block == 0 || immediate_dominators[block] != NO_BLOCK;
+}
+
+bool ControlFlowGraph::dominates(size_t dominator, size_t block) const
+{
+    if (!is_reachable(block))
+    {
+        return false;
+    }
+    while (block != NO_BLOCK)
+    {
+        if (block == dominator)
+        {
+            return true;
+        }
+        block = immediate_dominators[block];
+    }
+    return false;
+}
+
+std::vector<Loop> ControlFlowGraph::find_loops() const
+{
+    std::map<size_t, Loop> loops_by_header;
+    for (size_t block = 0; block < blocks.size(); ++block)
+    {
+        for (const auto successor : blocks[block].successors)
+        {
+            if (!dominates(successor, block))
+            {
+                continue;
+            }
+
+            // Back edge, the loop is everything that reaches the latch without going through the header
+            auto &loop = loops_by_header[successor];
+            loop.header = successor;
+            loop.blocks.insert(successor);
+            loop.latches.push_back(block);
+
+            std::vector<size_t> stack{block};
+            while (!stack.empty())
+            {
+                const auto current = stack.back();
+                stack.pop_back();
+                if (!loop.blocks.insert(current).second)
+                {
+                    continue;
+                }
+                for (const auto predecessor : blocks[current].predecessors)
+                {
+                    if (is_reachable(predecessor))
+                    {
+                        stack.push_back(predecessor);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<Loop> loops;
+    for (const auto &[header, loop] : loops_by_header)
+    {
+        loops.push_back(loop);
+    }
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop &first, const Loop &second) {
+        return first.blocks.size() < second.blocks.size();
+    });
+    return loops;
+}
+
+std::vector<size_t> ControlFlowGraph::loop_exits(const Loop &loop) const
+{
+    std::vector<size_t> exits;
+    for (const auto block : loop.blocks)
+    {
+        for (const auto successor : blocks[block].successors)
+        {
+            if (!loop.contains(successor) && std::find(exits.begin(), exits.end(), successor) == exits.end())
+            {
+                exits.push_back(successor);
+            }
+        }
+    }
+    return exits;
+}
+
+SymbolTableEntry ControlFlowGraph::ensure_label(size_t block)
+{
+    const auto label = blocks[block].get_label();
+    if (label)
+    {
+        return label;
+    }
+    const auto label_tac = make_tac_label();
+    blocks[block].tacs.insert(blocks[block].tacs.begin(), label_tac);
+    return label_tac->get_result();
+}
+
+size_t ControlFlowGraph::insert_preheader(const Loop &loop)
+{
+    const auto header = loop.header;
+    const auto header_label = ensure_label(header);
+
+    BasicBlock preheader;
+    const auto preheader_label_tac = make_tac_label();
+    const auto preheader_label = preheader_label_tac->get_result();
+    preheader.tacs.push_back(preheader_label_tac);
+
+    std::vector<BasicBlock> new_blocks;
+    for (const auto predecessor : blocks[header].predecessors)
+    {
+        const auto terminator = blocks[predecessor].get_terminator();
+        const auto jumps_to_header = terminator && terminator->get_type() != TAC_RET && terminator->get_result() == header_label;
+        if (!loop.contains(predecessor))
+        {
+            // Entries into the loop now go through the preheader
+            if (jumps_to_header)
+            {
+                terminator->set_result(preheader_label);
+            }
+        }
+        else if (predecessor + 1 == header && !(terminator && terminator->get_type() == TAC_JUMP))
+        {
+            // A latch that used to fall into the header must now jump over the preheader
+            BasicBlock jump_back;
+            jump_back.tacs.push_back(make_tac(TAC_JUMP, header_label));
+            new_blocks.push_back(jump_back);
+        }
+    }
+    new_blocks.push_back(preheader);
+
+    blocks.insert(blocks.begin() + static_cast<long>(header), new_blocks.begin(), new_blocks.end());
+    connect_blocks();
+    return header + new_blocks.size() - 1;
+}
+
+std::vector<std::set<SymbolTableEntry>> ControlFlowGraph::live_in(const std::set<SymbolTableEntry> &globals) const
+{
+    const auto live_at_exit = function_name() == "_main" ? std::set<SymbolTableEntry>() : globals;
+
+    std::vector<std::set<SymbolTableEntry>> live(blocks.size());
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = blocks.size(); i-- > 0;)
+        {
+            const auto &block = blocks[i];
+            auto current = block.successors.empty() ? live_at_exit : std::set<SymbolTableEntry>();
+            for (const auto successor : block.successors)
+            {
+                current.insert(live[successor].begin(), live[successor].end());
+            }
+            for (auto it = block.tacs.rbegin(); it != block.tacs.rend(); ++it)
+            {
+                const auto &tac = *it;
+                const auto definition = tac->get_definition();
+                if (definition)
+                {
+                    current.erase(definition);
+                }
+                if (tac->get_type() == TAC_CALL)
+                {
+                    current.insert(globals.begin(), globals.end());
+                }
+                for (const auto &use : tac->get_uses())
+                {
+                    if (!use->is_literal())
+                    {
+                        current.insert(use);
+                    }
+                }
+            }
+            if (current != live[i])
+            {
+                live[i] = current;
+                changed = true;
+            }
+        }
+    }
+    return live;
+}
+
+std::string ControlFlowGraph::function_name() const
+{
+    return begin_function->get_result()->get_text();
+}
+
+std::vector<SymbolTableEntry> ControlFlowGraph::parameters() const
+{
+    return function_parameters(begin_function->get_result());
+}
+
+std::vector<SymbolTableEntry> function_parameters(const SymbolTableEntry &function)
+{
+    // The semantic analysis leaves the parameter list in the function symbol
+    std::vector<SymbolTableEntry> parameters;
+    const auto parameter_list = function->get_node();
+    if (!parameter_list)
+    {
+        return parameters;
+    }
+    for (const auto &declaration : parameter_list.value()->get_children())
+    {
+        parameters.push_back(to_symbol_node(declaration->get_children()[1])->get_symbol());
+    }
+    return parameters;
+}
+
+TACList ControlFlowGraph::flatten() const
+{
+    TACList tac_list{begin_function};
+    for (const auto &block : blocks)
+    {
+        tac_list.insert(tac_list.end(), block.tacs.begin(), block.tacs.end());
+    }
+    tac_list.push_back(end_function);
+    return tac_list;
+}
+
+std::string ControlFlowGraph::to_string() const
+{
+    std::stringstream ss;
+    ss << "CFG of " << function_name() << "\n";
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        ss << "  Block " << i << " (idom ";
+        if (immediate_dominators[i] == NO_BLOCK)
+        {
+            ss << "none";
+        }
+        else
+        {
+            ss << immediate_dominators[i];
+        }
+        ss << ") ->";
+        for (const auto successor : blocks[i].successors)
+        {
+            ss << " " << successor;
+        }
+        ss << "\n";
+        for (const auto &tac : blocks[i].tacs)
+        {
+            ss << "    " << tac->to_string() << "\n";
+        }
+    }
+    return ss.str();
+}
+
+Program Program::split(const TACList &tac_list)
+{
+    Program program;
+
+    size_t i = 0;
+    for (; i < tac_list.size(); ++i)
+    {
+        program.declarations.push_back(tac_list[i]);
+        if (tac_list[i]->get_type() == TAC_BEGINCODE)
+        {
+            ++i;
+            break;
+        }
+    }
+
+    TACList function_tacs;
+    for (; i < tac_list.size(); ++i)
+    {
+        const auto &tac = tac_list[i];
+        if (tac->get_type() == TAC_BEGINFUN)
+        {
+            function_tacs = {tac};
+        }
+        else if (!function_tacs.empty())
+        {
+            function_tacs.push_back(tac);
+            if (tac->get_type() == TAC_ENDFUN)
+            {
+                program.functions.push_back(ControlFlowGraph::build(function_tacs));
+                function_tacs.clear();
+            }
+        }
+        // Symbol TACs of the global declarations are left out, they produce no code
+    }
+
+    return program;
+}
+
+std::map<SymbolTableEntry, long> Program::vector_sizes() const
+{
+    std::map<SymbolTableEntry, long> sizes;
+    for (const auto &tac : declarations)
+    {
+        if (tac->get_type() == TAC_VECEND)
+        {
+            sizes[tac->get_result()] = std::stol(tac->get_first_operator()->get_text());
+        }
+    }
+    return sizes;
+}
+
+std::set<SymbolTableEntry> Program::scalar_globals()
+{
+    const auto global_filter = [](const SymbolTableEntry &entry) {
+        return (entry->ident_type == IDENT_VAR && !entry->is_temporary() && entry->type != SYMBOL_LABEL)
+            || entry->ident_type == IDENT_PARAM;
+    };
+    const auto globals = filtered_table_entries(get_symbol_table(), global_filter);
+    return std::set<SymbolTableEntry>(globals.begin(), globals.end());
+}
+
+TACList Program::flatten() const
+{
+    TACList tac_list = declarations;
+    for (const auto &function : functions)
+    {
+        const auto function_tacs = function.flatten();
+        tac_list.insert(tac_list.end(), function_tacs.begin(), function_tacs.end());
+    }
+    TAC::relink(tac_list);
+    return tac_list;
+}
+
+CallGraph CallGraph::build(const Program &program)
+{
+    CallGraph graph;
+    const auto size = program.functions.size();
+    for (size_t i = 0; i < size; ++i)
+    {
+        graph.function_index[program.functions[i].function_name()] = i;
+    }
+    graph.callees.resize(size);
+    graph.recursive.resize(size, false);
+    graph.component.resize(size, 0);
+    for (size_t i = 0; i < size; ++i)
+    {
+        for (const auto &block : program.functions[i].blocks)
+        {
+            for (const auto &tac : block.tacs)
+            {
+                if (tac->get_type() != TAC_CALL)
+                {
+                    continue;
+                }
+                const auto callee = graph.function_index.find(tac->get_first_operator()->get_text());
+                if (callee != graph.function_index.end())
+                {
+                    graph.callees[i].insert(callee->second);
+                }
+            }
+        }
+    }
+
+    // Tarjan's strongly connected components, which come out callees first
+    std::vector<size_t> index(size, NO_BLOCK);
+    std::vector<size_t> lowlink(size, 0);
+    std::vector<bool> on_stack(size, false);
+    std::vector<size_t> stack;
+    size_t next_index = 0;
+    std::function<void(size_t)> connect = [&](size_t function) {
+        index[function] = lowlink[function] = next_index++;
+        stack.push_back(function);
+        on_stack[function] = true;
+        for (const auto callee : graph.callees[function])
+        {
+            if (index[callee] == NO_BLOCK)
+            {
+                connect(callee);
+                lowlink[function] = std::min(lowlink[function], lowlink[callee]);
+            }
+            else if (on_stack[callee])
+            {
+                lowlink[function] = std::min(lowlink[function], index[callee]);
+            }
+        }
+        if (lowlink[function] != index[function])
+        {
+            return;
+        }
+        std::vector<size_t> component;
+        size_t member;
+        do
+        {
+            member = stack.back();
+            stack.pop_back();
+            on_stack[member] = false;
+            component.push_back(member);
+        } while (member != function);
+
+        for (const auto current : component)
+        {
+            graph.component[current] = function;
+            graph.recursive[current] = component.size() > 1 || graph.callees[current].count(current) != 0;
+            graph.bottom_up_order.push_back(current);
+        }
+    };
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (index[i] == NO_BLOCK)
+        {
+            connect(i);
+        }
+    }
+    return graph;
+}
+
+// The ARG that passes each parameter of the call at the given position, empty if they can not be told apart
+std::vector<TACptr> find_call_arguments(const TACList &tacs, const size_t call, const std::vector<SymbolTableEntry> &parameters)
+{
+    const auto callee = tacs[call]->get_first_operator();
+    std::map<SymbolTableEntry, TACptr> arguments;
+    for (size_t i = call; i-- > 0 && arguments.size() < parameters.size();)
+    {
+        const auto &tac = tacs[i];
+        const auto type = tac->get_type();
+        if (type == TAC_LABEL || tac->is_block_terminator() || type == TAC_BEGINFUN)
+        {
+            break;
+        }
+        // A nested call to the same function also writes these parameters
+        if (type == TAC_CALL && tac->get_first_operator() == callee)
+        {
+            break;
+        }
+        const auto is_parameter = std::find(parameters.begin(), parameters.end(), tac->get_result()) != parameters.end();
+        if (type == TAC_ARG && is_parameter && !arguments.count(tac->get_result()))
+        {
+            arguments[tac->get_result()] = tac;
+        }
+    }
+    if (arguments.size() != parameters.size())
+    {
+        return {};
+    }
+    std::vector<TACptr> ordered;
+    for (const auto &parameter : parameters)
+    {
+        ordered.push_back(arguments.at(parameter));
+    }
+    return ordered;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// cfg.hpp file made by Ian Kersz Amaral - 2025/1
+// Control flow graph over the TAC list of each function, used by the optimization passes.
+
+#include "symbol.hpp"
+#include "tac.hpp"
+
+#include <vector>
+#include <map>
+#include <set>
+#include <limits>
+
+static constexpr auto NO_BLOCK = std::numeric_limits<size_t>::max();
+
+typedef struct BasicBlock
+{
+    TACList tacs;
+    std::vector<size_t> predecessors;
+    std::vector<size_t> successors;
+
+    // Label that starts the block, nullptr if the block is only reached by falling through
+    SymbolTableEntry get_label() const;
+
+    // Last TAC of the block if it is a JUMP, IFZ or RET
+    TACptr get_terminator() const;
+} BasicBlock;
+
+typedef struct Loop
+{
+    size_t header;
+    std::set<size_t> blocks;
+    // Blocks inside the loop that jump back to the header
+    std::vector<size_t> latches;
+
+    bool contains(size_t block) const { return blocks.count(block) != 0; }
+} Loop;
+
+typedef struct ControlFlowGraph
+{
+    TACptr begin_function;
+    TACptr end_function;
+    // Blocks are kept in their original layout order, block 0 is the entry
+    std::vector<BasicBlock> blocks;
+    // Immediate dominator of each block, NO_BLOCK for the entry and for unreachable blocks
+    std::vector<size_t> immediate_dominators;
+    std::vector<std::vector<size_t>> dominator_children;
+
+    // Builds the graph of a single function, from its BEGINFUN up to its ENDFUN
+    static ControlFlowGraph build(const TACList &function_tacs);
+
+    // Recomputes the edges after a pass changes labels, jumps or the block order
+    void connect_blocks();
+
+    void compute_dominators();
+
+    bool dominates(size_t dominator, size_t block) const;
+
+    bool is_reachable(size_t block) const;
+
+    std::vector<size_t> reverse_postorder() const;
+
+    size_t find_label_block(const SymbolTableEntry &label) const;
+
+    // Natural loops, one per header, innermost loops first
+    std::vector<Loop> find_loops() const;
+
+    // Blocks outside the loop that its blocks branch to
+    std::vector<size_t> loop_exits(const Loop &loop) const;
+
+    // Adds an empty block right before the header that every entry into the loop goes through.
+    // Returns its index, the blocks from the header on are shifted by one.
+    size_t insert_preheader(const Loop &loop);
+
+    // Scalars live on entry to each block. Calls read the given globals, and so does
+    // whoever called this function when it returns, unless it is main.
+    std::vector<std::set<SymbolTableEntry>> live_in(const std::set<SymbolTableEntry> &globals) const;
+
+    // Makes the block start with a label, creating one if needed
+    SymbolTableEntry ensure_label(size_t block);
+
+    std::string function_name() const;
+
+    // Parameters in declaration order
+    std::vector<SymbolTableEntry> parameters() const;
+
+    TACList flatten() const;
+
+    std::string to_string() const;
+} ControlFlowGraph;
+
+typedef struct Program
+{
+    // BEGINVARS, the declarations and BEGINCODE
+    TACList declarations;
+    std::vector<ControlFlowGraph> functions;
+
+    static Program split(const TACList &tac_list);
+
+    // Declared number of elements of each vector
+    std::map<SymbolTableEntry, long> vector_sizes() const;
+
+    // Variables and parameters other functions can see, vectors excluded
+    static std::set<SymbolTableEntry> scalar_globals();
+
+    TACList flatten() const;
+} Program;
+
+typedef struct CallGraph
+{
+    std::map<std::string, size_t> function_index;
+    std::vector<std::set<size_t>> callees;
+    // Functions that can call themselves, directly or through others
+    std::vector<bool> recursive;
+    // Strongly connected component of each function, functions calling each other share one
+    std::vector<size_t> component;
+    // Every function comes after the functions it calls, except inside recursive cycles
+    std::vector<size_t> bottom_up_order;
+
+    static CallGraph build(const Program &program);
+} CallGraph;
+
+// Parameters of the function in declaration order, empty if it has none
+std::vector<SymbolTableEntry> function_parameters(const SymbolTableEntry &function);
+
+// The ARG that passes each parameter of the call at the given position, empty if they can not be told apart
+std::vector<TACptr> find_call_arguments(const TACList &tacs, size_t call, const std::vector<SymbolTableEntry> &parameters);
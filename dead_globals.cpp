@@ -0,0 +1,77 @@
+#include "dead_globals.hpp"
+
+// dead_globals.cpp file made by Ian Kersz Amaral - 2025/1
+
+void remove_unreachable_globals(Program &program)
+{
+    const auto call_graph = CallGraph::build(program);
+    const auto main_function = call_graph.function_index.find("_main");
+    if (main_function == call_graph.function_index.end())
+    {
+        return;
+    }
+
+    std::vector<bool> reachable(program.functions.size(), false);
+    std::vector<size_t> worklist = {main_function->second};
+    reachable[main_function->second] = true;
+    while (!worklist.empty())
+    {
+        const auto function = worklist.back();
+        worklist.pop_back();
+        for (const auto callee : call_graph.callees[function])
+        {
+            if (!reachable[callee])
+            {
+                reachable[callee] = true;
+                worklist.push_back(callee);
+            }
+        }
+    }
+
+    std::vector<ControlFlowGraph> functions;
+    std::set<SymbolTableEntry> mentioned;
+    for (size_t i = 0; i < program.functions.size(); ++i)
+    {
+        if (!reachable[i])
+        {
+            continue;
+        }
+        for (const auto &block : program.functions[i].blocks)
+        {
+            for (const auto &tac : block.tacs)
+            {
+                mentioned.insert({tac->get_result(), tac->get_first_operator(), tac->get_second_operator()});
+            }
+        }
+        functions.push_back(program.functions[i]);
+    }
+    program.functions = functions;
+
+    // Each declaration goes from its VARBEGIN or VECBEGIN to its VAREND or VECEND, which names it
+    TACList declarations;
+    TACList current;
+    for (const auto &tac : program.declarations)
+    {
+        const auto type = tac->get_type();
+        if (type == TAC_VARBEGIN || type == TAC_VECBEGIN)
+        {
+            current = {tac};
+            continue;
+        }
+        if (current.empty())
+        {
+            declarations.push_back(tac);
+            continue;
+        }
+        current.push_back(tac);
+        if (type == TAC_VAREND || type == TAC_VECEND)
+        {
+            if (mentioned.count(tac->get_result()) != 0)
+            {
+                declarations.insert(declarations.end(), current.begin(), current.end());
+            }
+            current.clear();
+        }
+    }
+    program.declarations = declarations;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// dead_globals.hpp file made by Ian Kersz Amaral - 2025/1
+// Whole program dead code elimination. The functions main can not reach through calls are
+// removed, and then the variables and vectors that no remaining function mentions, so neither
+// their code nor their data is emitted. Programs without a main are kept whole.
+
+#include "cfg.hpp"
+
+void remove_unreachable_globals(Program &program);
@@ -0,0 +1,236 @@
+#include "idioms.hpp"
+
+// idioms.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "unroll.hpp"
+#include "induction.hpp"
+#include "simplify_cfg.hpp"
+
+// Loops with fewer iterations than this are cheaper to unroll or vectorize than to fill or copy
+static constexpr long MIN_MEMORY_LOOP_TRIPS = 16;
+
+// Selection done by "if (value REL target) target = value", TAC_INVALID if it is not a minimum or maximum
+TacType select_of_comparison(const TACptr &compare, const SymbolTableEntry &value, const SymbolTableEntry &target)
+{
+    auto type = compare->get_type();
+    const auto first = compare->get_first_operator();
+    const auto second = compare->get_second_operator();
+    if (first == target && second == value)
+    {
+        type = mirrored_comparison(type);
+    }
+    else if (first != value || second != target)
+    {
+        return TAC_INVALID;
+    }
+
+    switch (type)
+    {
+    case TAC_GT: return TAC_MAX;
+    case TAC_LT: return TAC_MIN;
+    // Equal reals may still be 0 and -0, only the strict comparisons keep the same one as maxss and minss
+    case TAC_GE: return value->get_data_type() == TYPE_INT ? TAC_MAX : TAC_INVALID;
+    case TAC_LE: return value->get_data_type() == TYPE_INT ? TAC_MIN : TAC_INVALID;
+    default: return TAC_INVALID;
+    }
+}
+
+// The conditional part of an update rewritten to run every time, empty if it is not one.
+// The head ends with the comparison, the IFZ that skipped the update is already removed.
+TACList convert_update(TACList &head, const TACList &update, std::map<SymbolTableEntry, size_t> &uses)
+{
+    const auto compare = head.back();
+
+    // if (value > target) target = value
+    if (update.size() == 1 && update[0]->get_type() == TAC_MOVE)
+    {
+        const auto target = update[0]->get_result();
+        const auto value = update[0]->get_first_operator();
+        const auto type = target->get_data_type();
+        if (value->get_data_type() != type || (type != TYPE_INT && type != TYPE_REAL))
+        {
+            return {};
+        }
+        const auto select = select_of_comparison(compare, value, target);
+        if (select == TAC_INVALID)
+        {
+            return {};
+        }
+        head.pop_back();
+        const auto selected = register_temp(type);
+        return {make_tac(select, selected, value, target), make_tac(TAC_MOVE, target, selected, SymbolTableEntry())};
+    }
+
+    // if (condition) counter = counter + 1, adding the 0 or 1 of the comparison instead
+    if (update.size() == 2 && update[0]->get_type() == TAC_ADD && update[1]->get_type() == TAC_MOVE)
+    {
+        const auto sum = update[0]->get_result();
+        const auto counter = update[1]->get_result();
+        const auto first = update[0]->get_first_operator();
+        const auto second = update[0]->get_second_operator();
+        const auto one = first == counter ? second : first;
+        if (update[1]->get_first_operator() != sum || !sum->is_temporary() || uses[sum] != 1 || counter->get_data_type() != TYPE_INT
+            || (first != counter && second != counter) || !is_int_literal(one) || std::stol(one->get_text()) != 1)
+        {
+            return {};
+        }
+        const auto flag = register_temp(TYPE_INT);
+        head.back() = make_tac(compare->get_type(), flag, compare->get_first_operator(), compare->get_second_operator());
+        return {make_tac(TAC_ADD, sum, counter, flag), update[1]};
+    }
+    return {};
+}
+
+// "c = compare; IFZ L, c; update; LABEL L" where the update always does the same thing
+// becomes straight code, the blocks around it are merged afterwards
+bool convert_conditional_updates(ControlFlowGraph &cfg)
+{
+    auto uses = count_uses(cfg);
+    bool changed = false;
+    for (size_t i = 0; i + 2 < cfg.blocks.size(); ++i)
+    {
+        auto &head = cfg.blocks[i].tacs;
+        auto &update = cfg.blocks[i + 1];
+        const auto branch = cfg.blocks[i].get_terminator();
+        if (!branch || branch->get_type() != TAC_IFZ || head.size() < 2 || update.get_label() || update.get_terminator()
+            || branch->get_result() != cfg.blocks[i + 2].get_label())
+        {
+            continue;
+        }
+        const auto &compare = head[head.size() - 2];
+        const auto condition = branch->get_first_operator();
+        if (!compare->is_relational() || compare->get_result() != condition || !condition->is_temporary() || uses[condition] != 1)
+        {
+            continue;
+        }
+
+        // Value numbering leaves copies to temporaries nothing reads
+        TACList updating;
+        for (const auto &tac : update.tacs)
+        {
+            const auto definition = tac->get_definition();
+            if (!tac->is_pure() || !definition || !definition->is_temporary() || uses[definition] != 0)
+            {
+                updating.push_back(tac);
+            }
+        }
+
+        head.pop_back();
+        const auto converted = convert_update(head, updating, uses);
+        if (converted.empty())
+        {
+            head.push_back(branch);
+            continue;
+        }
+        update.tacs = converted;
+        changed = true;
+    }
+    if (changed)
+    {
+        cfg.connect_blocks();
+        simplify_control_flow(cfg);
+    }
+    return changed;
+}
+
+// "v[i] = x" with x the same in every iteration, or "d[i] = s[i]", is done for every index the
+// loop goes through at once:
+//   n = bound - i (+ 1); n = max(n, 1); p = &v[i]; FILL p, x, n; i = i + n
+bool replace_memory_loop(ControlFlowGraph &cfg, const CountedLoop &counted, std::map<SymbolTableEntry, size_t> &uses)
+{
+    const auto &counter = counted.counter;
+    const auto &body = counted.body;
+    if (counted.step != 1 || (counted.exit_test != TAC_GE && counted.exit_test != TAC_GT) || body.empty()
+        || !keeps_temporaries_inside(cfg, counted, uses))
+    {
+        return false;
+    }
+    const auto trips = trip_count(cfg, counted);
+    if (trips && *trips < MIN_MEMORY_LOOP_TRIPS)
+    {
+        return false;
+    }
+
+    const auto &store = body.back();
+    if (store->get_type() != TAC_VECSTORE || store->get_second_operator() != counter)
+    {
+        return false;
+    }
+    const auto destination = store->get_result();
+    const auto value = store->get_first_operator();
+    const auto element = destination->get_data_type();
+    SymbolTableEntry source;
+    if (body.size() == 2)
+    {
+        const auto &load = body[0];
+        if (load->get_type() != TAC_VECLOAD || load->get_result() != value || load->get_second_operator() != counter)
+        {
+            return false;
+        }
+        source = load->get_first_operator();
+        if (source == destination || source->get_data_type() != element)
+        {
+            return false;
+        }
+    }
+    else if (body.size() != 1 || value->get_data_type() != element || value == counter || value == counted.next)
+    {
+        return false;
+    }
+
+    TACList tacs;
+    auto count = register_temp(TYPE_INT);
+    tacs.push_back(make_tac(TAC_SUB, count, counted.bound, counter));
+    if (counted.exit_test == TAC_GT)
+    {
+        const auto inclusive = register_temp(TYPE_INT);
+        tacs.push_back(make_tac(TAC_ADD, inclusive, count, register_int_literal(1)));
+        count = inclusive;
+    }
+    // The body runs at least once, even if the counter already passed the bound
+    const auto iterations = register_temp(TYPE_INT);
+    tacs.push_back(make_tac(TAC_MAX, iterations, count, register_int_literal(1)));
+
+    const auto pointer = register_temp(TYPE_POINTER);
+    tacs.push_back(make_tac(TAC_ADDR, pointer, destination, counter));
+    if (source)
+    {
+        const auto source_pointer = register_temp(TYPE_POINTER);
+        tacs.push_back(make_tac(TAC_ADDR, source_pointer, source, counter));
+        const auto bytes = register_temp(TYPE_INT);
+        tacs.push_back(make_tac(TAC_MUL, bytes, iterations, register_int_literal(get_data_type_size(element))));
+        tacs.push_back(make_tac(TAC_COPY, pointer, source_pointer, bytes));
+    }
+    else
+    {
+        tacs.push_back(make_tac(TAC_FILL, pointer, value, iterations));
+    }
+    const auto last = register_temp(TYPE_INT);
+    tacs.push_back(make_tac(TAC_ADD, last, counter, iterations));
+    tacs.push_back(make_tac(TAC_MOVE, counter, last, SymbolTableEntry()));
+
+    cfg.blocks[counted.block].tacs = tacs;
+    cfg.connect_blocks();
+    return true;
+}
+
+void recognize_idioms(ControlFlowGraph &cfg)
+{
+    convert_conditional_updates(cfg);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        auto uses = count_uses(cfg);
+        for (const auto &loop : cfg.find_loops())
+        {
+            const auto counted = match_counted_loop(cfg, loop, uses);
+            if (counted && replace_memory_loop(cfg, *counted, uses))
+            {
+                changed = true;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// idioms.hpp file made by Ian Kersz Amaral - 2025/1
+// Loop idiom recognition: counted loops that only fill a vector with a value or copy one
+// vector into another become a single FILL or COPY, and conditional updates that keep the
+// smallest or largest value or count the elements matching a test become straight code, so
+// the vectorizer can turn their loops into reductions.
+
+#include "cfg.hpp"
+
+void recognize_idioms(ControlFlowGraph &cfg);
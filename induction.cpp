@@ -0,0 +1,446 @@
+#include "induction.hpp"
+
+// induction.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+#include <optional>
+
+// Value of the form factor * counter + offset
+typedef struct LinearForm
+{
+    long factor;
+    long offset;
+
+    bool operator==(const LinearForm &other) const
+    {
+        return factor == other.factor && offset == other.offset;
+    }
+} LinearForm;
+
+typedef struct VectorAccess
+{
+    TACptr tac;
+    LinearForm index;
+} VectorAccess;
+
+typedef struct InductionVariable
+{
+    SymbolTableEntry counter;
+    // MOVE of counter + step back into the counter, its only definition in the loop
+    TACptr increment;
+    size_t increment_block;
+    long step;
+    std::vector<VectorAccess> accesses;
+} InductionVariable;
+
+// Pointer that always holds the address of vector[index] for the current counter
+typedef struct PointerStream
+{
+    SymbolTableEntry vector;
+    LinearForm index;
+    SymbolTableEntry pointer;
+} PointerStream;
+
+bool is_int_literal(const SymbolTableEntry &symbol)
+{
+    return symbol && symbol->is_literal() && symbol->type == SYMBOL_INT;
+}
+
+bool is_relational(const TacType type)
+{
+    switch (type)
+    {
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Form of an ADD, SUB or MUL between an operand of known form and an integer literal
+std::optional<LinearForm> combine_linear_form(const TACptr &tac, const SymbolTableEntry &counter, const std::map<SymbolTableEntry, LinearForm> &forms)
+{
+    const auto type = tac->get_type();
+    if ((type != TAC_ADD && type != TAC_SUB && type != TAC_MUL) || tac->get_result()->get_data_type() != TYPE_INT)
+    {
+        return std::nullopt;
+    }
+
+    const auto form_of = [&](const SymbolTableEntry &operand) -> std::optional<LinearForm> {
+        if (operand == counter)
+        {
+            return LinearForm{1, 0};
+        }
+        const auto found = forms.find(operand);
+        if (found != forms.end())
+        {
+            return found->second;
+        }
+        return std::nullopt;
+    };
+
+    const auto first = tac->get_first_operator();
+    const auto second = tac->get_second_operator();
+    const auto first_form = form_of(first);
+    const auto second_form = form_of(second);
+
+    if (first_form && is_int_literal(second))
+    {
+        const auto [factor, offset] = *first_form;
+        const auto constant = std::stol(second->get_text());
+        switch (type)
+        {
+        case TAC_ADD: return LinearForm{factor, offset + constant};
+        case TAC_SUB: return LinearForm{factor, offset - constant};
+        default: return LinearForm{factor * constant, offset * constant};
+        }
+    }
+    if (second_form && is_int_literal(first))
+    {
+        const auto [factor, offset] = *second_form;
+        const auto constant = std::stol(first->get_text());
+        switch (type)
+        {
+        case TAC_ADD: return LinearForm{factor, constant + offset};
+        case TAC_SUB: return LinearForm{-factor, constant - offset};
+        default: return LinearForm{factor * constant, offset * constant};
+        }
+    }
+    return std::nullopt;
+}
+
+// Finds the increment of the counter and the vector accesses indexed by a linear form of it.
+// Forms are only tracked inside a block, from the point where the counter last changed.
+std::optional<InductionVariable> analyze_counter(const ControlFlowGraph &cfg, const Loop &loop, const SymbolTableEntry &counter)
+{
+    InductionVariable variable{counter, nullptr, 0, 0, {}};
+    for (const auto block : loop.blocks)
+    {
+        std::map<SymbolTableEntry, LinearForm> forms;
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            const auto type = tac->get_type();
+            if (type == TAC_VECLOAD || type == TAC_VECSTORE)
+            {
+                const auto index = tac->get_second_operator();
+                if (index == counter)
+                {
+                    variable.accesses.push_back({tac, LinearForm{1, 0}});
+                }
+                else if (forms.count(index))
+                {
+                    variable.accesses.push_back({tac, forms.at(index)});
+                }
+            }
+
+            const auto definition = tac->get_definition();
+            if (!definition)
+            {
+                continue;
+            }
+            if (definition == counter)
+            {
+                const auto source = type == TAC_MOVE ? forms.find(tac->get_first_operator()) : forms.end();
+                if (source == forms.end() || source->second.factor != 1 || source->second.offset == 0)
+                {
+                    return std::nullopt;
+                }
+                variable.increment = tac;
+                variable.increment_block = block;
+                variable.step = source->second.offset;
+                forms.clear();
+                continue;
+            }
+            forms.erase(definition);
+            const auto form = combine_linear_form(tac, counter, forms);
+            if (form)
+            {
+                forms[definition] = *form;
+            }
+        }
+    }
+
+    if (!variable.increment || variable.accesses.empty())
+    {
+        return std::nullopt;
+    }
+    return variable;
+}
+
+// Emits the TACs that compute factor * value + offset and returns the symbol holding it
+SymbolTableEntry emit_linear_form(const LinearForm &form, const SymbolTableEntry &value, TACList &tacs)
+{
+    if (is_int_literal(value))
+    {
+        return register_int_literal(form.factor * std::stol(value->get_text()) + form.offset);
+    }
+    auto current = value;
+    if (form.factor != 1)
+    {
+        const auto product = register_temp(TYPE_INT);
+        tacs.push_back(make_tac(TAC_MUL, product, current, register_int_literal(form.factor)));
+        current = product;
+    }
+    if (form.offset != 0)
+    {
+        const auto sum = register_temp(TYPE_INT);
+        tacs.push_back(make_tac(TAC_ADD, sum, current, register_int_literal(form.offset)));
+        current = sum;
+    }
+    return current;
+}
+
+// Removes loop TACs whose temporary is no longer read, like the old index computations
+void remove_unused_loop_temporaries(ControlFlowGraph &cfg, const Loop &loop)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        std::set<SymbolTableEntry> used;
+        for (const auto &block : cfg.blocks)
+        {
+            for (const auto &tac : block.tacs)
+            {
+                for (const auto &use : tac->get_uses())
+                {
+                    used.insert(use);
+                }
+            }
+        }
+        for (const auto block : loop.blocks)
+        {
+            auto &tacs = cfg.blocks[block].tacs;
+            const auto size = tacs.size();
+            tacs.erase(std::remove_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+                const auto definition = tac->get_definition();
+                return tac->is_pure() && definition && definition->is_temporary() && used.count(definition) == 0;
+            }), tacs.end());
+            changed = changed || tacs.size() != size;
+        }
+    }
+}
+
+// Linear function test replacement: when the counter is only read by its own increment and
+// the loop test, the test compares a pointer against the address at the bound instead and the
+// counter stops being updated. Pointers only keep the order of the counter when they move with it.
+void eliminate_counter(ControlFlowGraph &cfg, const Loop &loop, const InductionVariable &variable,
+                       const std::vector<PointerStream> &streams, const std::set<SymbolTableEntry> &globals, TACList &preheader_tacs)
+{
+    remove_unused_loop_temporaries(cfg, loop);
+
+    const auto counter = variable.counter;
+    const auto source = variable.increment->get_first_operator();
+
+    std::map<SymbolTableEntry, size_t> definitions;
+    std::map<SymbolTableEntry, size_t> use_counts;
+    for (const auto &block : cfg.blocks)
+    {
+        for (const auto &tac : block.tacs)
+        {
+            for (const auto &use : tac->get_uses())
+            {
+                use_counts[use]++;
+            }
+        }
+    }
+    for (const auto block : loop.blocks)
+    {
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            const auto definition = tac->get_definition();
+            if (definition)
+            {
+                definitions[definition]++;
+            }
+        }
+    }
+
+    TACptr step_tac = nullptr;
+    TACptr test = nullptr;
+    for (const auto block : loop.blocks)
+    {
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            const auto uses = tac->get_uses();
+            if (std::find(uses.begin(), uses.end(), counter) == uses.end() || tac == variable.increment)
+            {
+                continue;
+            }
+            if (tac->get_result() == source && !step_tac)
+            {
+                step_tac = tac;
+            }
+            else if (is_relational(tac->get_type()) && !test)
+            {
+                test = tac;
+            }
+            else
+            {
+                return;
+            }
+        }
+    }
+
+    if (!step_tac || !source->is_temporary() || use_counts[source] != 1)
+    {
+        return;
+    }
+
+    const auto live = cfg.live_in(globals);
+    for (const auto exit : cfg.loop_exits(loop))
+    {
+        if (live[exit].count(counter))
+        {
+            return;
+        }
+    }
+
+    if (test)
+    {
+        const auto counter_first = test->get_first_operator() == counter;
+        const auto bound = counter_first ? test->get_second_operator() : test->get_first_operator();
+        const auto bound_is_invariant = is_int_literal(bound) || (!bound->is_literal() && definitions.count(bound) == 0);
+        if (bound == counter || bound->get_data_type() != TYPE_INT || !bound_is_invariant)
+        {
+            return;
+        }
+        const auto stream = std::find_if(streams.begin(), streams.end(), [](const PointerStream &candidate) {
+            return candidate.index.factor > 0;
+        });
+        if (stream == streams.end())
+        {
+            return;
+        }
+
+        const auto end = register_temp(TYPE_POINTER);
+        const auto end_index = emit_linear_form(stream->index, bound, preheader_tacs);
+        preheader_tacs.push_back(make_tac(TAC_ADDR, end, stream->vector, end_index));
+        test->set_first_operator(counter_first ? stream->pointer : end);
+        test->set_second_operator(counter_first ? end : stream->pointer);
+    }
+
+    for (const auto block : loop.blocks)
+    {
+        auto &tacs = cfg.blocks[block].tacs;
+        tacs.erase(std::remove_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+            return tac == step_tac || tac == variable.increment;
+        }), tacs.end());
+    }
+}
+
+void strength_reduce(ControlFlowGraph &cfg, const Loop &loop, const InductionVariable &variable, const std::set<SymbolTableEntry> &globals)
+{
+    std::vector<PointerStream> streams;
+    for (const auto &access : variable.accesses)
+    {
+        const auto &tac = access.tac;
+        const auto is_load = tac->get_type() == TAC_VECLOAD;
+        const auto vector = is_load ? tac->get_first_operator() : tac->get_result();
+
+        auto stream = std::find_if(streams.begin(), streams.end(), [&](const PointerStream &candidate) {
+            return candidate.vector == vector && candidate.index == access.index;
+        });
+        if (stream == streams.end())
+        {
+            streams.push_back({vector, access.index, register_temp(TYPE_POINTER)});
+            stream = streams.end() - 1;
+        }
+
+        if (is_load)
+        {
+            tac->set_type(TAC_PTRLOAD);
+            tac->set_first_operator(stream->pointer);
+            tac->set_second_operator(nullptr);
+        }
+        else
+        {
+            tac->set_type(TAC_PTRSTORE);
+            tac->set_result(stream->pointer);
+            tac->set_second_operator(nullptr);
+        }
+    }
+
+    // Every pointer moves together with the counter
+    auto &increment_tacs = cfg.blocks[variable.increment_block].tacs;
+    auto position = std::find(increment_tacs.begin(), increment_tacs.end(), variable.increment) + 1;
+    for (const auto &stream : streams)
+    {
+        const auto element_size = get_data_type_size(stream.vector->get_data_type());
+        const auto distance = register_int_literal(stream.index.factor * variable.step * element_size);
+        position = increment_tacs.insert(position, make_tac(TAC_PTRADD, stream.pointer, stream.pointer, distance)) + 1;
+    }
+
+    TACList preheader_tacs;
+    for (const auto &stream : streams)
+    {
+        const auto index = emit_linear_form(stream.index, variable.counter, preheader_tacs);
+        preheader_tacs.push_back(make_tac(TAC_ADDR, stream.pointer, stream.vector, index));
+    }
+
+    eliminate_counter(cfg, loop, variable, streams, globals, preheader_tacs);
+
+    const auto preheader = cfg.insert_preheader(loop);
+    auto &tacs = cfg.blocks[preheader].tacs;
+    tacs.insert(tacs.end(), preheader_tacs.begin(), preheader_tacs.end());
+}
+
+bool reduce_loop(ControlFlowGraph &cfg, const Loop &loop, const std::set<SymbolTableEntry> &globals)
+{
+    // Counters are globals, a call could change them behind our back
+    std::map<SymbolTableEntry, size_t> definitions;
+    std::vector<SymbolTableEntry> candidates;
+    for (const auto block : loop.blocks)
+    {
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            if (tac->get_type() == TAC_CALL)
+            {
+                return false;
+            }
+            const auto definition = tac->get_definition();
+            if (definition && definitions[definition]++ == 0 && tac->get_type() == TAC_MOVE)
+            {
+                candidates.push_back(definition);
+            }
+        }
+    }
+
+    for (const auto &counter : candidates)
+    {
+        if (definitions[counter] != 1 || counter->get_data_type() != TYPE_INT)
+        {
+            continue;
+        }
+        const auto variable = analyze_counter(cfg, loop, counter);
+        if (variable)
+        {
+            strength_reduce(cfg, loop, *variable, globals);
+            return true;
+        }
+    }
+    return false;
+}
+
+void reduce_induction_variables(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto &loop : cfg.find_loops())
+        {
+            // The preheader shifts the blocks, so the loops are found again after each change
+            if (reduce_loop(cfg, loop, globals))
+            {
+                changed = true;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// induction.hpp file made by Ian Kersz Amaral - 2025/1
+// Induction variable strength reduction: vector accesses whose index is a linear function
+// of a loop counter walk a pointer instead, and the counter is removed when only the loop
+// test still needs it.
+
+#include "cfg.hpp"
+
+bool is_int_literal(const SymbolTableEntry &symbol);
+
+void reduce_induction_variables(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals);
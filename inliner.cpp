@@ -0,0 +1,169 @@
+#include "inliner.hpp"
+
+// inliner.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+
+// The call and the return, on top of one ARG per parameter
+static constexpr size_t CALL_OVERHEAD = 2;
+
+size_t function_size(const ControlFlowGraph &function)
+{
+    size_t size = 0;
+    for (const auto &block : function.blocks)
+    {
+        size += static_cast<size_t>(std::count_if(block.tacs.begin(), block.tacs.end(), [](const TACptr &tac) {
+            return tac->get_type() != TAC_LABEL;
+        }));
+    }
+    return size;
+}
+
+// Callee body with fresh temporaries and labels, its returns write the result of the call
+TACList copy_body(const ControlFlowGraph &callee, const std::map<SymbolTableEntry, SymbolTableEntry> &parameter_temporaries, const SymbolTableEntry &result)
+{
+    std::map<SymbolTableEntry, SymbolTableEntry> renamed = parameter_temporaries;
+    const auto rename = [&](const SymbolTableEntry &symbol) -> SymbolTableEntry {
+        if (!symbol)
+        {
+            return symbol;
+        }
+        const auto found = renamed.find(symbol);
+        if (found != renamed.end())
+        {
+            return found->second;
+        }
+        if (symbol->is_temporary())
+        {
+            return renamed[symbol] = register_temp(symbol->get_data_type());
+        }
+        if (symbol->type == SYMBOL_LABEL)
+        {
+            return renamed[symbol] = register_label();
+        }
+        return symbol;
+    };
+
+    TACList body;
+    for (const auto &block : callee.blocks)
+    {
+        body.insert(body.end(), block.tacs.begin(), block.tacs.end());
+    }
+
+    TACList copy;
+    const auto end_label = make_tac_label();
+    bool needs_end_label = false;
+    for (size_t i = 0; i < body.size(); ++i)
+    {
+        const auto &tac = body[i];
+        if (tac->get_type() == TAC_RET)
+        {
+            copy.push_back(make_tac(TAC_MOVE, result, rename(tac->get_result()), SymbolTableEntry()));
+            if (i + 1 < body.size())
+            {
+                copy.push_back(make_tac(TAC_JUMP, end_label->get_result()));
+                needs_end_label = true;
+            }
+            continue;
+        }
+        copy.push_back(make_tac(tac->get_type(), rename(tac->get_result()), rename(tac->get_first_operator()), rename(tac->get_second_operator())));
+    }
+    if (needs_end_label)
+    {
+        copy.push_back(end_label);
+    }
+    return copy;
+}
+
+bool returns_match(const ControlFlowGraph &callee, const SymbolTableEntry &result)
+{
+    for (const auto &block : callee.blocks)
+    {
+        const auto terminator = block.get_terminator();
+        if (terminator && terminator->get_type() == TAC_RET && terminator->get_result()->get_data_type() != result->get_data_type())
+        {
+            // Returns convert through eax, a MOVE between different types would not
+            return false;
+        }
+    }
+    return true;
+}
+
+void inline_calls(Program &program, const CallGraph &graph, const size_t caller, const unsigned threshold)
+{
+    auto &function = program.functions[caller];
+
+    const auto loops = function.find_loops();
+    std::map<TACptr, size_t> loop_depth;
+    for (size_t block = 0; block < function.blocks.size(); ++block)
+    {
+        const auto depth = static_cast<size_t>(std::count_if(loops.begin(), loops.end(), [&](const Loop &loop) {
+            return loop.contains(block);
+        }));
+        for (const auto &tac : function.blocks[block].tacs)
+        {
+            loop_depth[tac] = depth;
+        }
+    }
+
+    TACList tacs = function.flatten();
+    const auto initial_size = function_size(function);
+    auto current_size = initial_size;
+    // Inlining stops once the caller grew this much
+    const auto growth_limit = 4 * static_cast<size_t>(threshold);
+
+    TACList result;
+    for (size_t i = 0; i < tacs.size(); ++i)
+    {
+        const auto &tac = tacs[i];
+        if (tac->get_type() != TAC_CALL)
+        {
+            result.push_back(tac);
+            continue;
+        }
+
+        const auto found = graph.function_index.find(tac->get_first_operator()->get_text());
+        if (found == graph.function_index.end() || graph.recursive[found->second] || found->second == caller)
+        {
+            result.push_back(tac);
+            continue;
+        }
+        const auto &callee = program.functions[found->second];
+        const auto parameters = callee.parameters();
+        const auto arguments = find_call_arguments(tacs, i, parameters);
+
+        // Calls in loops run more often, so they are worth a bigger body
+        const auto size = function_size(callee);
+        const auto budget = (threshold + parameters.size() + CALL_OVERHEAD) * (1 + loop_depth[tac]);
+        const auto grown = current_size + size;
+        const auto profitable = size <= budget && grown <= initial_size + growth_limit;
+        if (arguments.size() != parameters.size() || !profitable || !returns_match(callee, tac->get_result()))
+        {
+            result.push_back(tac);
+            continue;
+        }
+
+        std::map<SymbolTableEntry, SymbolTableEntry> parameter_temporaries;
+        for (size_t p = 0; p < parameters.size(); ++p)
+        {
+            const auto temporary = register_temp(parameters[p]->get_data_type());
+            parameter_temporaries[parameters[p]] = temporary;
+            arguments[p]->set_type(TAC_MOVE);
+            arguments[p]->set_result(temporary);
+        }
+        const auto body = copy_body(callee, parameter_temporaries, tac->get_result());
+        result.insert(result.end(), body.begin(), body.end());
+        current_size = grown;
+    }
+
+    function = ControlFlowGraph::build(result);
+}
+
+void inline_functions(Program &program, const unsigned threshold)
+{
+    const auto graph = CallGraph::build(program);
+    for (const auto function : graph.bottom_up_order)
+    {
+        inline_calls(program, graph, function, threshold);
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// inliner.hpp file made by Ian Kersz Amaral - 2025/1
+// Replaces calls to small functions by a copy of their body. Parameters and temporaries
+// of the callee get fresh temporaries at every call site, functions that can reach
+// themselves through calls are never inlined.
+
+#include "cfg.hpp"
+
+// Functions up to threshold TACs are inlined anywhere, calls inside loops allow bigger ones
+void inline_functions(Program &program, unsigned threshold);
@@ -0,0 +1,241 @@
+#include "instruction.hpp"
+
+// instruction.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <array>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+// Names of each general purpose register by size: 8, 4, 2 and 1 bytes
+static const std::vector<std::array<std::string, 4>> REGISTER_FAMILIES = {
+    {"rax", "eax", "ax", "al"},
+    {"rbx", "ebx", "bx", "bl"},
+    {"rcx", "ecx", "cx", "cl"},
+    {"rdx", "edx", "dx", "dl"},
+    {"rsi", "esi", "si", "sil"},
+    {"rdi", "edi", "di", "dil"},
+    {"rbp", "ebp", "bp", "bpl"},
+    {"rsp", "esp", "sp", "spl"},
+    {"r8", "r8d", "r8w", "r8b"},
+    {"r9", "r9d", "r9w", "r9b"},
+    {"r10", "r10d", "r10w", "r10b"},
+    {"r11", "r11d", "r11w", "r11b"},
+    {"r12", "r12d", "r12w", "r12b"},
+    {"r13", "r13d", "r13w", "r13b"},
+    {"r14", "r14d", "r14w", "r14b"},
+    {"r15", "r15d", "r15w", "r15b"},
+};
+static const std::array<unsigned, 4> REGISTER_SIZES = {8, 4, 2, 1};
+
+// Family index and position by size of a general purpose register, or the family count if it is not one
+std::pair<size_t, size_t> find_register(const std::string &name)
+{
+    for (size_t family = 0; family < REGISTER_FAMILIES.size(); ++family)
+    {
+        for (size_t position = 0; position < REGISTER_SIZES.size(); ++position)
+        {
+            if (REGISTER_FAMILIES[family][position] == name)
+            {
+                return {family, position};
+            }
+        }
+    }
+    return {REGISTER_FAMILIES.size(), 0};
+}
+
+std::string trim(const std::string &text)
+{
+    const auto begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    const auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string register_with_size(const std::string &name, const unsigned size)
+{
+    const auto [family, position] = find_register(name);
+    if (family == REGISTER_FAMILIES.size())
+    {
+        throw std::runtime_error("Unknown register " + name + ".");
+    }
+    for (size_t i = 0; i < REGISTER_SIZES.size(); ++i)
+    {
+        if (REGISTER_SIZES[i] == size)
+        {
+            return REGISTER_FAMILIES[family][i];
+        }
+    }
+    throw std::runtime_error("Unsupported register size.");
+}
+
+Operand Operand::make_register(const std::string &name)
+{
+    if (name.rfind("xmm", 0) == 0)
+    {
+        return Operand{OPERAND_REGISTER, name, 16};
+    }
+    if (name.rfind("ymm", 0) == 0)
+    {
+        return Operand{OPERAND_REGISTER, name, 32};
+    }
+    const auto [family, position] = find_register(name);
+    if (family == REGISTER_FAMILIES.size())
+    {
+        throw std::runtime_error("Unknown register " + name + ".");
+    }
+    return Operand{OPERAND_REGISTER, name, REGISTER_SIZES[position]};
+}
+
+Operand Operand::parse(const std::string &text)
+{
+    const auto operand = trim(text);
+    const auto bracket = operand.find('[');
+    if (bracket != std::string::npos)
+    {
+        unsigned size = 0;
+        if (operand.rfind("byte", 0) == 0)
+        {
+            size = 1;
+        }
+        else if (operand.rfind("word", 0) == 0)
+        {
+            size = 2;
+        }
+        else if (operand.rfind("dword", 0) == 0)
+        {
+            size = 4;
+        }
+        else if (operand.rfind("qword", 0) == 0)
+        {
+            size = 8;
+        }
+        else if (operand.rfind("xmmword", 0) == 0)
+        {
+            size = 16;
+        }
+        else if (operand.rfind("ymmword", 0) == 0)
+        {
+            size = 32;
+        }
+        return Operand{OPERAND_MEMORY, operand.substr(bracket), size};
+    }
+    if (operand.rfind("xmm", 0) == 0 || operand.rfind("ymm", 0) == 0 || find_register(operand).first != REGISTER_FAMILIES.size())
+    {
+        return make_register(operand);
+    }
+    if (!operand.empty() && (std::isdigit(static_cast<unsigned char>(operand[0])) || operand[0] == '-'))
+    {
+        return Operand{OPERAND_IMMEDIATE, operand, 0};
+    }
+    return Operand{OPERAND_SYMBOL, operand, 0};
+}
+
+std::string Operand::to_string() const
+{
+    if (kind != OPERAND_MEMORY)
+    {
+        return text;
+    }
+    switch (size)
+    {
+    case 1: return "byte ptr " + text;
+    case 2: return "word ptr " + text;
+    case 4: return "dword ptr " + text;
+    case 8: return "qword ptr " + text;
+    case 16: return "xmmword ptr " + text;
+    case 32: return "ymmword ptr " + text;
+    default: return text;
+    }
+}
+
+bool Operand::same_register(const Operand &other) const
+{
+    if (!is_register() || !other.is_register())
+    {
+        return false;
+    }
+    if (is_xmm() || other.is_xmm())
+    {
+        // Each xmm register is the low half of the ymm register with the same number
+        return is_xmm() && other.is_xmm() && text.substr(3) == other.text.substr(3);
+    }
+    return find_register(text).first == find_register(other.text).first;
+}
+
+bool Operand::operator==(const Operand &other) const
+{
+    return kind == other.kind && text == other.text && size == other.size;
+}
+
+Instruction Instruction::parse(const std::string &line)
+{
+    const auto text = trim(line);
+    if (!text.empty() && text[0] != '#' && text.back() == ':')
+    {
+        return Instruction{INSTRUCTION_LABEL, text.substr(0, text.size() - 1), {}};
+    }
+    // Directives, comments and blank lines are kept as they are
+    if (text.empty() || text[0] == '.' || text[0] == '#')
+    {
+        return Instruction{INSTRUCTION_DIRECTIVE, line, {}};
+    }
+
+    const auto space = text.find(' ');
+    Instruction instruction{INSTRUCTION_OPERATION, text.substr(0, space), {}};
+    if (space == std::string::npos)
+    {
+        return instruction;
+    }
+    std::stringstream operands(text.substr(space + 1));
+    std::string operand;
+    while (std::getline(operands, operand, ','))
+    {
+        instruction.operands.push_back(Operand::parse(operand));
+    }
+    return instruction;
+}
+
+std::string Instruction::to_string() const
+{
+    switch (kind)
+    {
+    case INSTRUCTION_LABEL:
+        return opcode + ":";
+    case INSTRUCTION_DIRECTIVE:
+        return opcode;
+    case INSTRUCTION_OPERATION:
+        break;
+    }
+    std::string text = "    " + opcode;
+    for (size_t i = 0; i < operands.size(); ++i)
+    {
+        text += (i == 0 ? " " : ", ") + operands[i].to_string();
+    }
+    return text;
+}
+
+InstructionList parse_instructions(const std::string &text)
+{
+    InstructionList instructions;
+    std::stringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        instructions.push_back(Instruction::parse(line));
+    }
+    return instructions;
+}
+
+std::string instructions_to_string(const InstructionList &instructions)
+{
+    std::stringstream text;
+    for (const auto &instruction : instructions)
+    {
+        text << instruction.to_string() << "\n";
+    }
+    return text.str();
+}
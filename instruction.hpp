@@ -0,0 +1,78 @@
+#pragma once
+
+// instruction.hpp file made by Ian Kersz Amaral - 2025/1
+// Structured x86-64 instructions in Intel syntax, so the backend can inspect and rewrite its
+// output instead of working on text.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum OperandKind : uint8_t
+{
+    OPERAND_REGISTER,
+    OPERAND_IMMEDIATE,
+    OPERAND_MEMORY,
+    OPERAND_SYMBOL
+};
+
+typedef struct Operand
+{
+    OperandKind kind;
+    // Register name, immediate value, address with its brackets or symbol name
+    std::string text;
+    // Size in bytes of registers and memory accesses, 0 when it is not known
+    unsigned size;
+
+    static Operand parse(const std::string &text);
+    static Operand make_register(const std::string &name);
+
+    std::string to_string() const;
+
+    bool is_register() const { return kind == OPERAND_REGISTER; }
+    bool is_memory() const { return kind == OPERAND_MEMORY; }
+    // SSE and AVX registers
+    bool is_xmm() const { return kind == OPERAND_REGISTER && (text.rfind("xmm", 0) == 0 || text.rfind("ymm", 0) == 0); }
+
+    // Registers that share their storage, like al, eax and rax
+    bool same_register(const Operand &other) const;
+
+    bool operator==(const Operand &other) const;
+    bool operator!=(const Operand &other) const { return !(*this == other); }
+} Operand;
+
+enum InstructionKind : uint8_t
+{
+    INSTRUCTION_OPERATION,
+    INSTRUCTION_LABEL,
+    INSTRUCTION_DIRECTIVE
+};
+
+typedef struct Instruction
+{
+    InstructionKind kind;
+    // Mnemonic, label name or the whole directive line
+    std::string opcode;
+    std::vector<Operand> operands;
+
+    static Instruction parse(const std::string &line);
+
+    std::string to_string() const;
+
+    bool is(const std::string &mnemonic, size_t operand_count) const
+    {
+        return kind == INSTRUCTION_OPERATION && opcode == mnemonic && operands.size() == operand_count;
+    }
+
+    // Conditional and unconditional jumps
+    bool is_jump() const { return kind == INSTRUCTION_OPERATION && opcode[0] == 'j'; }
+} Instruction;
+
+typedef std::vector<Instruction> InstructionList;
+
+InstructionList parse_instructions(const std::string &text);
+
+std::string instructions_to_string(const InstructionList &instructions);
+
+// Name of the register of the same family with the given size, like ("rax", 1) -> "al"
+std::string register_with_size(const std::string &name, unsigned size);
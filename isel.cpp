@@ -0,0 +1,479 @@
+#include "isel.hpp"
+
+// isel.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "induction.hpp"
+
+#include <algorithm>
+#include <climits>
+
+// Cost of each tile, about the latency of its instruction
+static const std::map<TileKind, unsigned> TILE_COSTS = {
+    {TILE_LOAD, 1},
+    {TILE_ARITHMETIC, 1},
+    {TILE_MULTIPLY, 3},
+    {TILE_INCREMENT, 1},
+    {TILE_SHIFT, 1},
+    {TILE_SCALE, 1},
+    {TILE_ADDRESS, 1},
+};
+// Scratch registers the emitter evaluates a tree in, the deepest tree may use all but one
+static const int MAX_REGISTER_NEED = 4;
+
+bool is_int_symbol(const SymbolTableEntry &symbol)
+{
+    return symbol && symbol->get_data_type() == TYPE_INT;
+}
+
+bool is_integer_arithmetic(const TACptr &tac)
+{
+    const auto type = tac->get_type();
+    return (type == TAC_ADD || type == TAC_SUB || type == TAC_MUL) && is_int_symbol(tac->get_result())
+        && is_int_symbol(tac->get_first_operator()) && is_int_symbol(tac->get_second_operator());
+}
+
+// Operands of the TAC that may be trees, empty if the emitter does not select instructions for it
+std::vector<SymbolTableEntry> tree_operands(const TACptr &tac)
+{
+    const auto first = tac->get_first_operator();
+    const auto second = tac->get_second_operator();
+    switch (tac->get_type())
+    {
+    case TAC_ADD:
+    case TAC_SUB:
+    case TAC_MUL:
+        return is_integer_arithmetic(tac) ? std::vector<SymbolTableEntry>{first, second} : std::vector<SymbolTableEntry>();
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+        return is_int_symbol(first) && is_int_symbol(second) ? std::vector<SymbolTableEntry>{first, second} : std::vector<SymbolTableEntry>();
+    case TAC_MOVE:
+        return is_int_symbol(tac->get_result()) && is_int_symbol(first) ? std::vector<SymbolTableEntry>{first} : std::vector<SymbolTableEntry>();
+    case TAC_VECLOAD:
+    case TAC_VECSTORE:
+    case TAC_ADDR:
+        return is_int_symbol(second) ? std::vector<SymbolTableEntry>{second} : std::vector<SymbolTableEntry>();
+    default:
+        return {};
+    }
+}
+
+// Scratch registers needed to compute the node, the second operand of an instruction may stay in memory
+int register_need(const ExpressionNodePtr &node)
+{
+    if (node->is_leaf() || node->children.size() < 2)
+    {
+        return 1;
+    }
+    const auto &second = node->children[1];
+    const auto second_need = second->is_leaf() ? 0 : register_need(second);
+    return std::max(register_need(node->children[0]), second_need + 1);
+}
+
+void collect_tree(const ExpressionNodePtr &node, std::set<TACptr> &tacs, std::set<SymbolTableEntry> &leaves)
+{
+    if (node->is_leaf())
+    {
+        if (!node->symbol->is_literal())
+        {
+            leaves.insert(node->symbol);
+        }
+        return;
+    }
+    tacs.insert(node->tac);
+    for (const auto &child : node->children)
+    {
+        collect_tree(child, tacs, leaves);
+    }
+}
+
+// Whether the tree computed by the TAC at the given position can instead run at the root: no
+// TAC in between may change the values it reads
+bool can_fold(const TACList &function_tacs, const std::map<TACptr, size_t> &positions, const ExpressionNodePtr &tree, const size_t root)
+{
+    if (register_need(tree) >= MAX_REGISTER_NEED)
+    {
+        return false;
+    }
+    std::set<TACptr> tree_tacs;
+    std::set<SymbolTableEntry> leaves;
+    collect_tree(tree, tree_tacs, leaves);
+    auto start = root;
+    for (const auto &tac : tree_tacs)
+    {
+        start = std::min(start, positions.at(tac));
+    }
+    const auto reads_globals = std::any_of(leaves.begin(), leaves.end(), [](const SymbolTableEntry &leaf) {
+        return !leaf->is_temporary();
+    });
+    for (auto i = start + 1; i < root; ++i)
+    {
+        const auto &tac = function_tacs[i];
+        if (tree_tacs.count(tac))
+        {
+            continue;
+        }
+        const auto definition = tac->get_definition();
+        if ((definition && leaves.count(definition)) || (tac->get_type() == TAC_CALL && reads_globals))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+ExpressionForest build_expression_forest(const TACList &function_tacs)
+{
+    ExpressionForest forest;
+    std::map<TACptr, size_t> positions;
+    std::map<SymbolTableEntry, size_t> uses;
+    std::map<SymbolTableEntry, size_t> definitions;
+    for (size_t i = 0; i < function_tacs.size(); ++i)
+    {
+        const auto &tac = function_tacs[i];
+        positions[tac] = i;
+        for (const auto &use : tac->get_uses())
+        {
+            uses[use]++;
+        }
+        if (tac->get_definition())
+        {
+            definitions[tac->get_definition()]++;
+        }
+    }
+    // Temporaries only ever set to an integer literal, which the trees read as an immediate
+    std::map<SymbolTableEntry, TACptr> constants;
+    for (const auto &tac : function_tacs)
+    {
+        const auto result = tac->get_result();
+        if (tac->get_type() == TAC_MOVE && is_int_symbol(result) && result->is_temporary() && definitions[result] == 1
+            && is_int_literal(tac->get_first_operator()))
+        {
+            constants[result] = tac;
+        }
+    }
+
+    // Arithmetic TACs of the current block that may still be folded, by their result
+    std::map<SymbolTableEntry, TACptr> foldable;
+    for (size_t i = 0; i < function_tacs.size(); ++i)
+    {
+        const auto &tac = function_tacs[i];
+        if (tac->get_type() == TAC_LABEL || tac->get_type() == TAC_BEGINFUN)
+        {
+            foldable.clear();
+        }
+
+        const auto operands = tree_operands(tac);
+        if (!operands.empty())
+        {
+            auto node = std::make_shared<ExpressionNode>(ExpressionNode{tac, tac->get_result(), {}});
+            bool folds = false;
+            for (size_t j = 0; j < operands.size(); ++j)
+            {
+                const auto &operand = operands[j];
+                auto child = std::make_shared<ExpressionNode>(ExpressionNode{nullptr, operand, {}});
+                // A constant becomes an immediate of the arithmetic or comparison while the other
+                // operand still needs a register, and its MOVE goes away when nothing else reads it
+                const auto constant = constants.find(operand);
+                if (constant != constants.end() && operands.size() == 2 && tac->get_type() != TAC_MOVE)
+                {
+                    const auto &other = operands[1 - j];
+                    if (!is_int_literal(other) && (j == 1 || !constants.count(other)))
+                    {
+                        child->symbol = constant->second->get_first_operator();
+                        if (uses[operand] == 1)
+                        {
+                            forest.folded[constant->second] = tac;
+                        }
+                        node->children.push_back(child);
+                        continue;
+                    }
+                }
+                const auto found = foldable.find(operand);
+                if (found != foldable.end() && uses[operand] == 1 && definitions[operand] == 1
+                    && can_fold(function_tacs, positions, forest.trees.at(found->second), i))
+                {
+                    const auto folded_tac = found->second;
+                    child = forest.trees.at(folded_tac);
+                    forest.trees.erase(folded_tac);
+                    // The TACs folded into the child move to the new root with it
+                    for (auto &[inner, root] : forest.folded)
+                    {
+                        if (root == folded_tac)
+                        {
+                            root = tac;
+                        }
+                    }
+                    forest.folded[folded_tac] = tac;
+                    foldable.erase(found);
+                    folds = true;
+                }
+                node->children.push_back(child);
+            }
+            // A MOVE only gains from selection when it computes the tree of its source
+            if (tac->get_type() != TAC_MOVE || folds)
+            {
+                forest.trees[tac] = node;
+            }
+            if (is_integer_arithmetic(tac) && tac->get_result()->is_temporary())
+            {
+                foldable[tac->get_result()] = tac;
+            }
+        }
+
+        if (tac->is_block_terminator())
+        {
+            foldable.clear();
+        }
+    }
+    return forest;
+}
+
+long literal_of(const ExpressionNodePtr &node)
+{
+    return std::stol(node->symbol->get_text());
+}
+
+bool is_literal_node(const ExpressionNodePtr &node)
+{
+    return node->is_leaf() && is_int_literal(node->symbol);
+}
+
+bool is_power_of_two(const long value)
+{
+    return value > 1 && value <= (1L << 30) && (value & (value - 1)) == 0;
+}
+
+// Adds node * scale to the address, false when it has no register left for it
+bool add_address_term(Tile &tile, const ExpressionNodePtr &node, const long scale)
+{
+    if (scale == 1 && !tile.base)
+    {
+        tile.base = node;
+        return true;
+    }
+    if (!tile.index)
+    {
+        tile.index = node;
+        tile.scale = scale;
+        return true;
+    }
+    return false;
+}
+
+// Splits the node in the parts of an address, the top one must be an addition or a subtraction of a literal
+bool decompose_address(const ExpressionNodePtr &node, Tile &tile, const bool top)
+{
+    if (is_literal_node(node))
+    {
+        tile.displacement += literal_of(node);
+        return true;
+    }
+    if (!node->is_leaf() && is_integer_arithmetic(node->tac))
+    {
+        const auto type = node->tac->get_type();
+        const auto &first = node->children[0];
+        const auto &second = node->children[1];
+        if (type == TAC_ADD)
+        {
+            return decompose_address(first, tile, false) && decompose_address(second, tile, false);
+        }
+        if (type == TAC_SUB && is_literal_node(second))
+        {
+            tile.displacement -= literal_of(second);
+            return decompose_address(first, tile, false);
+        }
+        if (type == TAC_MUL && !top)
+        {
+            const auto literal_first = is_literal_node(first);
+            const auto &scaled = literal_first ? second : first;
+            const auto &factor = literal_first ? first : second;
+            if (is_literal_node(factor) && !is_literal_node(scaled) && (literal_of(factor) == 2 || literal_of(factor) == 4 || literal_of(factor) == 8))
+            {
+                return add_address_term(tile, scaled, literal_of(factor));
+            }
+        }
+    }
+    return !top && add_address_term(tile, node, 1);
+}
+
+unsigned tile_cost(const TileKind kind)
+{
+    return TILE_COSTS.at(kind);
+}
+
+// Cost of having the value in a register of its own
+unsigned evaluation_cost(const ExpressionNodePtr &node, const TileSelection &selection)
+{
+    return node->is_leaf() ? tile_cost(TILE_LOAD) : selection.at(node.get()).cost;
+}
+
+// Cost of reading the value from a register, which is free when the allocator already put it in one
+unsigned register_cost(const ExpressionNodePtr &node, const TileSelection &selection, const RegisterAllocation &allocation)
+{
+    if (node->is_leaf() && allocation.registers.count(node->symbol))
+    {
+        return 0;
+    }
+    return evaluation_cost(node, selection);
+}
+
+// Scratch registers the parts of the address take, the ones not already in a register are computed one after the other
+int address_need(const Tile &tile, const RegisterAllocation &allocation)
+{
+    int need = 0;
+    int computed = 0;
+    for (const auto &part : {tile.base, tile.index})
+    {
+        if (!part || (part->is_leaf() && allocation.registers.count(part->symbol)))
+        {
+            continue;
+        }
+        need = std::max(need, computed + register_need(part));
+        computed++;
+    }
+    return need;
+}
+
+void label_tree(const ExpressionNodePtr &node, TileSelection &selection, const RegisterAllocation &allocation)
+{
+    if (node->is_leaf())
+    {
+        return;
+    }
+    for (const auto &child : node->children)
+    {
+        label_tree(child, selection, allocation);
+    }
+    if (!is_integer_arithmetic(node->tac))
+    {
+        return;
+    }
+
+    const auto type = node->tac->get_type();
+    const auto &first = node->children[0];
+    const auto &second = node->children[1];
+    const auto literal_first = is_literal_node(first) && !is_literal_node(second);
+    // The operand that is not a literal, and the literal, when there is one
+    const auto &other = literal_first ? second : first;
+    const auto &constant = literal_first ? first : second;
+    // Only the second operand of a subtraction can become an immediate
+    const auto has_constant = is_literal_node(constant) && !is_literal_node(other) && !(literal_first && type == TAC_SUB);
+
+    std::vector<Tile> candidates;
+    // The second operand of add, sub and imul may be in memory, or an immediate
+    if (type == TAC_MUL && has_constant && other->is_leaf())
+    {
+        candidates.push_back({TILE_MULTIPLY, tile_cost(TILE_MULTIPLY), nullptr, nullptr, 1, 0});
+    }
+    else
+    {
+        const auto kind = type == TAC_MUL ? TILE_MULTIPLY : TILE_ARITHMETIC;
+        const auto commutes = type != TAC_SUB && first->is_leaf() && !second->is_leaf();
+        auto cost = tile_cost(kind);
+        if (commutes)
+        {
+            cost += evaluation_cost(second, selection);
+        }
+        else
+        {
+            cost += evaluation_cost(first, selection) + (second->is_leaf() ? 0 : evaluation_cost(second, selection));
+        }
+        candidates.push_back({kind, cost, nullptr, nullptr, 1, 0});
+    }
+    if (has_constant && type != TAC_MUL && std::abs(literal_of(constant)) == 1)
+    {
+        candidates.push_back({TILE_INCREMENT, tile_cost(TILE_INCREMENT) + evaluation_cost(other, selection), nullptr, nullptr, 1, 0});
+    }
+    if (has_constant && type == TAC_MUL && is_power_of_two(literal_of(constant)))
+    {
+        candidates.push_back({TILE_SHIFT, tile_cost(TILE_SHIFT) + evaluation_cost(other, selection), nullptr, nullptr, 1, 0});
+    }
+    if (has_constant && type == TAC_MUL && (literal_of(constant) == 3 || literal_of(constant) == 5 || literal_of(constant) == 9))
+    {
+        candidates.push_back({TILE_SCALE, tile_cost(TILE_SCALE) + register_cost(other, selection, allocation), nullptr, nullptr, 1, 0});
+    }
+    Tile address{TILE_ADDRESS, tile_cost(TILE_ADDRESS), nullptr, nullptr, 1, 0};
+    if (decompose_address(node, address, true) && (address.base || address.index)
+        && address.displacement >= INT_MIN && address.displacement <= INT_MAX
+        && address_need(address, allocation) <= register_need(node))
+    {
+        for (const auto &part : {address.base, address.index})
+        {
+            address.cost += part ? register_cost(part, selection, allocation) : 0;
+        }
+        candidates.push_back(address);
+    }
+
+    // Ties keep the earlier tile, the simpler one
+    selection[node.get()] = *std::min_element(candidates.begin(), candidates.end(), [](const Tile &a, const Tile &b) {
+        return a.cost < b.cost;
+    });
+}
+
+TileSelection select_tiles(const ExpressionNodePtr &root, const RegisterAllocation &allocation)
+{
+    TileSelection selection;
+    label_tree(root, selection, allocation);
+    return selection;
+}
+
+std::pair<ExpressionNodePtr, long> split_offset(const ExpressionNodePtr &node)
+{
+    if (is_literal_node(node))
+    {
+        return {nullptr, literal_of(node)};
+    }
+    if (node->is_leaf() || !is_integer_arithmetic(node->tac))
+    {
+        return {node, 0};
+    }
+    const auto type = node->tac->get_type();
+    const auto &first = node->children[0];
+    const auto &second = node->children[1];
+    if (type == TAC_ADD && is_literal_node(first) && !is_literal_node(second))
+    {
+        return {second, literal_of(first)};
+    }
+    if ((type == TAC_ADD || type == TAC_SUB) && is_literal_node(second) && !is_literal_node(first))
+    {
+        return {first, type == TAC_ADD ? literal_of(second) : -literal_of(second)};
+    }
+    return {node, 0};
+}
+
+DivisionMagic division_magic(const unsigned long divisor)
+{
+    const unsigned long two31 = 1UL << 31;
+    // Largest dividend whose remainder is divisor - 1
+    const auto anc = two31 - 1 - two31 % divisor;
+    unsigned p = 31;
+    auto q1 = two31 / anc;
+    auto r1 = two31 - q1 * anc;
+    auto q2 = two31 / divisor;
+    auto r2 = two31 - q2 * divisor;
+    unsigned long delta = 0;
+    do
+    {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= divisor)
+        {
+            q2++;
+            r2 -= divisor;
+        }
+        delta = divisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    return {q2 + 1, p - 32};
+}
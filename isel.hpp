@@ -0,0 +1,92 @@
+#pragma once
+
+// isel.hpp file made by Ian Kersz Amaral - 2025/1
+// Instruction selection for integer expressions. The arithmetic TACs of a block whose result
+// is read once, by a later TAC of the same block, are folded into the expression tree of that
+// TAC. Each tree is then covered by the cheapest set of tiles from a cost table, like lea for
+// a + b * 4 + c, inc for x + 1 or shl for x * 8, which the emitter turns into instructions.
+
+#include "regalloc.hpp"
+
+#include <memory>
+
+typedef struct ExpressionNode
+{
+    // The TAC that computes the value, nullptr for leaves
+    TACptr tac;
+    // The leaf itself, or the result of the TAC
+    SymbolTableEntry symbol;
+    // Values the TAC reads: both operands of arithmetic and comparisons, the source of a MOVE and
+    // the index of vector accesses
+    std::vector<std::shared_ptr<ExpressionNode>> children;
+
+    bool is_leaf() const { return !tac; }
+} ExpressionNode;
+
+typedef std::shared_ptr<ExpressionNode> ExpressionNodePtr;
+
+typedef struct ExpressionForest
+{
+    // Tree of each TAC the emitter selects instructions for
+    std::map<TACptr, ExpressionNodePtr> trees;
+    // TACs folded into a tree, with the root of that tree, which computes them when it runs
+    std::map<TACptr, TACptr> folded;
+} ExpressionForest;
+
+ExpressionForest build_expression_forest(const TACList &function_tacs);
+
+typedef enum TileKind
+{
+    // mov of the value to a register
+    TILE_LOAD,
+    // add or sub of the second operand to the first, in a register
+    TILE_ARITHMETIC,
+    // imul of the second operand with the first, in a register
+    TILE_MULTIPLY,
+    // inc or dec for an addition or subtraction of one
+    TILE_INCREMENT,
+    // shl for a multiplication by a power of two
+    TILE_SHIFT,
+    // lea [x + x * 2] and the like, for a multiplication by 3, 5 or 9
+    TILE_SCALE,
+    // lea [base + index * scale + displacement] for additions
+    TILE_ADDRESS,
+} TileKind;
+
+typedef struct Tile
+{
+    TileKind kind;
+    // Cost of the tile and of the tiles below it
+    unsigned cost;
+    // Parts of the address of TILE_ADDRESS, base or index may be nullptr
+    ExpressionNodePtr base;
+    ExpressionNodePtr index;
+    long scale = 1;
+    long displacement = 0;
+} Tile;
+
+typedef std::map<const ExpressionNode *, Tile> TileSelection;
+
+// Cheapest tile of every node of the tree that is computed into a register
+TileSelection select_tiles(const ExpressionNodePtr &root, const RegisterAllocation &allocation);
+
+// Leaves that are integer literals, with their value
+bool is_literal_node(const ExpressionNodePtr &node);
+long literal_of(const ExpressionNodePtr &node);
+
+// The node as base + offset, with the literal it adds, so vector accesses fold it in the address.
+// The base is nullptr when the node is a literal.
+std::pair<ExpressionNodePtr, long> split_offset(const ExpressionNodePtr &node);
+
+typedef struct DivisionMagic
+{
+    // Multiplier of the high half of the product, below 2^32
+    unsigned long multiplier;
+    // Arithmetic shift of the high half
+    unsigned shift;
+} DivisionMagic;
+
+// Magic number that divides signed 32-bit values by the divisor, which is at least 3 and not a
+// power of two, with a multiplication and a shift, as in Hacker's Delight. When the multiplier
+// does not fit a signed 32-bit value, the dividend must be added back to the high half.
+DivisionMagic division_magic(const unsigned long divisor);
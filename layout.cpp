@@ -0,0 +1,157 @@
+#include "layout.hpp"
+
+// layout.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+// Each loop around a TAC makes it count this many times more, up to the given depth
+static const unsigned long LOOP_WEIGHT = 8;
+static const size_t MAX_LOOP_DEPTH = 5;
+// Vectors are aligned for the packed loads and stores of the vectorized loops
+static const size_t VECTOR_ALIGNMENT = 16;
+// Packed temporaries hold a whole ymm register
+static const size_t PACKED_ALIGNMENT = 32;
+
+// Heat of every symbol the functions mention, and the first function that mentions it
+void measure_heat(const TACList &tac_list, std::map<SymbolTableEntry, unsigned long> &heat, std::map<SymbolTableEntry, std::string> &owners,
+                  std::vector<std::string> &functions)
+{
+    for (const auto &cfg : Program::split(tac_list).functions)
+    {
+        functions.push_back(cfg.function_name());
+        std::vector<size_t> depth(cfg.blocks.size(), 0);
+        for (const auto &loop : cfg.find_loops())
+        {
+            for (const auto block : loop.blocks)
+            {
+                depth[block]++;
+            }
+        }
+        for (size_t block = 0; block < cfg.blocks.size(); ++block)
+        {
+            unsigned long weight = 1;
+            for (size_t i = 0; i < std::min(depth[block], MAX_LOOP_DEPTH); ++i)
+            {
+                weight *= LOOP_WEIGHT;
+            }
+            for (const auto &tac : cfg.blocks[block].tacs)
+            {
+                // Every operand, as the uses leave out the vector of VECLOAD, VECSTORE and ADDR
+                std::set<SymbolTableEntry> symbols = {tac->get_result(), tac->get_first_operator(), tac->get_second_operator()};
+                symbols.erase(nullptr);
+                for (const auto &symbol : symbols)
+                {
+                    heat[symbol] += weight;
+                    owners.insert({symbol, cfg.function_name()});
+                }
+            }
+        }
+    }
+}
+
+// Places the items from the given offset on, starting a new cache line. The ones read in loops
+// come first, and the wider alignments before the narrower ones, so they need no padding.
+void place_group(std::vector<DataItem> &items, size_t &offset)
+{
+    std::stable_sort(items.begin(), items.end(), [](const DataItem &a, const DataItem &b) {
+        const auto hot_a = a.heat >= LOOP_WEIGHT;
+        const auto hot_b = b.heat >= LOOP_WEIGHT;
+        if (hot_a != hot_b)
+        {
+            return hot_a;
+        }
+        if (a.alignment != b.alignment)
+        {
+            return a.alignment > b.alignment;
+        }
+        return a.heat > b.heat;
+    });
+    offset = (offset + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    for (auto &item : items)
+    {
+        offset = (offset + item.alignment - 1) / item.alignment * item.alignment;
+        item.offset = offset;
+        offset += item.size;
+    }
+}
+
+DataLayout layout_data(const TACList &tac_list, const std::vector<SymbolTableEntry> &temporaries)
+{
+    std::map<SymbolTableEntry, unsigned long> heat;
+    std::map<SymbolTableEntry, std::string> owners;
+    std::vector<std::string> functions;
+    measure_heat(tac_list, heat, owners, functions);
+
+    DataLayout layout;
+    for (const auto &tac : tac_list)
+    {
+        const auto type = tac->get_type();
+        if (type == TAC_BEGINCODE)
+        {
+            break;
+        }
+        if (type != TAC_VAREND && type != TAC_VECEND)
+        {
+            continue;
+        }
+        const auto symbol = tac->get_result();
+        const auto element_size = static_cast<size_t>(get_data_type_size(symbol->get_data_type()));
+        const auto is_vector = type == TAC_VECEND;
+        const auto count = is_vector ? std::stoul(tac->get_first_operator()->get_text()) : 1;
+        const auto alignment = is_vector ? VECTOR_ALIGNMENT : std::max(element_size, SCALAR_SIZE);
+        const auto size = is_vector ? element_size * count : std::max(element_size, SCALAR_SIZE);
+        layout.globals.push_back({symbol, "", size, alignment, heat[symbol], 0});
+    }
+    size_t offset = 0;
+    place_group(layout.globals, offset);
+
+    // Temporaries go with the function that uses them first, in the order of the functions
+    std::map<std::string, std::vector<DataItem>> groups;
+    for (const auto &symbol : temporaries)
+    {
+        const auto data_type = symbol->get_data_type();
+        const auto size = std::max(static_cast<size_t>(get_data_type_size(data_type)), SCALAR_SIZE);
+        const auto alignment = is_packed_type(data_type) ? PACKED_ALIGNMENT : size;
+        const auto owner = owners.count(symbol) ? owners.at(symbol) : "";
+        groups[owner].push_back({symbol, owner, size, alignment, heat[symbol], 0});
+    }
+    functions.push_back("");
+    offset = 0;
+    for (const auto &function : functions)
+    {
+        auto found = groups.find(function);
+        if (found == groups.end())
+        {
+            continue;
+        }
+        place_group(found->second, offset);
+        layout.temporaries.insert(layout.temporaries.end(), found->second.begin(), found->second.end());
+    }
+    return layout;
+}
+
+std::string report_section(const std::string &section, const std::vector<DataItem> &items)
+{
+    std::stringstream report;
+    report << "## " << section << "\n";
+    report << "##   line  offset  size  align      heat  symbol\n";
+    for (const auto &item : items)
+    {
+        report << "## " << std::setw(6) << item.offset / CACHE_LINE_SIZE << std::setw(8) << item.offset << std::setw(6) << item.size
+               << std::setw(7) << item.alignment << std::setw(10) << item.heat << "  " << item.symbol->get_text();
+        if (!item.owner.empty())
+        {
+            report << " (" << item.owner << ")";
+        }
+        report << "\n";
+    }
+    return report.str();
+}
+
+std::string layout_report(const DataLayout &layout)
+{
+    return report_section(".data", layout.globals) + report_section(".bss", layout.temporaries);
+}
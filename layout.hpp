@@ -0,0 +1,40 @@
+#pragma once
+
+// layout.hpp file made by Ian Kersz Amaral - 2025/1
+// Data layout of the globals and of the temporaries that are still kept in memory. The
+// temporaries of each function are placed together, and every group starts a cache line with
+// the values its loops read, sorted by alignment so no padding is needed between them.
+
+#include "cfg.hpp"
+
+typedef struct DataItem
+{
+    SymbolTableEntry symbol;
+    // Function the temporary belongs to, empty for the globals
+    std::string owner;
+    size_t size;
+    size_t alignment;
+    // TACs that read or write the value, each one weighted by how deep in loops it is
+    unsigned long heat;
+    // Bytes from the start of its section
+    size_t offset;
+} DataItem;
+
+typedef struct DataLayout
+{
+    // Variables and vectors, in .data
+    std::vector<DataItem> globals;
+    // Temporaries and parameters the functions read from memory, in .bss
+    std::vector<DataItem> temporaries;
+} DataLayout;
+
+// Every section starts at a cache line, so the offsets tell which values share one
+static constexpr size_t CACHE_LINE_SIZE = 64;
+// Scalar bytes take as much as an int, with the three upper bytes always zero, as the int
+// operations that read them use their own width
+static constexpr size_t SCALAR_SIZE = 4;
+
+DataLayout layout_data(const TACList &tac_list, const std::vector<SymbolTableEntry> &temporaries);
+
+// One line per value with its section, offset, size and heat, as assembler comments
+std::string layout_report(const DataLayout &layout);
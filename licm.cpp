@@ -0,0 +1,236 @@
+#include "licm.hpp"
+
+// licm.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+
+typedef struct LoopEffects
+{
+    std::map<SymbolTableEntry, size_t> definitions;
+    std::set<SymbolTableEntry> stored_vectors;
+    // Stores through a pointer may write any vector
+    bool has_pointer_store = false;
+    // Calls with no summary may write any global or vector, and recursive calls also our temporaries
+    bool has_call = false;
+} LoopEffects;
+
+LoopEffects collect_loop_effects(const ControlFlowGraph &cfg, const Loop &loop, const CallSummaries &summaries)
+{
+    LoopEffects effects;
+    for (const auto block : loop.blocks)
+    {
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            const auto definition = tac->get_definition();
+            if (definition)
+            {
+                effects.definitions[definition]++;
+            }
+            if (tac->get_type() == TAC_VECSTORE)
+            {
+                effects.stored_vectors.insert(tac->get_result());
+            }
+            if (tac->get_type() == TAC_PTRSTORE)
+            {
+                effects.has_pointer_store = true;
+            }
+            if (tac->get_type() != TAC_CALL)
+            {
+                continue;
+            }
+            const auto summary = summaries.of_call(cfg.function_name(), tac);
+            if (!summary)
+            {
+                effects.has_call = true;
+                continue;
+            }
+            for (const auto &written : summary->writes)
+            {
+                effects.definitions[written]++;
+            }
+            effects.stored_vectors.insert(summary->written_vectors.begin(), summary->written_vectors.end());
+            effects.has_pointer_store = effects.has_pointer_store || summary->writes_any_vector;
+        }
+    }
+    return effects;
+}
+
+bool index_in_bounds(const SymbolTableEntry &vector, const SymbolTableEntry &index, const std::map<SymbolTableEntry, long> &vector_sizes)
+{
+    const auto size = vector_sizes.find(vector);
+    if (size == vector_sizes.end() || !index->is_literal() || index->type != SYMBOL_INT)
+    {
+        return false;
+    }
+    const auto position = std::stol(index->get_text());
+    return position >= 0 && position < size->second;
+}
+
+bool hoist_from_loop(ControlFlowGraph &cfg, const Loop &loop, const std::map<SymbolTableEntry, long> &vector_sizes, const CallSummaries &summaries)
+{
+    const auto effects = collect_loop_effects(cfg, loop, summaries);
+
+    std::vector<size_t> loop_order;
+    for (const auto block : cfg.reverse_postorder())
+    {
+        if (loop.contains(block))
+        {
+            loop_order.push_back(block);
+        }
+    }
+
+    // Position of each TAC and the places its result is read, to check the definition comes first
+    std::map<TACptr, std::pair<size_t, size_t>> positions;
+    std::map<SymbolTableEntry, std::vector<std::pair<size_t, size_t>>> uses_in_loop;
+    std::set<SymbolTableEntry> used_outside_loop;
+    for (size_t block = 0; block < cfg.blocks.size(); ++block)
+    {
+        const auto &tacs = cfg.blocks[block].tacs;
+        for (size_t i = 0; i < tacs.size(); ++i)
+        {
+            positions[tacs[i]] = {block, i};
+            for (const auto &use : tacs[i]->get_uses())
+            {
+                if (loop.contains(block))
+                {
+                    uses_in_loop[use].push_back({block, i});
+                }
+                else
+                {
+                    used_outside_loop.insert(use);
+                }
+            }
+        }
+    }
+
+    // The block runs on every iteration that leaves the loop
+    const auto dominates_exits = [&](size_t block) {
+        return std::all_of(loop.blocks.begin(), loop.blocks.end(), [&](size_t exiting) {
+            const auto &successors = cfg.blocks[exiting].successors;
+            const auto leaves_loop = std::any_of(successors.begin(), successors.end(), [&](size_t successor) {
+                return !loop.contains(successor);
+            });
+            return !leaves_loop || cfg.dominates(block, exiting);
+        });
+    };
+
+    std::set<SymbolTableEntry> invariant_results;
+    std::set<TACptr> invariant_tacs;
+    TACList hoisted;
+
+    const auto operand_is_invariant = [&](const SymbolTableEntry &operand) {
+        if (operand->is_literal())
+        {
+            return true;
+        }
+        if (invariant_results.count(operand))
+        {
+            return true;
+        }
+        return !effects.has_call && effects.definitions.count(operand) == 0;
+    };
+
+    const auto can_hoist = [&](const TACptr &tac) {
+        const auto type = tac->get_type();
+        if (!tac->is_expression() && type != TAC_VECLOAD)
+        {
+            return false;
+        }
+        const auto result = tac->get_result();
+        if (!result->is_temporary() || effects.definitions.at(result) != 1 || tac->may_trap())
+        {
+            return false;
+        }
+        for (const auto &operand : tac->get_uses())
+        {
+            if (!operand_is_invariant(operand))
+            {
+                return false;
+            }
+        }
+
+        const auto [block, index] = positions.at(tac);
+        for (const auto &[use_block, use_index] : uses_in_loop[result])
+        {
+            const auto defined_before = use_block == block ? use_index > index : cfg.dominates(block, use_block);
+            if (!defined_before)
+            {
+                return false;
+            }
+        }
+
+        const auto always_runs = dominates_exits(block);
+        if (!always_runs && used_outside_loop.count(result))
+        {
+            return false;
+        }
+
+        if (type == TAC_VECLOAD)
+        {
+            const auto vector = tac->get_first_operator();
+            if (effects.has_call || effects.has_pointer_store || effects.stored_vectors.count(vector))
+            {
+                return false;
+            }
+            // Loads moved out of a conditional path must not read outside the vector
+            return always_runs || index_in_bounds(vector, tac->get_second_operator(), vector_sizes);
+        }
+        return true;
+    };
+
+    bool found = true;
+    while (found)
+    {
+        found = false;
+        for (const auto block : loop_order)
+        {
+            for (const auto &tac : cfg.blocks[block].tacs)
+            {
+                if (invariant_tacs.count(tac) || !can_hoist(tac))
+                {
+                    continue;
+                }
+                invariant_tacs.insert(tac);
+                invariant_results.insert(tac->get_result());
+                hoisted.push_back(tac);
+                found = true;
+            }
+        }
+    }
+
+    if (hoisted.empty())
+    {
+        return false;
+    }
+
+    for (const auto block : loop.blocks)
+    {
+        auto &tacs = cfg.blocks[block].tacs;
+        tacs.erase(std::remove_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+            return invariant_tacs.count(tac) != 0;
+        }), tacs.end());
+    }
+
+    const auto preheader = cfg.insert_preheader(loop);
+    auto &preheader_tacs = cfg.blocks[preheader].tacs;
+    preheader_tacs.insert(preheader_tacs.end(), hoisted.begin(), hoisted.end());
+    return true;
+}
+
+void hoist_loop_invariants(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &vector_sizes, const CallSummaries &summaries)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto &loop : cfg.find_loops())
+        {
+            // Hoisting adds a block, so the loops are found again after each change
+            if (hoist_from_loop(cfg, loop, vector_sizes, summaries))
+            {
+                changed = true;
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// licm.hpp file made by Ian Kersz Amaral - 2025/1
+// Loop invariant code motion: computations that give the same value on every
+// iteration are moved to a preheader block that runs once before the loop.
+
+#include "cfg.hpp"
+#include "summaries.hpp"
+
+void hoist_loop_invariants(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &vector_sizes, const CallSummaries &summaries);
@@ -13,6 +13,8 @@
 #include "checkers.hpp"
 #include "tac.hpp"
 #include "asm.hpp"
+#include "optimizer.hpp"
+#include "algebra.hpp"
 
 extern int yylex_destroy(void);
 extern FILE *yyin;
@@ -25,7 +27,22 @@ static constexpr auto SEMANTIC_ERROR = 4;
 
 int main(int argc, char **argv)
 {
-    std::vector<std::string> args(argv + 1, argv + argc);
+    std::vector<std::string> args;
+    OptimizerOptions optimizer_options;
+    for (const auto &arg : std::vector<std::string>(argv + 1, argv + argc))
+    {
+        if (arg.size() > 1 && arg[0] == '-')
+        {
+            if (!optimizer_options.parse_flag(arg))
+            {
+                std::cerr << "Unknown option " << arg << std::endl;
+                std::exit(WRONG_ARGS_ERROR);
+            }
+            continue;
+        }
+        args.push_back(arg);
+    }
+
     if (args.size() == 1)
     {
         std::cerr << "No output file provided. ";
@@ -36,7 +53,7 @@ int main(int argc, char **argv)
     else if (args.size() != 2)
     {
         std::cerr << "No input or output file provided. ";
-        std::cerr << "Usage: " << argv[0] << " <input file> <output file>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-O2|-O3] [--inline-threshold=N] [--unroll-factor=N] [-mavx2] [-ffast-math] [--bounds-check] <input file> <output file>" << std::endl;
         std::exit(WRONG_ARGS_ERROR);
     }
 
@@ -81,6 +98,11 @@ int main(int argc, char **argv)
         std::exit(SEMANTIC_ERROR);
     }
 
+    if (optimizer_options.level > 0)
+    {
+        simplify_expressions(g_AST, optimizer_options);
+    }
+
     const auto tac = TAC::generate_tacs(g_AST);
     if (tac == nullptr)
     {
@@ -91,8 +113,15 @@ int main(int argc, char **argv)
     std::cerr << "TAC in backwards order: \n";
     std::cerr << TAC::tac_string_backwards(tac) << std::endl;
     std::cerr << "TAC in forward order: \n";
-    const auto tac_list = TAC::build_forward_links(tac);
-    std::cerr << TAC::tac_string(tac_list) << std::endl;
+    const auto generated_tac_list = TAC::build_forward_links(tac);
+    std::cerr << TAC::tac_string(generated_tac_list) << std::endl;
+
+    const auto tac_list = optimize_tacs(generated_tac_list, optimizer_options);
+    if (optimizer_options.level > 0)
+    {
+        std::cerr << "Optimized TAC (-O" << optimizer_options.level << "): \n";
+        std::cerr << TAC::tac_string(tac_list) << std::endl;
+    }
 
     const auto ast_export_file = args[1] + ".ast";
     std::ofstream ast_file(ast_export_file, std::ios::out);
@@ -113,7 +142,7 @@ int main(int argc, char **argv)
 
     std::cerr << "Generating assembly code..." << std::endl;
 
-    const auto generated_assembly = generate_asm(tac_list, get_symbol_table());
+    const auto generated_assembly = generate_asm(tac_list, get_symbol_table(), optimizer_options);
 
     const auto assembly_file = args[1] + ".S";
     std::ofstream asmfile(assembly_file, std::ios::out);
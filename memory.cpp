@@ -0,0 +1,497 @@
+#include "memory.hpp"
+
+// memory.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+#include <optional>
+
+// A scalar global, with a null index, or the element of a vector at the index
+typedef std::pair<SymbolTableEntry, SymbolTableEntry> MemoryLocation;
+// Temporary or literal that holds the value of each location
+typedef std::map<MemoryLocation, SymbolTableEntry> MemoryValues;
+// Locations that are written again on every path before anything may read them
+typedef std::set<MemoryLocation> MemoryLocations;
+
+template <typename Container, typename Predicate>
+void forget_if(Container &container, Predicate predicate)
+{
+    for (auto it = container.begin(); it != container.end();)
+    {
+        if (predicate(*it))
+        {
+            it = container.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+// Literal indices are compared by value, as the same value may have several literals
+bool same_index(const SymbolTableEntry &first, const SymbolTableEntry &second)
+{
+    if (first == second)
+    {
+        return true;
+    }
+    if (!first || !second || !first->is_literal() || !second->is_literal() || first->get_data_type() != second->get_data_type())
+    {
+        return false;
+    }
+    if (first->get_data_type() == TYPE_INT)
+    {
+        return std::stol(first->get_text()) == std::stol(second->get_text());
+    }
+    return first->get_text() == second->get_text();
+}
+
+bool same_location(const MemoryLocation &first, const MemoryLocation &second)
+{
+    return first.first == second.first && same_index(first.second, second.second);
+}
+
+// Distinct globals and vectors never alias, elements of a vector only when the indices may be equal
+bool may_alias(const MemoryLocation &first, const MemoryLocation &second)
+{
+    if (first.first != second.first)
+    {
+        return false;
+    }
+    const auto first_index = first.second;
+    const auto second_index = second.second;
+    const auto constant_indices = first_index && second_index && first_index->is_literal() && second_index->is_literal()
+                                  && first_index->get_data_type() == second_index->get_data_type();
+    return !constant_indices || same_index(first_index, second_index);
+}
+
+SymbolTableEntry known_value(const MemoryValues &values, const MemoryLocation &location)
+{
+    for (const auto &[known, holder] : values)
+    {
+        if (same_location(known, location))
+        {
+            return holder;
+        }
+    }
+    return nullptr;
+}
+
+// Only temporaries and literals are kept as values, they do not live in memory themselves
+bool can_hold(const SymbolTableEntry &holder, const DataType data_type)
+{
+    return holder && (holder->is_temporary() || holder->is_literal()) && holder->get_data_type() == data_type;
+}
+
+class MemoryDataflow
+{
+private:
+    ControlFlowGraph &cfg;
+    const std::set<SymbolTableEntry> &globals;
+    const CallSummaries &summaries;
+    const std::string function;
+
+    bool is_memory_scalar(const SymbolTableEntry &symbol) const
+    {
+        return symbol && symbol->ident_type == IDENT_VAR && globals.count(symbol) != 0;
+    }
+
+    // Values held by the symbol, in it or indexed by it, are lost when the symbol is written
+    static void forget_symbol(MemoryValues &values, const SymbolTableEntry &symbol)
+    {
+        forget_if(values, [&symbol](const auto &entry) {
+            return entry.first.first == symbol || entry.first.second == symbol || entry.second == symbol;
+        });
+    }
+
+    // A null vector stands for a write through a pointer, which may write any vector
+    static void forget_vector(MemoryValues &values, const SymbolTableEntry &vector)
+    {
+        forget_if(values, [&vector](const auto &entry) {
+            return entry.first.second && (!vector || entry.first.first == vector);
+        });
+    }
+
+    void transfer_values(MemoryValues &values, const TACptr &tac) const
+    {
+        const auto result = tac->get_result();
+        const auto first = tac->get_first_operator();
+        const auto second = tac->get_second_operator();
+        switch (tac->get_type())
+        {
+        case TAC_CALL:
+            {
+                const auto summary = summaries.of_call(function, tac);
+                if (!summary)
+                {
+                    values.clear();
+                    return;
+                }
+                for (const auto &written : summary->writes)
+                {
+                    forget_symbol(values, written);
+                }
+                if (summary->writes_any_vector)
+                {
+                    forget_vector(values, nullptr);
+                }
+                for (const auto &vector : summary->written_vectors)
+                {
+                    forget_vector(values, vector);
+                }
+                forget_symbol(values, result);
+                return;
+            }
+        case TAC_VECSTORE:
+            {
+                const MemoryLocation location{result, second};
+                forget_if(values, [&location](const auto &entry) { return may_alias(entry.first, location); });
+                if (can_hold(first, result->get_data_type()))
+                {
+                    values[location] = first;
+                }
+                return;
+            }
+        case TAC_PACKED_STORE:
+            forget_vector(values, result);
+            return;
+        case TAC_PTRSTORE:
+        case TAC_FILL:
+        case TAC_COPY:
+            forget_vector(values, nullptr);
+            return;
+        case TAC_VECLOAD:
+            forget_symbol(values, result);
+            if (result != second && can_hold(result, first->get_data_type()))
+            {
+                values[{first, second}] = result;
+            }
+            return;
+        case TAC_MOVE:
+            forget_symbol(values, result);
+            if (is_memory_scalar(result) && can_hold(first, result->get_data_type()))
+            {
+                values[{result, nullptr}] = first;
+            }
+            else if (is_memory_scalar(first) && can_hold(result, first->get_data_type()))
+            {
+                values.insert({{first, nullptr}, result});
+            }
+            return;
+        default:
+            {
+                const auto definition = tac->get_definition();
+                if (definition)
+                {
+                    forget_symbol(values, definition);
+                }
+                return;
+            }
+        }
+    }
+
+    // Reads the known values instead of memory, returns false if the TAC became useless and must be removed
+    bool forward_values(const MemoryValues &values, const TACptr &tac) const
+    {
+        const auto type = tac->get_type();
+        if (type == TAC_VECLOAD)
+        {
+            const auto holder = known_value(values, {tac->get_first_operator(), tac->get_second_operator()});
+            if (holder == tac->get_result())
+            {
+                return false;
+            }
+            if (holder)
+            {
+                tac->set_type(TAC_MOVE);
+                tac->set_first_operator(holder);
+                tac->set_second_operator(nullptr);
+            }
+            return true;
+        }
+
+        const auto forwarded = [this, &values](const SymbolTableEntry &symbol) {
+            const auto holder = is_memory_scalar(symbol) ? known_value(values, {symbol, nullptr}) : nullptr;
+            return holder ? holder : symbol;
+        };
+        tac->set_first_operator(forwarded(tac->get_first_operator()));
+        tac->set_second_operator(forwarded(tac->get_second_operator()));
+        if (type == TAC_RET || type == TAC_PRINT)
+        {
+            tac->set_result(forwarded(tac->get_result()));
+        }
+
+        // Stores of the value the location already holds
+        if (type == TAC_MOVE && is_memory_scalar(tac->get_result()))
+        {
+            return known_value(values, {tac->get_result(), nullptr}) != tac->get_first_operator();
+        }
+        if (type == TAC_VECSTORE)
+        {
+            return known_value(values, {tac->get_result(), tac->get_second_operator()}) != tac->get_first_operator();
+        }
+        return true;
+    }
+
+    // Values known on entry to the block, nullopt while no predecessor has been visited
+    std::optional<MemoryValues> entry_values(const std::vector<std::optional<MemoryValues>> &exit_values, const size_t block) const
+    {
+        // The entry is also reached from the caller, which leaves nothing known
+        if (block == 0)
+        {
+            return MemoryValues();
+        }
+        std::optional<MemoryValues> values;
+        for (const auto predecessor : cfg.blocks[block].predecessors)
+        {
+            const auto &incoming = exit_values[predecessor];
+            if (!cfg.is_reachable(predecessor) || !incoming)
+            {
+                continue;
+            }
+            if (!values)
+            {
+                values = incoming;
+                continue;
+            }
+            forget_if(*values, [&incoming](const auto &entry) {
+                const auto found = incoming->find(entry.first);
+                return found == incoming->end() || found->second != entry.second;
+            });
+        }
+        return values;
+    }
+
+    // The location the TAC always writes, nullopt if it writes no memory or only may write it
+    std::optional<MemoryLocation> stored_location(const TACptr &tac) const
+    {
+        if (tac->get_type() == TAC_VECSTORE)
+        {
+            return MemoryLocation{tac->get_result(), tac->get_second_operator()};
+        }
+        const auto definition = tac->get_definition();
+        if (tac->get_type() != TAC_CALL && is_memory_scalar(definition))
+        {
+            return MemoryLocation{definition, nullptr};
+        }
+        return std::nullopt;
+    }
+
+    // Walks the TAC backwards: what it writes is overwritten before its point, what it may read is not
+    void transfer_overwritten(MemoryLocations &overwritten, const TACptr &tac) const
+    {
+        const auto definition = tac->get_definition();
+        if (definition)
+        {
+            // The elements indexed by the symbol are other ones before it is written
+            forget_if(overwritten, [&definition](const auto &location) { return location.second == definition; });
+        }
+        const auto stored = stored_location(tac);
+        if (stored)
+        {
+            overwritten.insert(*stored);
+        }
+
+        const auto first = tac->get_first_operator();
+        const auto any_vector = [](const auto &location) { return location.second != nullptr; };
+        switch (tac->get_type())
+        {
+        case TAC_CALL:
+            {
+                const auto summary = summaries.of_call(function, tac);
+                if (!summary)
+                {
+                    overwritten.clear();
+                    return;
+                }
+                forget_if(overwritten, [summary](const auto &location) {
+                    return summary->reads.count(location.first) != 0 || summary->writes.count(location.second) != 0
+                           || summary->read_vectors.count(location.first) != 0 || (summary->reads_any_vector && location.second);
+                });
+                break;
+            }
+        case TAC_VECLOAD:
+            {
+                const MemoryLocation loaded{first, tac->get_second_operator()};
+                forget_if(overwritten, [&loaded](const auto &location) { return may_alias(location, loaded); });
+                break;
+            }
+        case TAC_PACKED_LOAD:
+            forget_if(overwritten, [&first](const auto &location) { return location.first == first; });
+            break;
+        case TAC_PTRLOAD:
+        case TAC_COPY:
+            forget_if(overwritten, any_vector);
+            break;
+        default:
+            break;
+        }
+        for (const auto &use : tac->get_uses())
+        {
+            if (is_memory_scalar(use))
+            {
+                overwritten.erase({use, nullptr});
+            }
+        }
+    }
+
+    // Locations overwritten after the block, nullopt while no successor has been visited
+    std::optional<MemoryLocations> exit_locations(const std::vector<std::optional<MemoryLocations>> &entry_locations,
+                                                  const std::vector<bool> &reaches_end, const size_t block) const
+    {
+        const auto &successors = cfg.blocks[block].successors;
+        // The caller may read anything once the function returns, and loops that never end are left alone
+        if (successors.empty() || !reaches_end[block])
+        {
+            return MemoryLocations();
+        }
+        std::optional<MemoryLocations> overwritten;
+        for (const auto successor : successors)
+        {
+            const auto &incoming = entry_locations[successor];
+            if (!incoming)
+            {
+                continue;
+            }
+            if (!overwritten)
+            {
+                overwritten = incoming;
+                continue;
+            }
+            forget_if(*overwritten, [&incoming](const auto &location) { return incoming->count(location) == 0; });
+        }
+        return overwritten;
+    }
+
+public:
+    MemoryDataflow(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals, const CallSummaries &summaries)
+        : cfg(cfg), globals(globals), summaries(summaries), function(cfg.function_name()) {}
+
+    // Forwards stored and loaded values to the later loads of the same location
+    void forward_memory_values()
+    {
+        const auto order = cfg.reverse_postorder();
+        std::vector<std::optional<MemoryValues>> exit_values(cfg.blocks.size());
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (const auto block : order)
+            {
+                auto values = entry_values(exit_values, block);
+                if (!values)
+                {
+                    continue;
+                }
+                for (const auto &tac : cfg.blocks[block].tacs)
+                {
+                    transfer_values(*values, tac);
+                }
+                if (exit_values[block] != values)
+                {
+                    exit_values[block] = values;
+                    changed = true;
+                }
+            }
+        }
+
+        for (const auto block : order)
+        {
+            auto values = entry_values(exit_values, block).value_or(MemoryValues());
+            TACList kept;
+            for (const auto &tac : cfg.blocks[block].tacs)
+            {
+                if (forward_values(values, tac))
+                {
+                    kept.push_back(tac);
+                }
+                transfer_values(values, tac);
+            }
+            cfg.blocks[block].tacs = kept;
+        }
+    }
+
+    // Removes the stores whose location is written again before anything may read it
+    void remove_dead_stores()
+    {
+        std::vector<bool> reaches_end(cfg.blocks.size(), false);
+        std::vector<size_t> stack;
+        for (size_t block = 0; block < cfg.blocks.size(); ++block)
+        {
+            if (cfg.blocks[block].successors.empty())
+            {
+                reaches_end[block] = true;
+                stack.push_back(block);
+            }
+        }
+        while (!stack.empty())
+        {
+            const auto block = stack.back();
+            stack.pop_back();
+            for (const auto predecessor : cfg.blocks[block].predecessors)
+            {
+                if (!reaches_end[predecessor])
+                {
+                    reaches_end[predecessor] = true;
+                    stack.push_back(predecessor);
+                }
+            }
+        }
+
+        auto order = cfg.reverse_postorder();
+        std::reverse(order.begin(), order.end());
+        std::vector<std::optional<MemoryLocations>> entry_locations(cfg.blocks.size());
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (const auto block : order)
+            {
+                auto overwritten = exit_locations(entry_locations, reaches_end, block);
+                if (!overwritten)
+                {
+                    continue;
+                }
+                const auto &tacs = cfg.blocks[block].tacs;
+                for (auto it = tacs.rbegin(); it != tacs.rend(); ++it)
+                {
+                    transfer_overwritten(*overwritten, *it);
+                }
+                if (entry_locations[block] != overwritten)
+                {
+                    entry_locations[block] = overwritten;
+                    changed = true;
+                }
+            }
+        }
+
+        for (const auto block : order)
+        {
+            auto overwritten = exit_locations(entry_locations, reaches_end, block).value_or(MemoryLocations());
+            TACList kept;
+            const auto &tacs = cfg.blocks[block].tacs;
+            for (auto it = tacs.rbegin(); it != tacs.rend(); ++it)
+            {
+                const auto &tac = *it;
+                const auto stored = stored_location(tac);
+                const auto is_dead = stored && (tac->get_type() == TAC_VECSTORE || tac->is_pure())
+                                     && std::any_of(overwritten.begin(), overwritten.end(),
+                                                    [&stored](const auto &location) { return same_location(location, *stored); });
+                transfer_overwritten(overwritten, tac);
+                if (!is_dead)
+                {
+                    kept.push_back(tac);
+                }
+            }
+            std::reverse(kept.begin(), kept.end());
+            cfg.blocks[block].tacs = kept;
+        }
+    }
+};
+
+void optimize_memory_accesses(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals, const CallSummaries &summaries)
+{
+    MemoryDataflow dataflow(cfg, globals, summaries);
+    dataflow.forward_memory_values();
+    dataflow.remove_dead_stores();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// memory.hpp file made by Ian Kersz Amaral - 2025/1
+// Dataflow over the memory the functions read and write: scalar globals and vector elements.
+// Values stored or loaded are forwarded to the later loads of the same location on every path,
+// and stores overwritten on every path before anything reads them are removed. Distinct globals
+// and vectors never alias, and neither do elements at different literal indices.
+
+#include "cfg.hpp"
+#include "summaries.hpp"
+
+void optimize_memory_accesses(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals, const CallSummaries &summaries);
@@ -0,0 +1,190 @@
+#include "optimizer.hpp"
+
+// optimizer.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "cfg.hpp"
+#include "value_numbering.hpp"
+#include "licm.hpp"
+#include "induction.hpp"
+#include "inliner.hpp"
+#include "tail_recursion.hpp"
+#include "simplify_cfg.hpp"
+#include "unroll.hpp"
+#include "vectorize.hpp"
+#include "idioms.hpp"
+#include "bounds.hpp"
+#include "summaries.hpp"
+#include "dead_globals.hpp"
+#include "promotion.hpp"
+#include "memory.hpp"
+
+#include <limits>
+#include <set>
+#include <stdexcept>
+
+bool OptimizerOptions::parse_flag(const std::string &flag)
+{
+    if (flag.size() == 3 && flag.rfind("-O", 0) == 0 && flag[2] >= '0' && flag[2] <= '3')
+    {
+        level = static_cast<unsigned>(flag[2] - '0');
+        return true;
+    }
+    if (flag == "-mavx2")
+    {
+        avx2 = true;
+        return true;
+    }
+    if (flag == "-ffast-math")
+    {
+        fast_math = true;
+        return true;
+    }
+    if (flag == "--bounds-check")
+    {
+        bounds_check = true;
+        return true;
+    }
+    const std::vector<std::pair<std::string, unsigned *>> numeric_flags = {
+        {"--inline-threshold=", &inline_threshold},
+        {"--unroll-factor=", &unroll_factor},
+    };
+    for (const auto &[prefix, target] : numeric_flags)
+    {
+        if (flag.rfind(prefix, 0) != 0 || flag.size() == prefix.size())
+        {
+            continue;
+        }
+        const auto value = flag.substr(prefix.size());
+        if (value.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+        // Values that do not fit are as unknown as the ones that are not numbers
+        try
+        {
+            const auto parsed = std::stoul(value);
+            if (parsed > std::numeric_limits<unsigned>::max())
+            {
+                return false;
+            }
+            *target = static_cast<unsigned>(parsed);
+        }
+        catch (const std::out_of_range &)
+        {
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Removes expressions whose temporary is never read anywhere in the program
+void remove_dead_temporaries(Program &program)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        std::set<SymbolTableEntry> used;
+        for (const auto &function : program.functions)
+        {
+            for (const auto &block : function.blocks)
+            {
+                for (const auto &tac : block.tacs)
+                {
+                    for (const auto &use : tac->get_uses())
+                    {
+                        used.insert(use);
+                    }
+                }
+            }
+        }
+
+        for (auto &function : program.functions)
+        {
+            for (auto &block : function.blocks)
+            {
+                TACList kept;
+                for (const auto &tac : block.tacs)
+                {
+                    const auto definition = tac->get_definition();
+                    if (tac->is_pure() && definition && definition->is_temporary() && used.count(definition) == 0)
+                    {
+                        changed = true;
+                        continue;
+                    }
+                    kept.push_back(tac);
+                }
+                block.tacs = kept;
+            }
+        }
+    }
+}
+
+TACList optimize_tacs(const TACList &tac_list, const OptimizerOptions &options)
+{
+    const auto checked_list = options.bounds_check ? insert_bounds_checks(tac_list) : tac_list;
+    if (options.level == 0)
+    {
+        return checked_list;
+    }
+
+    auto program = Program::split(checked_list);
+    const auto vector_sizes = program.vector_sizes();
+    const auto globals = Program::scalar_globals();
+
+    if (options.level >= 2)
+    {
+        inline_functions(program, options.inline_threshold);
+        propagate_constant_arguments(program);
+    }
+    const auto call_graph = CallGraph::build(program);
+    const auto summaries = CallSummaries::build(program, call_graph);
+
+    for (auto &function : program.functions)
+    {
+        const auto entry_values = initial_values(program, call_graph, function);
+        simplify_control_flow(function);
+        if (options.level >= 2)
+        {
+            eliminate_tail_recursion(function, call_graph);
+            global_value_numbering(function, summaries);
+            remove_unused_calls(function, summaries);
+            hoist_loop_invariants(function, vector_sizes, summaries);
+            if (options.bounds_check)
+            {
+                eliminate_bounds_checks(function, entry_values, summaries);
+            }
+            if (options.level >= 3)
+            {
+                recognize_idioms(function);
+                const auto epilogues = vectorize_loops(function, vector_sizes, options.avx2, options.fast_math);
+                unroll_loops(function, options.unroll_factor, epilogues);
+                // The unrolled copies index past the counter, but only while the strip loop test allows it
+                if (options.bounds_check)
+                {
+                    eliminate_bounds_checks(function, entry_values, summaries);
+                }
+            }
+            reduce_induction_variables(function, globals);
+            promote_globals(function, globals, summaries);
+            optimize_memory_accesses(function, globals, summaries);
+            // Preheaders left empty and the blocks split by the loop passes
+            simplify_control_flow(function);
+        }
+        else
+        {
+            local_value_numbering(function, summaries);
+            if (options.bounds_check)
+            {
+                eliminate_bounds_checks(function, entry_values, summaries);
+            }
+        }
+    }
+    // Inlining leaves functions nothing calls anymore
+    remove_unreachable_globals(program);
+    remove_dead_temporaries(program);
+
+    return program.flatten();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// optimizer.hpp file made by Ian Kersz Amaral - 2025/1
+// Runs the optimization passes over the TAC list, according to the chosen level.
+
+#include "tac.hpp"
+
+#include <string>
+#include <vector>
+
+typedef struct OptimizerOptions
+{
+    // -O0 keeps the TAC as generated, -O1 and above enable the passes
+    unsigned level = 0;
+    // Largest function, in TACs, the inliner copies into a call outside of loops
+    unsigned inline_threshold = 24;
+    // Copies of the body per iteration of loops unrolled at -O3, 1 disables partial unrolling
+    unsigned unroll_factor = 4;
+    // Vectorized loops use 32 byte AVX2 instructions instead of 16 byte SSE2 ones
+    bool avx2 = false;
+    // Real arithmetic may be reordered as if it were exact, and NaNs are assumed not to happen
+    bool fast_math = false;
+    // Vector accesses stop the program when the index is outside the vector
+    bool bounds_check = false;
+
+    // Parses a single command line flag, returns false if it is not an optimizer flag
+    bool parse_flag(const std::string &flag);
+} OptimizerOptions;
+
+TACList optimize_tacs(const TACList &tac_list, const OptimizerOptions &options);
@@ -0,0 +1,245 @@
+#include "peephole.hpp"
+
+// peephole.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <map>
+
+typedef struct PeepholeRule
+{
+    const char *name;
+    // Number of consecutive instructions the rule looks at
+    size_t window;
+    // Rewrites the window in place, returns false if it does not match
+    bool (*rewrite)(InstructionList &window);
+} PeepholeRule;
+
+// Moves through the SSE and AVX registers, a value stored by one is only loaded back by the same one
+bool is_vector_move(const Instruction &instruction)
+{
+    return instruction.is("movss", 2) || instruction.is("movdqu", 2) || instruction.is("movups", 2)
+        || instruction.is("vmovdqu", 2) || instruction.is("vmovups", 2);
+}
+
+bool is_store(const Instruction &instruction)
+{
+    return (instruction.is("mov", 2) || is_vector_move(instruction)) && instruction.operands[0].is_memory();
+}
+
+bool is_load(const Instruction &instruction)
+{
+    const auto loads = instruction.is("mov", 2) || is_vector_move(instruction) || instruction.is("movzx", 2)
+        || instruction.is("movsx", 2) || instruction.is("movsxd", 2);
+    return loads && instruction.operands[0].is_register() && instruction.operands[1].is_memory();
+}
+
+// mov [x], eax; mov ecx, [x] -> mov [x], eax; mov ecx, eax
+bool forward_stored_value(InstructionList &window)
+{
+    const auto &store = window[0];
+    auto &load = window[1];
+    if (!is_store(store) || !is_load(load) || store.operands[0] != load.operands[1])
+    {
+        return false;
+    }
+    const auto &value = store.operands[1];
+    if ((is_vector_move(store) || is_vector_move(load)) && store.opcode != load.opcode)
+    {
+        return false;
+    }
+    if (value.kind == OPERAND_IMMEDIATE && load.opcode != "mov")
+    {
+        return false;
+    }
+    if (!value.is_register() && value.kind != OPERAND_IMMEDIATE)
+    {
+        return false;
+    }
+    if (load.opcode == store.opcode && load.operands[0] == value)
+    {
+        window.pop_back();
+        return true;
+    }
+    load.operands[1] = value;
+    return true;
+}
+
+// setcc al; and al, 1 -> setcc al, the set instructions already give 0 or 1
+bool drop_setcc_mask(InstructionList &window)
+{
+    const auto &set = window[0];
+    const auto &mask = window[1];
+    const auto is_set = set.kind == INSTRUCTION_OPERATION && set.opcode.rfind("set", 0) == 0 && set.operands.size() == 1;
+    if (!is_set || !mask.is("and", 2) || mask.operands[0] != set.operands[0] || mask.operands[1].text != "1")
+    {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+bool is_zero_extension_of(const Instruction &instruction, const Operand &destination)
+{
+    return instruction.is("movzx", 2) && instruction.operands[0] == destination;
+}
+
+// movzx eax, [x]; movzx eax, al -> movzx eax, [x]
+bool drop_repeated_zero_extension(InstructionList &window)
+{
+    const auto &first = window[0];
+    const auto &second = window[1];
+    if (!first.is("movzx", 2) || !is_zero_extension_of(second, first.operands[0]))
+    {
+        return false;
+    }
+    const auto &source = second.operands[1];
+    if (!source.is_register() || source.size != 1 || !source.same_register(first.operands[0]))
+    {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+// movzx eax, [x]; mov [y], al; movzx eax, al -> movzx eax, [x]; mov [y], al
+bool drop_zero_extension_after_store(InstructionList &window)
+{
+    const auto &first = window[0];
+    const auto &store = window[1];
+    const auto &third = window[2];
+    if (!first.is("movzx", 2) || !is_store(store) || !is_zero_extension_of(third, first.operands[0]))
+    {
+        return false;
+    }
+    const auto &source = third.operands[1];
+    if (store.operands[1] != source || !source.is_register() || source.size != 1 || !source.same_register(first.operands[0]))
+    {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+std::string negated_jump(const std::string &set)
+{
+    static const std::map<std::string, std::string> negations = {
+        {"sete", "jne"}, {"setne", "je"}, {"setl", "jge"}, {"setge", "jl"}, {"setg", "jle"}, {"setle", "jg"},
+        {"setb", "jae"}, {"setae", "jb"}, {"seta", "jbe"}, {"setbe", "ja"},
+    };
+    const auto found = negations.find(set);
+    return found == negations.end() ? "" : found->second;
+}
+
+// setcc al; [mov [x], al;] movzx eax, al; cmp eax, 0; je label -> setcc al; [mov [x], al;] jncc label
+// The flags of the comparison are still there, the mov instructions do not change them
+bool branch_on_flags(InstructionList &window)
+{
+    const auto &set = window[0];
+    const auto has_store = window.size() == 5;
+    const auto &extension = window[has_store ? 2 : 1];
+    const auto &compare = window[has_store ? 3 : 2];
+    const auto &jump = window[has_store ? 4 : 3];
+
+    const auto jump_opcode = set.kind == INSTRUCTION_OPERATION && set.operands.size() == 1 ? negated_jump(set.opcode) : "";
+    if (jump_opcode.empty() || !extension.is("movzx", 2) || !compare.is("cmp", 2) || !jump.is("je", 1))
+    {
+        return false;
+    }
+    const auto &flag = set.operands[0];
+    const auto &extended = extension.operands[0];
+    if (extension.operands[1] != flag || compare.operands[0] != extended || compare.operands[1].text != "0")
+    {
+        return false;
+    }
+    if (has_store && (!is_store(window[1]) || window[1].operands[1] != flag))
+    {
+        return false;
+    }
+    Instruction branch{INSTRUCTION_OPERATION, jump_opcode, jump.operands};
+    window.resize(has_store ? 2 : 1);
+    window.push_back(branch);
+    return true;
+}
+
+// jmp label; label: -> label:
+bool drop_jump_to_next(InstructionList &window)
+{
+    const auto &jump = window[0];
+    const auto &label = window[1];
+    if (!jump.is_jump() || jump.operands.size() != 1 || label.kind != INSTRUCTION_LABEL || jump.operands[0].text != label.opcode)
+    {
+        return false;
+    }
+    window.erase(window.begin());
+    return true;
+}
+
+// mov rax, rax does nothing, a 32 bit move would still clear the upper half
+bool drop_self_move(InstructionList &window)
+{
+    const auto &move = window[0];
+    const auto is_move = move.is("mov", 2) || move.is("movss", 2);
+    if (!is_move || !move.operands[0].is_register() || move.operands[0] != move.operands[1] || move.operands[0].size == 4)
+    {
+        return false;
+    }
+    window.clear();
+    return true;
+}
+
+// mov r9d, eax; mov eax, r9d -> mov r9d, eax, the second copies the value back where it already is
+bool drop_move_back(InstructionList &window)
+{
+    const auto &first = window[0];
+    const auto &second = window[1];
+    if (!first.is("mov", 2) || !second.is("mov", 2) || !first.operands[0].is_register() || !first.operands[1].is_register())
+    {
+        return false;
+    }
+    if (second.operands[0] != first.operands[1] || second.operands[1] != first.operands[0])
+    {
+        return false;
+    }
+    window.pop_back();
+    return true;
+}
+
+static const std::vector<PeepholeRule> PEEPHOLE_RULES = {
+    {"forward stored value", 2, forward_stored_value},
+    {"drop setcc mask", 2, drop_setcc_mask},
+    {"drop repeated zero extension", 2, drop_repeated_zero_extension},
+    {"drop zero extension after store", 3, drop_zero_extension_after_store},
+    {"branch on flags", 5, branch_on_flags},
+    {"branch on flags", 4, branch_on_flags},
+    {"drop jump to next", 2, drop_jump_to_next},
+    {"drop self move", 1, drop_self_move},
+    {"drop move back", 2, drop_move_back},
+};
+
+void peephole_optimize(InstructionList &instructions)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = 0; i < instructions.size(); ++i)
+        {
+            for (const auto &rule : PEEPHOLE_RULES)
+            {
+                if (i + rule.window > instructions.size())
+                {
+                    continue;
+                }
+                const auto begin = instructions.begin() + static_cast<long>(i);
+                const auto end = begin + static_cast<long>(rule.window);
+                InstructionList window(begin, end);
+                if (!rule.rewrite(window))
+                {
+                    continue;
+                }
+                const auto position = instructions.erase(begin, end);
+                instructions.insert(position, window.begin(), window.end());
+                changed = true;
+            }
+        }
+    }
+}
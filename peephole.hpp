@@ -0,0 +1,9 @@
+#pragma once
+
+// peephole.hpp file made by Ian Kersz Amaral - 2025/1
+// Rewrites short sequences of the emitted instructions, like reloading a value that was
+// just stored, following a table of rules until none of them applies.
+
+#include "instruction.hpp"
+
+void peephole_optimize(InstructionList &instructions);
@@ -0,0 +1,177 @@
+#include "promotion.hpp"
+
+// promotion.cpp file made by Ian Kersz Amaral - 2025/1
+
+// The summary is nullptr when the call may read and write anything
+bool call_may_touch(const FunctionSummary *summary, const SymbolTableEntry &global)
+{
+    return !summary || summary->reads.count(global) != 0 || summary->writes.count(global) != 0;
+}
+
+bool call_may_write(const FunctionSummary *summary, const SymbolTableEntry &global)
+{
+    return !summary || summary->writes.count(global) != 0;
+}
+
+bool is_promotable(const SymbolTableEntry &symbol, const std::set<SymbolTableEntry> &globals)
+{
+    if (!symbol || globals.count(symbol) == 0 || symbol->ident_type != IDENT_VAR)
+    {
+        return false;
+    }
+    const auto type = symbol->get_data_type();
+    return type == TYPE_INT || type == TYPE_CHAR || type == TYPE_REAL;
+}
+
+void promote_globals(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals, const CallSummaries &summaries)
+{
+    const auto function = cfg.function_name();
+    std::vector<bool> in_loop(cfg.blocks.size(), false);
+    for (const auto &loop : cfg.find_loops())
+    {
+        for (const auto block : loop.blocks)
+        {
+            in_loop[block] = true;
+        }
+    }
+
+    // Globals mentioned inside loops, except the ones a call or a READ inside a loop may change
+    std::set<SymbolTableEntry> candidates;
+    std::set<SymbolTableEntry> excluded;
+    for (size_t block = 0; block < cfg.blocks.size(); ++block)
+    {
+        if (!in_loop[block])
+        {
+            continue;
+        }
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            if (tac->get_type() == TAC_CALL)
+            {
+                const auto summary = summaries.of_call(function, tac);
+                if (!summary)
+                {
+                    return;
+                }
+                excluded.insert(summary->reads.begin(), summary->reads.end());
+                excluded.insert(summary->writes.begin(), summary->writes.end());
+            }
+            else if (tac->get_type() == TAC_READ)
+            {
+                excluded.insert(tac->get_result());
+            }
+            for (const auto &symbol : {tac->get_result(), tac->get_first_operator(), tac->get_second_operator()})
+            {
+                if (is_promotable(symbol, globals))
+                {
+                    candidates.insert(symbol);
+                }
+            }
+        }
+    }
+
+    std::map<SymbolTableEntry, SymbolTableEntry> promoted;
+    for (const auto &global : candidates)
+    {
+        if (excluded.count(global) == 0)
+        {
+            promoted[global] = register_temp(global->get_data_type());
+        }
+    }
+    if (promoted.empty())
+    {
+        return;
+    }
+
+    // Only the globals the function changes are stored back
+    std::set<SymbolTableEntry> written;
+    for (const auto &block : cfg.blocks)
+    {
+        for (const auto &tac : block.tacs)
+        {
+            const auto definition = tac->get_definition();
+            if (promoted.count(definition) != 0)
+            {
+                written.insert(definition);
+            }
+        }
+    }
+    const auto load = [&](const SymbolTableEntry &global) { return make_tac(TAC_MOVE, promoted.at(global), global, SymbolTableEntry()); };
+    const auto store = [&](const SymbolTableEntry &global) { return make_tac(TAC_MOVE, global, promoted.at(global), SymbolTableEntry()); };
+    const auto store_all = [&](TACList &tacs) {
+        for (const auto &global : written)
+        {
+            tacs.push_back(store(global));
+        }
+    };
+    // Nothing reads the globals after main returns
+    const auto returns_to_caller = function != "_main";
+
+    for (auto &block : cfg.blocks)
+    {
+        TACList tacs;
+        for (const auto &tac : block.tacs)
+        {
+            const auto type = tac->get_type();
+            if (type == TAC_CALL)
+            {
+                const auto summary = summaries.of_call(function, tac);
+                for (const auto &global : written)
+                {
+                    if (call_may_touch(summary, global))
+                    {
+                        tacs.push_back(store(global));
+                    }
+                }
+                tacs.push_back(tac);
+                for (const auto &[global, temporary] : promoted)
+                {
+                    if (call_may_write(summary, global))
+                    {
+                        tacs.push_back(load(global));
+                    }
+                }
+                continue;
+            }
+            // READ still writes the global itself, the temporary is loaded right after
+            if (type == TAC_READ && promoted.count(tac->get_result()) != 0)
+            {
+                tacs.push_back(tac);
+                tacs.push_back(load(tac->get_result()));
+                continue;
+            }
+            if (type == TAC_RET && returns_to_caller)
+            {
+                store_all(tacs);
+            }
+
+            const auto rename = [&](const SymbolTableEntry &symbol) {
+                const auto found = promoted.find(symbol);
+                return found != promoted.end() ? found->second : symbol;
+            };
+            tac->set_result(rename(tac->get_result()));
+            tac->set_first_operator(rename(tac->get_first_operator()));
+            tac->set_second_operator(rename(tac->get_second_operator()));
+            tacs.push_back(tac);
+        }
+        block.tacs = tacs;
+    }
+
+    // Falling into the end of the function also returns
+    const auto last = cfg.blocks.empty() ? nullptr : cfg.blocks.back().get_terminator();
+    if (returns_to_caller && !(last && (last->get_type() == TAC_RET || last->get_type() == TAC_JUMP)))
+    {
+        BasicBlock exit;
+        store_all(exit.tacs);
+        cfg.blocks.push_back(exit);
+    }
+
+    // A new entry block, as the first one may be the header of a loop
+    BasicBlock entry;
+    for (const auto &[global, temporary] : promoted)
+    {
+        entry.tacs.push_back(load(global));
+    }
+    cfg.blocks.insert(cfg.blocks.begin(), entry);
+    cfg.connect_blocks();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// promotion.hpp file made by Ian Kersz Amaral - 2025/1
+// Promotes the global variables a function reads or writes inside its loops to temporaries, so
+// the register allocator can keep them in registers. The temporary is loaded on entry and after
+// the calls and reads that may change the global, and stored back before the calls that may see
+// it and when the function returns. Globals that a call inside a loop may touch are left alone.
+
+#include "summaries.hpp"
+
+void promote_globals(ControlFlowGraph &cfg, const std::set<SymbolTableEntry> &globals, const CallSummaries &summaries);
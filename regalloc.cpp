@@ -0,0 +1,440 @@
+#include "regalloc.hpp"
+
+// regalloc.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+
+// rax, rcx, rdx, rsi, rdi and xmm0 to xmm2 are the scratch registers of the emitter, rbx is never used.
+// Caller saved registers come first, so functions that need few registers save none.
+static const std::vector<std::string> GENERAL_REGISTERS = {"r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+static const std::set<std::string> CALLEE_SAVED_REGISTERS = {"r12", "r13", "r14", "r15"};
+static const std::vector<std::string> XMM_REGISTERS = {"xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8", "xmm9", "xmm10",
+                                                       "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"};
+static const std::vector<std::string> GENERAL_ARGUMENTS = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+static const std::vector<std::string> XMM_ARGUMENTS = {"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7"};
+
+typedef struct LiveInterval
+{
+    SymbolTableEntry symbol;
+    size_t start;
+    size_t end;
+    // Some call happens while the value is live, so only callee saved registers keep it
+    bool crosses_call;
+} LiveInterval;
+
+bool is_allocatable(const SymbolTableEntry &symbol)
+{
+    if (!symbol || !symbol->is_temporary())
+    {
+        return false;
+    }
+    switch (symbol->get_data_type())
+    {
+    case TYPE_INT:
+    case TYPE_CHAR:
+    case TYPE_BOOL:
+    case TYPE_REAL:
+    case TYPE_POINTER:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// TACs that call a function, of the program or of the C library, which may change every caller saved register
+bool is_call_site(const TACptr &tac)
+{
+    switch (tac->get_type())
+    {
+    case TAC_CALL:
+    case TAC_PRINT:
+    case TAC_READ:
+    case TAC_COPY:
+        return true;
+    case TAC_FILL:
+        // Characters are filled by memset, the others by rep stosd
+        return tac->get_first_operator()->get_data_type() == TYPE_CHAR;
+    default:
+        return false;
+    }
+}
+
+// Every symbol the TAC names as a value, the definition included
+std::vector<SymbolTableEntry> mentioned_symbols(const TACptr &tac)
+{
+    auto symbols = tac->get_uses();
+    const auto definition = tac->get_definition();
+    if (definition)
+    {
+        symbols.push_back(definition);
+    }
+    return symbols;
+}
+
+std::set<SymbolTableEntry> shared_temporaries(const TACList &tac_list)
+{
+    std::map<SymbolTableEntry, SymbolTableEntry> owner;
+    std::set<SymbolTableEntry> shared;
+    SymbolTableEntry function;
+    for (const auto &tac : tac_list)
+    {
+        if (tac->get_type() == TAC_BEGINFUN)
+        {
+            function = tac->get_result();
+        }
+        for (const auto &symbol : mentioned_symbols(tac))
+        {
+            if (!symbol || !symbol->is_temporary())
+            {
+                continue;
+            }
+            const auto found = owner.find(symbol);
+            if (found == owner.end())
+            {
+                owner[symbol] = function;
+            }
+            else if (found->second != function)
+            {
+                shared.insert(symbol);
+            }
+        }
+    }
+    return shared;
+}
+
+std::vector<std::string> argument_registers(const std::vector<SymbolTableEntry> &parameters)
+{
+    std::vector<std::string> registers;
+    size_t general = 0;
+    size_t xmm = 0;
+    for (const auto &parameter : parameters)
+    {
+        if (parameter->get_data_type() == TYPE_REAL)
+        {
+            registers.push_back(xmm < XMM_ARGUMENTS.size() ? XMM_ARGUMENTS[xmm++] : "");
+        }
+        else
+        {
+            registers.push_back(general < GENERAL_ARGUMENTS.size() ? GENERAL_ARGUMENTS[general++] : "");
+        }
+    }
+    return registers;
+}
+
+// The ARG of each parameter of every CALL. A call nested in the arguments of another one comes
+// first, so it takes the latest ARGs of its parameters.
+std::map<TACptr, std::vector<TACptr>> match_call_arguments(const TACList &function_tacs)
+{
+    std::map<TACptr, std::vector<TACptr>> calls;
+    std::vector<TACptr> pending;
+    for (const auto &tac : function_tacs)
+    {
+        if (tac->get_type() == TAC_ARG)
+        {
+            pending.push_back(tac);
+            continue;
+        }
+        if (tac->get_type() != TAC_CALL)
+        {
+            continue;
+        }
+        std::vector<TACptr> arguments;
+        for (const auto &parameter : function_parameters(tac->get_first_operator()))
+        {
+            const auto found = std::find_if(pending.rbegin(), pending.rend(), [&](const TACptr &argument) {
+                return argument->get_result() == parameter;
+            });
+            if (found == pending.rend())
+            {
+                // Parameters replaced by a constant in the function are not passed
+                arguments.push_back(nullptr);
+                continue;
+            }
+            arguments.push_back(*found);
+            pending.erase(std::next(found).base());
+        }
+        calls[tac] = arguments;
+    }
+    return calls;
+}
+
+// Whether the value of the ARG is still the same when its call runs, so the call can read it
+bool argument_reaches_call(const TACList &function_tacs, const size_t argument, const size_t call, const std::set<SymbolTableEntry> &locals)
+{
+    const auto value = function_tacs[argument]->get_first_operator();
+    if (value->is_literal())
+    {
+        return true;
+    }
+    for (auto i = argument + 1; i < call; ++i)
+    {
+        const auto &tac = function_tacs[i];
+        // Nested calls may change any global, but not the values of this call of the function
+        if (tac->get_definition() == value || (tac->get_type() == TAC_CALL && !locals.count(value)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<LiveInterval> build_intervals(const TACList &function_tacs, const std::map<TACptr, size_t> &positions, const std::set<SymbolTableEntry> &locals,
+                                          const std::vector<std::pair<SymbolTableEntry, size_t>> &extra_uses, const std::map<TACptr, TACptr> &folded)
+{
+    std::vector<size_t> call_positions;
+    for (size_t i = 0; i < function_tacs.size(); ++i)
+    {
+        if (is_call_site(function_tacs[i]))
+        {
+            call_positions.push_back(i);
+        }
+    }
+
+    std::map<SymbolTableEntry, std::pair<size_t, size_t>> ranges;
+    const auto extend = [&](const SymbolTableEntry &symbol, const size_t position) {
+        if (!locals.count(symbol))
+        {
+            return;
+        }
+        const auto found = ranges.find(symbol);
+        if (found == ranges.end())
+        {
+            ranges[symbol] = {position, position};
+            return;
+        }
+        found->second.first = std::min(found->second.first, position);
+        found->second.second = std::max(found->second.second, position);
+    };
+
+    for (size_t i = 0; i < function_tacs.size(); ++i)
+    {
+        const auto root = folded.find(function_tacs[i]);
+        const auto position = root == folded.end() ? i : positions.at(root->second);
+        for (const auto &symbol : mentioned_symbols(function_tacs[i]))
+        {
+            extend(symbol, position);
+        }
+    }
+    for (const auto &[symbol, position] : extra_uses)
+    {
+        extend(symbol, position);
+    }
+
+    // Values live into a block or out of it cover the whole block
+    const auto cfg = ControlFlowGraph::build(function_tacs);
+    const auto live = cfg.live_in({});
+    for (size_t block = 0; block < cfg.blocks.size(); ++block)
+    {
+        const auto &tacs = cfg.blocks[block].tacs;
+        if (tacs.empty())
+        {
+            continue;
+        }
+        const auto first = positions.at(tacs.front());
+        const auto last = positions.at(tacs.back());
+        for (const auto &symbol : live[block])
+        {
+            extend(symbol, first);
+        }
+        for (const auto successor : cfg.blocks[block].successors)
+        {
+            for (const auto &symbol : live[successor])
+            {
+                extend(symbol, last);
+            }
+        }
+    }
+
+    std::vector<LiveInterval> intervals;
+    for (const auto &[symbol, range] : ranges)
+    {
+        const auto [start, end] = range;
+        // A call that defines the value or reads it for the last time does not need it kept
+        const auto crosses_call = std::any_of(call_positions.begin(), call_positions.end(), [&](const size_t call) {
+            return start < call && call < end;
+        });
+        intervals.push_back({symbol, start, end, crosses_call});
+    }
+    std::sort(intervals.begin(), intervals.end(), [](const LiveInterval &a, const LiveInterval &b) {
+        return a.start != b.start ? a.start < b.start : a.symbol->get_text() < b.symbol->get_text();
+    });
+    return intervals;
+}
+
+// Registers the interval may be given, in order of preference
+std::vector<std::string> candidate_registers(const LiveInterval &interval)
+{
+    if (interval.symbol->get_data_type() == TYPE_REAL)
+    {
+        // Every xmm register is caller saved, reals live across a call go to the stack
+        return interval.crosses_call ? std::vector<std::string>() : XMM_REGISTERS;
+    }
+    if (!interval.crosses_call)
+    {
+        return GENERAL_REGISTERS;
+    }
+    std::vector<std::string> callee_saved;
+    std::copy_if(GENERAL_REGISTERS.begin(), GENERAL_REGISTERS.end(), std::back_inserter(callee_saved), [](const std::string &name) {
+        return CALLEE_SAVED_REGISTERS.count(name) != 0;
+    });
+    return callee_saved;
+}
+
+RegisterAllocation allocate_registers(const TACList &function_tacs, const std::set<SymbolTableEntry> &shared, const bool use_registers,
+                                      const std::map<TACptr, TACptr> &folded)
+{
+    RegisterAllocation allocation;
+    std::map<TACptr, size_t> positions;
+    for (size_t i = 0; i < function_tacs.size(); ++i)
+    {
+        positions[function_tacs[i]] = i;
+    }
+
+    // Values of this call of the function: its temporaries and the parameters passed in registers.
+    // The ones passed on the stack stay where the caller put them, above the return address.
+    std::set<SymbolTableEntry> locals;
+    // scanf writes the value through its address, so it needs a slot
+    std::set<SymbolTableEntry> memory_only;
+    std::set<SymbolTableEntry> folded_results;
+    for (const auto &tac : function_tacs)
+    {
+        for (const auto &symbol : mentioned_symbols(tac))
+        {
+            if (is_allocatable(symbol) && !shared.count(symbol))
+            {
+                locals.insert(symbol);
+            }
+        }
+        if (folded.count(tac))
+        {
+            folded_results.insert(tac->get_result());
+        }
+        if (tac->get_type() == TAC_READ)
+        {
+            memory_only.insert(tac->get_result());
+        }
+    }
+    for (const auto &result : folded_results)
+    {
+        locals.erase(result);
+    }
+    const auto parameters = function_parameters(function_tacs.front()->get_result());
+    const auto incoming = argument_registers(parameters);
+    std::vector<std::pair<SymbolTableEntry, size_t>> extra_uses;
+    long stack_argument = 16;
+    for (size_t i = 0; i < parameters.size(); ++i)
+    {
+        if (incoming[i].empty())
+        {
+            allocation.stack_slots[parameters[i]] = stack_argument;
+            stack_argument += 8;
+            continue;
+        }
+        locals.insert(parameters[i]);
+        // The prologue moves every parameter from its argument register
+        extra_uses.push_back({parameters[i], 0});
+    }
+
+    // Arguments the call can still read are live until it, the others are saved when the ARG runs
+    std::vector<TACptr> saved_arguments;
+    allocation.call_arguments = match_call_arguments(function_tacs);
+    for (const auto &[call, arguments] : allocation.call_arguments)
+    {
+        for (const auto &argument : arguments)
+        {
+            if (!argument)
+            {
+                continue;
+            }
+            if (argument_reaches_call(function_tacs, positions.at(argument), positions.at(call), locals))
+            {
+                extra_uses.push_back({argument->get_first_operator(), positions.at(call)});
+            }
+            else
+            {
+                saved_arguments.push_back(argument);
+            }
+        }
+    }
+
+    std::vector<SymbolTableEntry> spilled;
+    // Intervals holding a register, with the register
+    std::vector<std::pair<LiveInterval, std::string>> active;
+
+    for (const auto &interval : build_intervals(function_tacs, positions, locals, extra_uses, folded))
+    {
+        if (!use_registers || memory_only.count(interval.symbol))
+        {
+            spilled.push_back(interval.symbol);
+            continue;
+        }
+
+        // The registers of intervals that ended before this one starts are free again
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const std::pair<LiveInterval, std::string> &entry) {
+            return entry.first.end < interval.start;
+        }), active.end());
+
+        const auto candidates = candidate_registers(interval);
+        const auto free = std::find_if(candidates.begin(), candidates.end(), [&](const std::string &name) {
+            return std::none_of(active.begin(), active.end(), [&](const std::pair<LiveInterval, std::string> &entry) {
+                return entry.second == name;
+            });
+        });
+        if (free != candidates.end())
+        {
+            allocation.registers[interval.symbol] = *free;
+            active.push_back({interval, *free});
+            continue;
+        }
+
+        // Spills whichever interval that could give its register to this one ends last
+        auto furthest = active.end();
+        for (auto it = active.begin(); it != active.end(); ++it)
+        {
+            const auto usable = std::find(candidates.begin(), candidates.end(), it->second) != candidates.end();
+            if (usable && (furthest == active.end() || it->first.end > furthest->first.end))
+            {
+                furthest = it;
+            }
+        }
+        if (furthest == active.end() || furthest->first.end <= interval.end)
+        {
+            spilled.push_back(interval.symbol);
+            continue;
+        }
+        const auto name = furthest->second;
+        spilled.push_back(furthest->first.symbol);
+        allocation.registers.erase(furthest->first.symbol);
+        active.erase(furthest);
+        allocation.registers[interval.symbol] = name;
+        active.push_back({interval, name});
+    }
+
+    // Frame below rbp: the saved registers first, then one 8 byte slot per spilled value and saved argument
+    std::set<std::string> used;
+    for (const auto &[symbol, name] : allocation.registers)
+    {
+        used.insert(name);
+    }
+    long offset = 0;
+    for (const auto &name : GENERAL_REGISTERS)
+    {
+        if (CALLEE_SAVED_REGISTERS.count(name) && used.count(name))
+        {
+            offset += 8;
+            allocation.saved_registers.push_back({name, -offset});
+        }
+    }
+    for (const auto &symbol : spilled)
+    {
+        offset += 8;
+        allocation.stack_slots[symbol] = -offset;
+    }
+    for (const auto &argument : saved_arguments)
+    {
+        offset += 8;
+        allocation.argument_slots[argument] = -offset;
+    }
+    allocation.frame_size = (offset + 15) / 16 * 16;
+    return allocation;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// regalloc.hpp file made by Ian Kersz Amaral - 2025/1
+// Frame layout and linear scan register allocation for the temporaries and parameters of each
+// function. Live intervals come from the liveness over the control flow graph, and values that
+// do not fit in the free registers are spilled to stack slots below rbp. Values live across a
+// call only get the callee saved registers, which the function saves on entry and restores
+// when it returns. Arguments are passed in the System V registers, the rest on the stack.
+
+#include "cfg.hpp"
+
+typedef struct RegisterAllocation
+{
+    // Register of each temporary or parameter that got one, like r12 or xmm4
+    std::map<SymbolTableEntry, std::string> registers;
+    // Offset from rbp of the others: spill slots below it, parameters passed on the stack above it
+    std::map<SymbolTableEntry, long> stack_slots;
+    // Callee saved registers given to values, with the offset from rbp where they are kept
+    std::vector<std::pair<std::string, long>> saved_registers;
+    // The ARG that passes each parameter of every CALL, nullptr where no ARG does
+    std::map<TACptr, std::vector<TACptr>> call_arguments;
+    // ARGs whose value may change before their call, kept in a slot of the frame until it
+    std::map<TACptr, long> argument_slots;
+    // Bytes reserved below rbp, always a multiple of 16 so calls see an aligned stack
+    long frame_size = 0;
+} RegisterAllocation;
+
+// Register that passes each parameter, empty for the ones passed on the stack
+std::vector<std::string> argument_registers(const std::vector<SymbolTableEntry> &parameters);
+
+// Temporaries in the shared set always stay in their global storage. Without registers every
+// other value gets a stack slot, so each call still has its own. Folded TACs run at the TAC
+// they map to, and their results never leave the scratch registers of the emitter.
+RegisterAllocation allocate_registers(const TACList &function_tacs, const std::set<SymbolTableEntry> &shared, bool use_registers,
+                                      const std::map<TACptr, TACptr> &folded);
+
+// Temporaries that are read or written by more than one function
+std::set<SymbolTableEntry> shared_temporaries(const TACList &tac_list);
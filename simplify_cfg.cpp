@@ -0,0 +1,174 @@
+#include "simplify_cfg.hpp"
+
+// simplify_cfg.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+
+// Only a label and maybe a JUMP, so entering it just sends control somewhere else
+bool is_forwarding_block(const BasicBlock &block)
+{
+    for (size_t i = 0; i < block.tacs.size(); ++i)
+    {
+        const auto type = block.tacs[i]->get_type();
+        const auto is_last_jump = type == TAC_JUMP && i + 1 == block.tacs.size();
+        if (type != TAC_LABEL && !is_last_jump)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// First block entered from the given one that does something, following forwarding blocks
+size_t final_destination(const ControlFlowGraph &cfg, size_t block)
+{
+    std::set<size_t> visited;
+    while (is_forwarding_block(cfg.blocks[block]) && visited.insert(block).second)
+    {
+        const auto terminator = cfg.blocks[block].get_terminator();
+        if (terminator)
+        {
+            block = cfg.find_label_block(terminator->get_result());
+        }
+        else if (block + 1 < cfg.blocks.size())
+        {
+            block = block + 1;
+        }
+        else
+        {
+            // Falls off the end of the function
+            break;
+        }
+    }
+    return block;
+}
+
+bool thread_jumps(ControlFlowGraph &cfg)
+{
+    bool changed = false;
+    for (auto &block : cfg.blocks)
+    {
+        const auto terminator = block.get_terminator();
+        if (!terminator || terminator->get_type() == TAC_RET)
+        {
+            continue;
+        }
+        const auto target = cfg.find_label_block(terminator->get_result());
+        const auto destination = final_destination(cfg, target);
+        if (destination != target)
+        {
+            terminator->set_result(cfg.ensure_label(destination));
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        cfg.connect_blocks();
+    }
+    return changed;
+}
+
+// Removes JUMPs and IFZs that end up in the same block as falling through would
+bool fold_branches(ControlFlowGraph &cfg)
+{
+    bool changed = false;
+    for (size_t i = 0; i + 1 < cfg.blocks.size(); ++i)
+    {
+        auto &tacs = cfg.blocks[i].tacs;
+        const auto terminator = cfg.blocks[i].get_terminator();
+        if (!terminator || terminator->get_type() == TAC_RET)
+        {
+            continue;
+        }
+        const auto target = cfg.find_label_block(terminator->get_result());
+        if (final_destination(cfg, target) == final_destination(cfg, i + 1))
+        {
+            tacs.pop_back();
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        cfg.connect_blocks();
+    }
+    return changed;
+}
+
+bool remove_unreachable_blocks(ControlFlowGraph &cfg)
+{
+    bool changed = false;
+    for (size_t i = cfg.blocks.size(); i-- > 1;)
+    {
+        if (!cfg.is_reachable(i))
+        {
+            cfg.blocks.erase(cfg.blocks.begin() + static_cast<long>(i));
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        cfg.connect_blocks();
+    }
+    return changed;
+}
+
+bool remove_unused_labels(ControlFlowGraph &cfg)
+{
+    std::set<SymbolTableEntry> targets;
+    for (const auto &block : cfg.blocks)
+    {
+        const auto terminator = block.get_terminator();
+        if (terminator && terminator->get_type() != TAC_RET)
+        {
+            targets.insert(terminator->get_result());
+        }
+    }
+
+    bool changed = false;
+    for (auto &block : cfg.blocks)
+    {
+        const auto label = block.get_label();
+        if (label && targets.count(label) == 0)
+        {
+            block.tacs.erase(block.tacs.begin());
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// A block without a label can only be reached by falling into it, so it joins the one before
+bool merge_blocks(ControlFlowGraph &cfg)
+{
+    bool changed = false;
+    for (size_t i = cfg.blocks.size() - 1; i-- > 0;)
+    {
+        auto &block = cfg.blocks[i];
+        const auto &next = cfg.blocks[i + 1];
+        if (block.get_terminator() || next.get_label())
+        {
+            continue;
+        }
+        block.tacs.insert(block.tacs.end(), next.tacs.begin(), next.tacs.end());
+        cfg.blocks.erase(cfg.blocks.begin() + static_cast<long>(i + 1));
+        changed = true;
+    }
+    if (changed)
+    {
+        cfg.connect_blocks();
+    }
+    return changed;
+}
+
+void simplify_control_flow(ControlFlowGraph &cfg)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = thread_jumps(cfg);
+        changed = fold_branches(cfg) || changed;
+        changed = remove_unreachable_blocks(cfg) || changed;
+        changed = remove_unused_labels(cfg) || changed;
+        changed = merge_blocks(cfg) || changed;
+    }
+}
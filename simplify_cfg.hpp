@@ -0,0 +1,10 @@
+#pragma once
+
+// simplify_cfg.hpp file made by Ian Kersz Amaral - 2025/1
+// Control flow cleanup: jumps to jumps are threaded to their final target, branches that
+// go to the same place either way are removed, unreachable blocks and unused labels are
+// deleted and blocks that always run one after the other are merged.
+
+#include "cfg.hpp"
+
+void simplify_control_flow(ControlFlowGraph &cfg);
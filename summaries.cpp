@@ -0,0 +1,268 @@
+#include "summaries.hpp"
+
+// summaries.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "unroll.hpp"
+
+#include <algorithm>
+
+bool FunctionSummary::is_pure() const
+{
+    // Writing its parameters is fine, only the function itself reads them
+    const auto only_parameters = std::all_of(writes.begin(), writes.end(), [](const SymbolTableEntry &symbol) {
+        return symbol->ident_type == IDENT_PARAM;
+    });
+    return only_parameters && written_vectors.empty() && !writes_any_vector && !does_io && !may_trap && always_returns;
+}
+
+// Variables other functions can see, temporaries and literals are not
+bool is_shared_scalar(const SymbolTableEntry &symbol)
+{
+    return symbol && !symbol->is_literal() && !symbol->is_temporary();
+}
+
+// Effects of the TACs of the function itself, without its calls
+FunctionSummary summarize_body(const ControlFlowGraph &cfg)
+{
+    FunctionSummary summary;
+    summary.parameters = cfg.parameters();
+    summary.always_returns = cfg.find_loops().empty();
+    for (const auto &block : cfg.blocks)
+    {
+        for (const auto &tac : block.tacs)
+        {
+            for (const auto &use : tac->get_uses())
+            {
+                if (is_shared_scalar(use))
+                {
+                    summary.reads.insert(use);
+                }
+            }
+            const auto definition = tac->get_definition();
+            if (is_shared_scalar(definition))
+            {
+                summary.writes.insert(definition);
+            }
+            summary.may_trap = summary.may_trap || tac->may_trap();
+            switch (tac->get_type())
+            {
+            case TAC_VECLOAD:
+            case TAC_PACKED_LOAD:
+                summary.read_vectors.insert(tac->get_first_operator());
+                break;
+            case TAC_VECSTORE:
+            case TAC_PACKED_STORE:
+                summary.written_vectors.insert(tac->get_result());
+                break;
+            case TAC_PTRLOAD:
+                summary.reads_any_vector = true;
+                break;
+            case TAC_COPY:
+                summary.reads_any_vector = true;
+                summary.writes_any_vector = true;
+                break;
+            case TAC_PTRSTORE:
+            case TAC_FILL:
+                summary.writes_any_vector = true;
+                break;
+            case TAC_PRINT:
+            case TAC_READ:
+                summary.does_io = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    return summary;
+}
+
+// Adds what the callee does to the caller, returns true if the caller changed
+bool merge_summary(FunctionSummary &caller, const FunctionSummary &callee)
+{
+    const auto before = std::make_tuple(caller.reads.size(), caller.writes.size(), caller.read_vectors.size(), caller.written_vectors.size(),
+                                        caller.reads_any_vector, caller.writes_any_vector, caller.does_io, caller.may_trap, caller.always_returns);
+    caller.reads.insert(callee.reads.begin(), callee.reads.end());
+    caller.writes.insert(callee.writes.begin(), callee.writes.end());
+    caller.read_vectors.insert(callee.read_vectors.begin(), callee.read_vectors.end());
+    caller.written_vectors.insert(callee.written_vectors.begin(), callee.written_vectors.end());
+    caller.reads_any_vector = caller.reads_any_vector || callee.reads_any_vector;
+    caller.writes_any_vector = caller.writes_any_vector || callee.writes_any_vector;
+    caller.does_io = caller.does_io || callee.does_io;
+    caller.may_trap = caller.may_trap || callee.may_trap;
+    caller.always_returns = caller.always_returns && callee.always_returns;
+    const auto after = std::make_tuple(caller.reads.size(), caller.writes.size(), caller.read_vectors.size(), caller.written_vectors.size(),
+                                       caller.reads_any_vector, caller.writes_any_vector, caller.does_io, caller.may_trap, caller.always_returns);
+    return before != after;
+}
+
+CallSummaries CallSummaries::build(const Program &program, const CallGraph &call_graph)
+{
+    CallSummaries summaries;
+    summaries.function_index = call_graph.function_index;
+    summaries.component = call_graph.component;
+    for (size_t i = 0; i < program.functions.size(); ++i)
+    {
+        auto summary = summarize_body(program.functions[i]);
+        summary.always_returns = summary.always_returns && !call_graph.recursive[i];
+        summaries.functions.push_back(summary);
+    }
+
+    // Callees come first, only recursive cycles need more than one round
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto function : call_graph.bottom_up_order)
+        {
+            for (const auto callee : call_graph.callees[function])
+            {
+                if (callee != function && merge_summary(summaries.functions[function], summaries.functions[callee]))
+                {
+                    changed = true;
+                }
+            }
+        }
+    }
+    return summaries;
+}
+
+const FunctionSummary *CallSummaries::of_call(const std::string &caller, const TACptr &call) const
+{
+    const auto caller_index = function_index.find(caller);
+    const auto callee_index = function_index.find(call->get_first_operator()->get_text());
+    if (caller_index == function_index.end() || callee_index == function_index.end()
+        || component[caller_index->second] == component[callee_index->second])
+    {
+        return nullptr;
+    }
+    return &functions[callee_index->second];
+}
+
+// The literal every call passes to the parameter, nullptr if the calls differ or can not be matched
+SymbolTableEntry constant_argument(const Program &program, const ControlFlowGraph &function, const size_t parameter)
+{
+    const auto name = function.function_name();
+    const auto parameters = function.parameters();
+    const auto target = parameters[parameter];
+    SymbolTableEntry constant;
+    for (const auto &caller : program.functions)
+    {
+        for (const auto &block : caller.blocks)
+        {
+            const auto &tacs = block.tacs;
+            for (size_t i = 0; i < tacs.size(); ++i)
+            {
+                const auto definition = tacs[i]->get_definition();
+                // The function changes the parameter after it gets the argument
+                if (definition == target)
+                {
+                    return nullptr;
+                }
+                if (tacs[i]->get_type() != TAC_CALL || tacs[i]->get_first_operator()->get_text() != name)
+                {
+                    continue;
+                }
+                const auto arguments = find_call_arguments(tacs, i, parameters);
+                if (arguments.empty())
+                {
+                    return nullptr;
+                }
+                const auto value = arguments[parameter]->get_first_operator();
+                if (!value->is_literal() || value->get_data_type() != target->get_data_type())
+                {
+                    return nullptr;
+                }
+                if (constant && (constant->get_text() != value->get_text() || constant->type != value->type))
+                {
+                    return nullptr;
+                }
+                constant = value;
+            }
+        }
+    }
+    return constant;
+}
+
+void propagate_constant_arguments(Program &program)
+{
+    std::set<SymbolTableEntry> replaced;
+    for (auto &function : program.functions)
+    {
+        const auto parameters = function.parameters();
+        for (size_t i = 0; i < parameters.size(); ++i)
+        {
+            const auto constant = constant_argument(program, function, i);
+            if (!constant)
+            {
+                continue;
+            }
+            const auto &parameter = parameters[i];
+            for (auto &block : function.blocks)
+            {
+                for (const auto &tac : block.tacs)
+                {
+                    if (tac->get_first_operator() == parameter)
+                    {
+                        tac->set_first_operator(constant);
+                    }
+                    if (tac->get_second_operator() == parameter)
+                    {
+                        tac->set_second_operator(constant);
+                    }
+                    // PRINT and RET read their result, the ARGs of recursive calls still name the parameter they pass
+                    if (tac->get_result() == parameter && tac->get_type() != TAC_ARG)
+                    {
+                        tac->set_result(constant);
+                    }
+                }
+            }
+            replaced.insert(parameter);
+        }
+    }
+
+    // Nothing reads the replaced parameters anymore
+    for (auto &function : program.functions)
+    {
+        for (auto &block : function.blocks)
+        {
+            auto &tacs = block.tacs;
+            tacs.erase(std::remove_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+                return tac->get_type() == TAC_ARG && replaced.count(tac->get_result()) != 0;
+            }), tacs.end());
+        }
+    }
+}
+
+void remove_unused_calls(ControlFlowGraph &cfg, const CallSummaries &summaries)
+{
+    const auto uses = count_uses(cfg);
+    const auto caller = cfg.function_name();
+    for (auto &block : cfg.blocks)
+    {
+        auto &tacs = block.tacs;
+        std::set<TACptr> removed;
+        for (size_t i = 0; i < tacs.size(); ++i)
+        {
+            const auto &tac = tacs[i];
+            if (tac->get_type() != TAC_CALL || uses.count(tac->get_result()))
+            {
+                continue;
+            }
+            const auto summary = summaries.of_call(caller, tac);
+            if (!summary || !summary->is_pure())
+            {
+                continue;
+            }
+            // Arguments that can not be matched are left, writing a parameter nobody reads is harmless
+            for (const auto &argument : find_call_arguments(tacs, i, summary->parameters))
+            {
+                removed.insert(argument);
+            }
+            removed.insert(tac);
+        }
+        tacs.erase(std::remove_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+            return removed.count(tac) != 0;
+        }), tacs.end());
+    }
+}
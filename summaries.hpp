@@ -0,0 +1,50 @@
+#pragma once
+
+// summaries.hpp file made by Ian Kersz Amaral - 2025/1
+// Interprocedural mod/ref summaries: the variables and vectors each function may read or
+// write, counting the functions it calls, and whether it prints or reads input. Passes use
+// them to keep what they know across calls that can not change it. Arguments that every
+// call passes as the same constant are also propagated into the called function.
+
+#include "cfg.hpp"
+
+typedef struct FunctionSummary
+{
+    std::vector<SymbolTableEntry> parameters;
+    // Globals and parameters, temporaries are left out as only calls back into the caller can change its own
+    std::set<SymbolTableEntry> reads;
+    std::set<SymbolTableEntry> writes;
+    std::set<SymbolTableEntry> read_vectors;
+    std::set<SymbolTableEntry> written_vectors;
+    // Pointer accesses, FILL and COPY may touch any vector
+    bool reads_any_vector = false;
+    bool writes_any_vector = false;
+    // PRINT or READ
+    bool does_io = false;
+    // Integer division or modulo that may divide by zero
+    bool may_trap = false;
+    // No loops and no recursion, so a call always comes back
+    bool always_returns = true;
+
+    // Only computes its result, so a call whose result is not used can be removed
+    bool is_pure() const;
+} FunctionSummary;
+
+typedef struct CallSummaries
+{
+    std::map<std::string, size_t> function_index;
+    std::vector<size_t> component;
+    std::vector<FunctionSummary> functions;
+
+    static CallSummaries build(const Program &program, const CallGraph &call_graph);
+
+    // Effects of a call made from the caller, nullptr when it may change anything: calls to
+    // unknown functions and back into the caller's own cycle, which reuse its temporaries
+    const FunctionSummary *of_call(const std::string &caller, const TACptr &call) const;
+} CallSummaries;
+
+// Parameters that every call passes the same literal are replaced by it, and their ARGs removed
+void propagate_constant_arguments(Program &program);
+
+// Removes the calls to pure functions whose result is not used, with their arguments
+void remove_unused_calls(ControlFlowGraph &cfg, const CallSummaries &summaries);
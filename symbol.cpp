@@ -4,6 +4,7 @@
 #include <vector>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 // symbol.cpp file made by Ian Kersz Amaral - 2025/1
 
@@ -156,6 +157,49 @@ SymbolTableEntry register_label()
         .first->second;
 }
 
+SymbolTableEntry register_int_literal(long value)
+{
+    const auto lexeme = std::to_string(value);
+
+    return symbolTable.emplace(
+                          lexeme,
+                          new Symbol{
+                              SYMBOL_INT,
+                              lexeme,
+                              0,
+                              TYPE_INT,
+                              IDENT_LIT,
+                              std::nullopt})
+        .first->second;
+}
+
+int get_data_type_size(const DataType data_type)
+{
+    switch (data_type)
+    {
+    case DataType::TYPE_INT:
+        return 4; // 4 bytes for int
+    case DataType::TYPE_CHAR:
+    case DataType::TYPE_BOOL:
+        return 1; // 1 byte for char
+    case DataType::TYPE_REAL:
+        return 4; // 4 bytes for real (float)
+    case DataType::TYPE_POINTER:
+        return 8; // 8 bytes for addresses
+    case DataType::TYPE_PACKED_INT:
+    case DataType::TYPE_PACKED_REAL:
+    case DataType::TYPE_PACKED_CHAR:
+        return 32; // Room for the widest register, ymm
+    default:
+        throw std::runtime_error("Unsupported data type size requested.");
+    }
+}
+
+bool is_packed_type(const DataType data_type)
+{
+    return data_type == DataType::TYPE_PACKED_INT || data_type == DataType::TYPE_PACKED_REAL || data_type == DataType::TYPE_PACKED_CHAR;
+}
+
 std::string Symbol::to_string() const
 {
     std::stringstream ss;
@@ -317,6 +361,14 @@ std::string data_type_to_str(const DataType data_type, bool user_friendly)
             return "String";
         case TYPE_BOOL:
             return "Boolean";
+        case TYPE_POINTER:
+            return "Pointer";
+        case TYPE_PACKED_INT:
+            return "Packed Integer";
+        case TYPE_PACKED_REAL:
+            return "Packed Real";
+        case TYPE_PACKED_CHAR:
+            return "Packed Character";
         case TYPE_OTHER:
             return "Other";
         }
@@ -339,6 +391,14 @@ std::string data_type_to_str(const DataType data_type, bool user_friendly)
             return "TYPE_STRING";
         case TYPE_BOOL:
             return "TYPE_BOOL";
+        case TYPE_POINTER:
+            return "TYPE_POINTER";
+        case TYPE_PACKED_INT:
+            return "TYPE_PACKED_INT";
+        case TYPE_PACKED_REAL:
+            return "TYPE_PACKED_REAL";
+        case TYPE_PACKED_CHAR:
+            return "TYPE_PACKED_CHAR";
         case TYPE_OTHER:
             return "TYPE_OTHER";
         }
@@ -37,6 +37,11 @@ enum DataType : uint8_t
     TYPE_CHAR,
     TYPE_STRING,
     TYPE_BOOL,
+    TYPE_POINTER,
+    // Several elements of a vector handled together by one SIMD instruction
+    TYPE_PACKED_INT,
+    TYPE_PACKED_REAL,
+    TYPE_PACKED_CHAR,
     TYPE_OTHER
 };
 
@@ -73,6 +78,10 @@ typedef struct Symbol
 
     bool is_valid() const;
 
+    bool is_temporary() const { return this->type == SYMBOL_TEMP; }
+
+    bool is_literal() const { return this->ident_type == IDENT_LIT; }
+
     bool set_node(std::shared_ptr<Node> node)
     {
         this->node = node;
@@ -103,6 +112,12 @@ std::string ident_type_to_str(const IdentType ident_type, bool user_friendly = f
 SymbolTableEntry register_symbol(const SymbolType symbol_type, Lexeme lexeme, LineNumber line_number);
 SymbolTableEntry register_temp(DataType data_type = TYPE_OTHER);
 SymbolTableEntry register_label();
+// Literal created by the compiler itself, the lexeme is the plain decimal value
+SymbolTableEntry register_int_literal(long value);
+
+int get_data_type_size(const DataType data_type);
+
+bool is_packed_type(const DataType data_type);
 
 std::string generateSymbolTable(void);
 
@@ -3,6 +3,7 @@
 #include "set_once.hpp"
 #include "symbol.hpp"
 #include <memory>
+#include <map>
 
 // tac.cpp file made by Ian Kersz Amaral - 2025/1
 
@@ -40,6 +41,19 @@ std::string tac_type_to_string(TacType type)
         case TAC_READ: return "READ";
         case TAC_VECLOAD: return "VECLOAD"; 
         case TAC_VECSTORE: return "VECSTORE";
+        case TAC_ADDR: return "ADDR";
+        case TAC_PTRADD: return "PTRADD";
+        case TAC_PTRLOAD: return "PTRLOAD";
+        case TAC_PTRSTORE: return "PTRSTORE";
+        case TAC_PACKED_LOAD: return "PACKED_LOAD";
+        case TAC_PACKED_STORE: return "PACKED_STORE";
+        case TAC_BROADCAST: return "BROADCAST";
+        case TAC_EXTRACT: return "EXTRACT";
+        case TAC_MIN: return "MIN";
+        case TAC_MAX: return "MAX";
+        case TAC_FILL: return "FILL";
+        case TAC_COPY: return "COPY";
+        case TAC_BOUNDS: return "BOUNDS";
         case TAC_BEGINVARS: return "BEGINVARS";
         case TAC_BEGINCODE: return "BEGINCODE";
         case TAC_VARBEGIN: return "VARBEGIN";
@@ -224,17 +238,15 @@ TACptr TAC::generate_code(NodePtr node)
         }
     case NodeType::NODE_IF:
         {
-            const auto condition = generate_code(node->get_children()[0]);
-
             const auto if_block = generate_code(node->get_children()[1]);
             const auto else_block = node->get_children().size() > 2 ? generate_code(node->get_children()[2]) : nullptr;
 
             const auto else_label = make_tac_label();
-            const auto endif_label = else_block ? make_tac_label() : else_label; // If no else, IFZ jumps to endif
+            const auto endif_label = else_block ? make_tac_label() : else_label; // If no else, the condition jumps to endif
 
-            const auto tac_ifz = make_tac(TAC_IFZ, else_label, condition);
+            const auto condition = generate_condition(node->get_children()[0], else_label);
 
-            TACList if_sequence = {condition, tac_ifz, if_block};
+            TACList if_sequence = {condition, if_block};
 
             if (else_block) {
                 const auto endif_jump = make_tac(TAC_JUMP, endif_label->get_result());
@@ -248,32 +260,28 @@ TACptr TAC::generate_code(NodePtr node)
         }
     case NodeType::NODE_WHILE:
         {
+            // Rotated loop: the condition guards the entry and is tested again at the bottom,
+            // so each iteration takes a single branch back to the start
             const auto end_while_label = make_tac_label();
+            const auto loop_start_label = make_tac_label();
 
-            const auto condition_label = make_tac_label();
-            const auto jump_to_condition = make_tac(TAC_JUMP, condition_label->get_result());
-
-            const auto condition = generate_code(node->get_children()[0]);
-
-            const auto tac_ifz = make_tac(TAC_IFZ, end_while_label->get_result(), condition);
+            const auto guard = generate_condition(node->get_children()[0], end_while_label);
 
             const auto while_block = generate_code(node->get_children()[1]);
 
-            return TAC::join(condition_label, condition, tac_ifz, while_block, jump_to_condition, end_while_label);
+            const auto condition = generate_condition(node->get_children()[0], loop_start_label, true);
+
+            return TAC::join(guard, loop_start_label, while_block, condition, end_while_label);
         }
     case NodeType::NODE_DO_WHILE:
         {
             const auto loop_start_label = make_tac_label();
-            const auto after_loop_label = make_tac_label();
 
             const auto do_block = generate_code(node->get_children()[0]);
-            const auto condition = generate_code(node->get_children()[1]);
-
-            const auto ifz = make_tac(TAC_IFZ, after_loop_label->get_result(), condition);
-            
-            const auto jump_to_start = make_tac(TAC_JUMP, loop_start_label->get_result());
+            // Jumps back to the start while the condition is true
+            const auto condition = generate_condition(node->get_children()[1], loop_start_label, true);
 
-            return TAC::join(loop_start_label, do_block, condition, ifz, jump_to_start, after_loop_label);
+            return TAC::join(loop_start_label, do_block, condition);
         }
     case NodeType::NODE_PRINT:
         {
@@ -335,6 +343,72 @@ TACptr TAC::generate_code(NodePtr node)
     }
 }
 
+TACptr TAC::generate_condition(NodePtr node, const TACptr &false_label, const bool negated)
+{
+    switch (node->get_node_type())
+    {
+    case NodeType::NODE_PARENTHESIS:
+        return generate_condition(node->get_children()[0], false_label, negated);
+    case NodeType::NODE_NOT:
+        return generate_condition(node->get_children()[0], false_label, !negated);
+    case NodeType::NODE_AND:
+    case NodeType::NODE_OR:
+        {
+            const auto &left = node->get_children()[0];
+            const auto &right = node->get_children()[1];
+            // ~(a & b) is ~a | ~b and ~(a | b) is ~a & ~b
+            const auto is_and = (node->get_node_type() == NodeType::NODE_AND) != negated;
+            if (is_and)
+            {
+                const auto left_tac = generate_condition(left, false_label, negated);
+                const auto right_tac = generate_condition(right, false_label, negated);
+                return TAC::join(left_tac, right_tac);
+            }
+
+            // The right side is only tested when the left one is false
+            const auto right_label = make_tac_label();
+            const auto true_label = make_tac_label();
+            const auto left_tac = generate_condition(left, right_label, negated);
+            const auto jump_to_true = make_tac(TAC_JUMP, true_label->get_result());
+            const auto right_tac = generate_condition(right, false_label, negated);
+            return TAC::join(left_tac, jump_to_true, right_label, right_tac, true_label);
+        }
+    case NodeType::NODE_LT:
+    case NodeType::NODE_GT:
+    case NodeType::NODE_LE:
+    case NodeType::NODE_GE:
+    case NodeType::NODE_EQ:
+    case NodeType::NODE_DIF:
+        if (negated)
+        {
+            // The opposite comparison, so it can still be fused with the branch. It also holds for
+            // reals, as the unordered result of ucomiss makes exactly one of the pair true
+            static const std::map<NodeType, TacType> opposites = {
+                {NodeType::NODE_LT, TAC_GE}, {NodeType::NODE_GE, TAC_LT},
+                {NodeType::NODE_GT, TAC_LE}, {NodeType::NODE_LE, TAC_GT},
+                {NodeType::NODE_EQ, TAC_DIF}, {NodeType::NODE_DIF, TAC_EQ},
+            };
+            const auto first_op = generate_code(node->get_children()[0]);
+            const auto second_op = generate_code(node->get_children()[1]);
+            const auto compare_tac = make_tac_temp(opposites.at(node->get_node_type()), TYPE_BOOL, first_op, second_op);
+            const auto tac_ifz = make_tac(TAC_IFZ, false_label, compare_tac);
+            return TAC::join(first_op, second_op, compare_tac, tac_ifz);
+        }
+        [[fallthrough]];
+    default:
+        {
+            auto condition = generate_code(node);
+            if (negated)
+            {
+                const auto not_tac = make_tac_temp(TAC_NOT, TYPE_BOOL, condition);
+                condition = TAC::join(condition, not_tac);
+            }
+            const auto tac_ifz = make_tac(TAC_IFZ, false_label, condition);
+            return TAC::join(condition, tac_ifz);
+        }
+    }
+}
+
 TACptr TAC::generate_vars(NodePtr node)
 {
     if (node == nullptr)
@@ -520,6 +594,224 @@ TACList TAC::build_forward_links(TACptr tac) {
     return tacs_in_execution_order;
 }
 
+void TAC::relink(const TACList &tac_list)
+{
+    for (size_t i = 0; i < tac_list.size(); ++i)
+    {
+        tac_list[i]->prev = i > 0 ? tac_list[i - 1] : nullptr;
+        tac_list[i]->next = i + 1 < tac_list.size() ? tac_list[i + 1] : nullptr;
+    }
+}
+
+SymbolTableEntry TAC::get_definition() const
+{
+    switch (type)
+    {
+    case TAC_MOVE:
+    case TAC_ADD:
+    case TAC_SUB:
+    case TAC_MUL:
+    case TAC_DIV:
+    case TAC_MOD:
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+    case TAC_AND:
+    case TAC_OR:
+    case TAC_NOT:
+    case TAC_VECLOAD:
+    case TAC_ADDR:
+    case TAC_PTRADD:
+    case TAC_PTRLOAD:
+    case TAC_PACKED_LOAD:
+    case TAC_BROADCAST:
+    case TAC_EXTRACT:
+    case TAC_MIN:
+    case TAC_MAX:
+    case TAC_CALL:
+    case TAC_READ:
+        return result;
+    default:
+        return nullptr;
+    }
+}
+
+std::vector<SymbolTableEntry> TAC::get_uses() const
+{
+    std::vector<SymbolTableEntry> uses;
+    switch (type)
+    {
+    case TAC_MOVE:
+    case TAC_ARG:
+    case TAC_NOT:
+    case TAC_IFZ:
+    case TAC_PTRLOAD:
+    case TAC_BROADCAST:
+    case TAC_EXTRACT:
+    case TAC_BOUNDS:
+        // The lane of an EXTRACT and the size a BOUNDS checks against are always literals
+        uses.push_back(first_operator);
+        break;
+    case TAC_ADDR:
+        // Address of the vector plus an optional index
+        if (second_operator)
+        {
+            uses.push_back(second_operator);
+        }
+        break;
+    case TAC_PTRADD:
+        uses.push_back(first_operator);
+        uses.push_back(second_operator);
+        break;
+    case TAC_PTRSTORE:
+        // The pointer is in the result, the stored value in the first operator
+        uses.push_back(result);
+        uses.push_back(first_operator);
+        break;
+    case TAC_FILL:
+    case TAC_COPY:
+        // Destination pointer, value or source pointer, and the count
+        uses.push_back(result);
+        uses.push_back(first_operator);
+        uses.push_back(second_operator);
+        break;
+    case TAC_ADD:
+    case TAC_SUB:
+    case TAC_MUL:
+    case TAC_DIV:
+    case TAC_MOD:
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+    case TAC_AND:
+    case TAC_OR:
+    case TAC_MIN:
+    case TAC_MAX:
+        uses.push_back(first_operator);
+        uses.push_back(second_operator);
+        break;
+    case TAC_VECLOAD:
+    case TAC_PACKED_LOAD:
+        // The vector itself is read through memory, only the index is a value
+        uses.push_back(second_operator);
+        break;
+    case TAC_VECSTORE:
+    case TAC_PACKED_STORE:
+        uses.push_back(first_operator);
+        uses.push_back(second_operator);
+        break;
+    case TAC_RET:
+    case TAC_PRINT:
+        uses.push_back(result);
+        break;
+    default:
+        break;
+    }
+    return uses;
+}
+
+bool TAC::is_expression() const
+{
+    switch (type)
+    {
+    case TAC_ADD:
+    case TAC_SUB:
+    case TAC_MUL:
+    case TAC_DIV:
+    case TAC_MOD:
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+    case TAC_AND:
+    case TAC_OR:
+    case TAC_NOT:
+    case TAC_MIN:
+    case TAC_MAX:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool TAC::is_relational() const
+{
+    switch (type)
+    {
+    case TAC_LT:
+    case TAC_GT:
+    case TAC_LE:
+    case TAC_GE:
+    case TAC_EQ:
+    case TAC_DIF:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool TAC::may_trap() const
+{
+    // Real division gives inf or nan
+    if ((type != TAC_DIV && type != TAC_MOD) || result->get_data_type() == TYPE_REAL)
+    {
+        return false;
+    }
+    const auto &divisor = second_operator;
+    if (divisor->is_literal() && divisor->type == SYMBOL_INT)
+    {
+        return std::stol(divisor->get_text()) == 0;
+    }
+    return !divisor->is_literal() || divisor->type != SYMBOL_CHAR || divisor->get_text() == "''";
+}
+
+bool TAC::is_pure() const
+{
+    switch (type)
+    {
+    case TAC_MOVE:
+    case TAC_VECLOAD:
+    case TAC_ADDR:
+    case TAC_PTRADD:
+    case TAC_PTRLOAD:
+    case TAC_PACKED_LOAD:
+    case TAC_BROADCAST:
+    case TAC_EXTRACT:
+        return true;
+    default:
+        return is_expression() && !may_trap();
+    }
+}
+
+bool TAC::is_commutative() const
+{
+    switch (type)
+    {
+    case TAC_ADD:
+    case TAC_MUL:
+    case TAC_EQ:
+    case TAC_DIF:
+    case TAC_AND:
+    case TAC_OR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool TAC::is_block_terminator() const
+{
+    return type == TAC_JUMP || type == TAC_IFZ || type == TAC_RET;
+}
+
 
 TACptr make_tac_symbol(const SymbolTableEntry result)
 {    
@@ -552,6 +844,11 @@ TACptr make_tac(const TacType type, const SymbolTableEntry symbol)
     return std::make_shared<TAC>(type, symbol);
 }
 
+TACptr make_tac(const TacType type, const SymbolTableEntry result, const SymbolTableEntry first, const SymbolTableEntry second)
+{
+    return std::make_shared<TAC>(type, result, first, second);
+}
+
 TACptr make_tac_label()
 {
     return std::make_shared<TAC>(TAC_LABEL, register_label());
@@ -39,6 +39,19 @@ enum TacType
     TAC_READ,
     TAC_VECLOAD,
     TAC_VECSTORE,
+    TAC_ADDR,
+    TAC_PTRADD,
+    TAC_PTRLOAD,
+    TAC_PTRSTORE,
+    TAC_PACKED_LOAD,
+    TAC_PACKED_STORE,
+    TAC_BROADCAST,
+    TAC_EXTRACT,
+    TAC_MIN,
+    TAC_MAX,
+    TAC_FILL,
+    TAC_COPY,
+    TAC_BOUNDS,
     TAC_BEGINVARS,
     TAC_BEGINCODE,
     TAC_VARBEGIN,
@@ -75,6 +88,10 @@ public:
         }
     }
 
+    TAC(TacType type, SymbolTableEntry result, SymbolTableEntry first, SymbolTableEntry second) : type(type), result(result), first_operator(first), second_operator(second), next(nullptr), prev(nullptr)
+    {
+    }
+
     TAC(TacType type, const TACptr result = nullptr, const TACptr first = nullptr, const TACptr second = nullptr, const DataType data_type = DataType::TYPE_OTHER) : type(type), next(nullptr), prev(nullptr)
     {
         if (!result)
@@ -101,6 +118,10 @@ public:
 
     static TACptr generate_code(NodePtr node);
 
+    // Code that jumps to the label when the condition is false (true if negated) and falls
+    // through otherwise, the right side of & and | is only evaluated when it decides the result.
+    static TACptr generate_condition(NodePtr node, const TACptr &false_label, bool negated = false);
+
     static TACptr generate_vars(NodePtr node);
 
     static TACptr generate_tacs(NodePtr node);
@@ -134,6 +155,10 @@ public:
 
     static TACList build_forward_links(TACptr tac);
 
+    // Rebuilds the prev/next links so they follow the order of the list,
+    // needed after a pass reorders, inserts or removes TACs.
+    static void relink(const TACList &tac_list);
+
     const SymbolTableEntry get_first_operator() const
     {
         return this->first_operator;
@@ -144,6 +169,38 @@ public:
         return this->second_operator;
     }
 
+    void set_type(const TacType new_type) { this->type = new_type; }
+
+    void set_result(const SymbolTableEntry new_result) { this->result = new_result; }
+
+    void set_first_operator(const SymbolTableEntry new_first) { this->first_operator = new_first; }
+
+    void set_second_operator(const SymbolTableEntry new_second) { this->second_operator = new_second; }
+
+    // Symbol written by this TAC, nullptr if it does not write a variable. An ARG passes its
+    // value in a register to the call, the parameter it names is not written in the caller
+    SymbolTableEntry get_definition() const;
+
+    // Variables and literals read by this TAC (labels and function names are not included)
+    std::vector<SymbolTableEntry> get_uses() const;
+
+    // Arithmetic, relational and logical operations, which only depend on their operands
+    bool is_expression() const;
+
+    // LT, GT, LE, GE, EQ and DIF, which compare their operands and give a bool
+    bool is_relational() const;
+
+    bool is_commutative() const;
+
+    // Integer division and modulo by anything but a nonzero literal, which trap on zero
+    bool may_trap() const;
+
+    // Only writes its result and never traps, so it can be removed when the result is never read
+    bool is_pure() const;
+
+    // JUMP, IFZ and RET end a basic block
+    bool is_block_terminator() const;
+
 } TAC;
 
 typedef TAC::TACptr TACptr;
@@ -159,4 +216,6 @@ TACptr make_tac(const TacType type, const SymbolTableEntry result, const TACptr
 
 TACptr make_tac(const TacType type, const SymbolTableEntry symbol);
 
+TACptr make_tac(const TacType type, const SymbolTableEntry result, const SymbolTableEntry first, const SymbolTableEntry second);
+
 TACptr make_tac_label();
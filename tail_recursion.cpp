@@ -0,0 +1,204 @@
+#include "tail_recursion.hpp"
+
+// tail_recursion.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <algorithm>
+#include <optional>
+
+typedef struct RecursiveCall
+{
+    size_t block;
+    size_t call;
+    std::vector<TACptr> arguments;
+    // ADD or MUL that combines the call result with the operand, TAC_INVALID for plain tail calls
+    TacType operation;
+    SymbolTableEntry operand;
+} RecursiveCall;
+
+// Recognizes "CALL t, f; RET t" and "CALL t, f; OP x, t, e; RET x" at the end of the block
+std::optional<RecursiveCall> match_recursive_call(const BasicBlock &block, const size_t block_index, const SymbolTableEntry &function, const std::vector<SymbolTableEntry> &parameters)
+{
+    const auto &tacs = block.tacs;
+    const auto call = std::find_if(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+        return tac->get_type() == TAC_CALL && tac->get_first_operator() == function;
+    });
+    if (call == tacs.end())
+    {
+        return std::nullopt;
+    }
+    const auto call_index = static_cast<size_t>(call - tacs.begin());
+    const auto result = (*call)->get_result();
+    RecursiveCall recursive_call{block_index, call_index, {}, TAC_INVALID, nullptr};
+
+    const auto remaining = tacs.size() - call_index;
+    const auto &last = tacs.back();
+    if (last->get_type() != TAC_RET)
+    {
+        return std::nullopt;
+    }
+    if (remaining == 3)
+    {
+        const auto &combine = tacs[call_index + 1];
+        const auto type = combine->get_type();
+        const auto first = combine->get_first_operator();
+        const auto second = combine->get_second_operator();
+        if ((type != TAC_ADD && type != TAC_MUL) || combine->get_result() != last->get_result() || result->get_data_type() != TYPE_INT)
+        {
+            return std::nullopt;
+        }
+        const auto operand = first == result ? second : first;
+        if ((first == result) == (second == result) || operand->get_data_type() != TYPE_INT)
+        {
+            return std::nullopt;
+        }
+        // The operand must hold the same value before the call, which parameters do as the callee gets its own
+        const auto is_parameter = std::find(parameters.begin(), parameters.end(), operand) != parameters.end();
+        if (!is_parameter && !(operand->is_literal() && operand->type == SYMBOL_INT))
+        {
+            return std::nullopt;
+        }
+        recursive_call.operation = type;
+        recursive_call.operand = operand;
+    }
+    else if (remaining != 2 || last->get_result() != result)
+    {
+        return std::nullopt;
+    }
+
+    recursive_call.arguments = find_call_arguments(tacs, call_index, parameters);
+    if (recursive_call.arguments.size() != parameters.size())
+    {
+        return std::nullopt;
+    }
+    // The arguments are moved to temporaries, nothing between them may call anything
+    auto first_argument = call_index;
+    for (const auto &argument : recursive_call.arguments)
+    {
+        first_argument = std::min(first_argument, static_cast<size_t>(std::find(tacs.begin(), tacs.end(), argument) - tacs.begin()));
+    }
+    for (auto i = first_argument; i < call_index; ++i)
+    {
+        if (tacs[i]->get_type() == TAC_CALL)
+        {
+            return std::nullopt;
+        }
+    }
+    return recursive_call;
+}
+
+void eliminate_tail_recursion(ControlFlowGraph &cfg, const CallGraph &call_graph)
+{
+    const auto function = cfg.begin_function->get_result();
+    const auto found = call_graph.function_index.find(cfg.function_name());
+    if (found == call_graph.function_index.end() || !call_graph.recursive[found->second])
+    {
+        return;
+    }
+    const auto self = found->second;
+    const auto parameters = cfg.parameters();
+
+    std::vector<RecursiveCall> calls;
+    size_t self_calls = 0;
+    for (size_t block = 0; block < cfg.blocks.size(); ++block)
+    {
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            self_calls += tac->get_type() == TAC_CALL && tac->get_first_operator() == function;
+        }
+        const auto call = match_recursive_call(cfg.blocks[block], block, function, parameters);
+        if (call)
+        {
+            calls.push_back(*call);
+        }
+    }
+
+    // The accumulator is a global, so no other activation of the function may run while it is in use
+    const auto only_self_recursive = std::count(call_graph.component.begin(), call_graph.component.end(), call_graph.component[self]) == 1;
+    auto accumulate = only_self_recursive && calls.size() == self_calls;
+
+    auto operation = TAC_INVALID;
+    for (const auto &call : calls)
+    {
+        if (call.operation == TAC_INVALID)
+        {
+            continue;
+        }
+        accumulate = accumulate && (operation == TAC_INVALID || operation == call.operation);
+        operation = call.operation;
+    }
+    // Other returns combine their value with the accumulator, they must be integers too
+    for (const auto &block : cfg.blocks)
+    {
+        const auto terminator = block.get_terminator();
+        const auto is_return = terminator && terminator->get_type() == TAC_RET;
+        accumulate = accumulate && (!is_return || terminator->get_result()->get_data_type() == TYPE_INT);
+    }
+    if (operation == TAC_INVALID)
+    {
+        accumulate = false;
+    }
+
+    calls.erase(std::remove_if(calls.begin(), calls.end(), [&](const RecursiveCall &call) {
+        return call.operation != TAC_INVALID && !accumulate;
+    }), calls.end());
+    if (calls.empty())
+    {
+        return;
+    }
+
+    const auto accumulator = accumulate ? register_temp(TYPE_INT) : nullptr;
+    std::set<size_t> call_blocks;
+    for (const auto &call : calls)
+    {
+        call_blocks.insert(call.block);
+    }
+
+    if (accumulate)
+    {
+        for (size_t block = 0; block < cfg.blocks.size(); ++block)
+        {
+            auto &tacs = cfg.blocks[block].tacs;
+            if (call_blocks.count(block) || tacs.empty() || tacs.back()->get_type() != TAC_RET)
+            {
+                continue;
+            }
+            const auto value = register_temp(TYPE_INT);
+            const auto returned = tacs.back()->get_result();
+            tacs.back()->set_result(value);
+            tacs.insert(tacs.end() - 1, make_tac(operation, value, accumulator, returned));
+        }
+    }
+
+    // The loop starts right after a new entry block that sets up the accumulator
+    BasicBlock entry;
+    if (accumulate)
+    {
+        const auto identity = register_int_literal(operation == TAC_ADD ? 0 : 1);
+        entry.tacs.push_back(make_tac(TAC_MOVE, accumulator, identity, SymbolTableEntry()));
+    }
+    cfg.blocks.insert(cfg.blocks.begin(), entry);
+    const auto start = cfg.ensure_label(1);
+
+    for (const auto &call : calls)
+    {
+        auto &tacs = cfg.blocks[call.block + 1].tacs;
+        TACList assignments;
+        for (size_t i = 0; i < parameters.size(); ++i)
+        {
+            // Every argument is evaluated before any parameter changes
+            const auto temporary = register_temp(parameters[i]->get_data_type());
+            call.arguments[i]->set_type(TAC_MOVE);
+            call.arguments[i]->set_result(temporary);
+            assignments.push_back(make_tac(TAC_MOVE, parameters[i], temporary, SymbolTableEntry()));
+        }
+        tacs.erase(tacs.begin() + static_cast<long>(call.call), tacs.end());
+        if (call.operation != TAC_INVALID)
+        {
+            tacs.push_back(make_tac(call.operation, accumulator, accumulator, call.operand));
+        }
+        tacs.insert(tacs.end(), assignments.begin(), assignments.end());
+        tacs.push_back(make_tac(TAC_JUMP, start));
+    }
+
+    cfg.connect_blocks();
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// tail_recursion.hpp file made by Ian Kersz Amaral - 2025/1
+// Turns self recursion into loops. Calls whose result is returned as is become a jump back
+// to the start of the function, and returns of the form e + f(...) or e * f(...) are folded
+// into an accumulator when every recursive call has that shape.
+
+#include "cfg.hpp"
+
+void eliminate_tail_recursion(ControlFlowGraph &cfg, const CallGraph &call_graph);
@@ -0,0 +1,448 @@
+#include "unroll.hpp"
+
+// unroll.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "induction.hpp"
+
+#include <algorithm>
+
+// Largest number of TACs the copies of an unrolled body may add up to
+static constexpr size_t UNROLL_BUDGET = 128;
+// Loops with a known trip count up to this one are unrolled completely
+static constexpr long MAX_FULL_UNROLL_TRIPS = 16;
+
+TacType opposite_comparison(const TacType type)
+{
+    switch (type)
+    {
+    case TAC_LT: return TAC_GE;
+    case TAC_GE: return TAC_LT;
+    case TAC_GT: return TAC_LE;
+    case TAC_LE: return TAC_GT;
+    case TAC_EQ: return TAC_DIF;
+    case TAC_DIF: return TAC_EQ;
+    default: throw std::runtime_error("Unsupported comparison in loop test.");
+    }
+}
+
+TacType mirrored_comparison(const TacType type)
+{
+    switch (type)
+    {
+    case TAC_LT: return TAC_GT;
+    case TAC_GT: return TAC_LT;
+    case TAC_LE: return TAC_GE;
+    case TAC_GE: return TAC_LE;
+    default: return type;
+    }
+}
+
+bool compare_values(const TacType type, const long first, const long second)
+{
+    switch (type)
+    {
+    case TAC_LT: return first < second;
+    case TAC_GT: return first > second;
+    case TAC_LE: return first <= second;
+    case TAC_GE: return first >= second;
+    case TAC_EQ: return first == second;
+    default: return first != second;
+    }
+}
+
+std::map<SymbolTableEntry, size_t> count_uses(const ControlFlowGraph &cfg)
+{
+    std::map<SymbolTableEntry, size_t> uses;
+    for (const auto &block : cfg.blocks)
+    {
+        for (const auto &tac : block.tacs)
+        {
+            for (const auto &use : tac->get_uses())
+            {
+                uses[use]++;
+            }
+        }
+    }
+    return uses;
+}
+
+bool reads_symbol(const TACList &tacs, const SymbolTableEntry &symbol)
+{
+    return std::any_of(tacs.begin(), tacs.end(), [&](const TACptr &tac) {
+        const auto used = tac->get_uses();
+        return std::find(used.begin(), used.end(), symbol) != used.end();
+    });
+}
+
+// Recognizes "LABEL L; ...; t = counter + step; ...; counter = t; c = test; IFZ L, c"
+std::optional<CountedLoop> match_counted_loop(const ControlFlowGraph &cfg, const Loop &loop, std::map<SymbolTableEntry, size_t> &uses)
+{
+    if (loop.blocks.size() != 1)
+    {
+        return std::nullopt;
+    }
+    const auto &tacs = cfg.blocks[loop.header].tacs;
+    const auto size = tacs.size();
+    if (size < 4 || tacs.front()->get_type() != TAC_LABEL)
+    {
+        return std::nullopt;
+    }
+    const auto &branch = tacs[size - 1];
+    const auto &test = tacs[size - 2];
+    const auto &increment = tacs[size - 3];
+    const auto condition = test->get_result();
+    if (branch->get_type() != TAC_IFZ || branch->get_first_operator() != condition || !test->is_relational()
+        || !condition->is_temporary() || uses[condition] != 1 || increment->get_type() != TAC_MOVE)
+    {
+        return std::nullopt;
+    }
+
+    const auto counter = increment->get_result();
+    const auto next = increment->get_first_operator();
+    if (counter->get_data_type() != TYPE_INT || !next->is_temporary())
+    {
+        return std::nullopt;
+    }
+
+    CountedLoop counted{loop.header, counter, next, 0, nullptr, TAC_INVALID, {}, {}};
+    TACptr step_tac = nullptr;
+    for (size_t i = 1; i + 3 < size; ++i)
+    {
+        const auto &tac = tacs[i];
+        const auto definition = tac->get_definition();
+        // Counters and bounds are globals, a call could change them
+        if (tac->get_type() == TAC_CALL || definition == counter)
+        {
+            return std::nullopt;
+        }
+        if (definition != next)
+        {
+            // Before the increment the temporary still holds the value of the last iteration
+            if (!step_tac && reads_symbol({tac}, next))
+            {
+                return std::nullopt;
+            }
+            counted.body.push_back(tac);
+            continue;
+        }
+        const auto first = tac->get_first_operator();
+        const auto second = tac->get_second_operator();
+        const auto type = tac->get_type();
+        if (step_tac || (type != TAC_ADD && type != TAC_SUB))
+        {
+            return std::nullopt;
+        }
+        if (first == counter && is_int_literal(second))
+        {
+            counted.step = std::stol(second->get_text()) * (type == TAC_SUB ? -1 : 1);
+        }
+        else if (type == TAC_ADD && second == counter && is_int_literal(first))
+        {
+            counted.step = std::stol(first->get_text());
+        }
+        else
+        {
+            return std::nullopt;
+        }
+        step_tac = tac;
+    }
+    if (!step_tac || counted.step == 0)
+    {
+        return std::nullopt;
+    }
+    counted.iteration.assign(tacs.begin() + 1, tacs.end() - 2);
+
+    // The test reads the counter after its increment, either the variable or the temporary
+    const auto first = test->get_first_operator();
+    const auto second = test->get_second_operator();
+    const auto counter_first = first == counter || first == next;
+    const auto counter_second = second == counter || second == next;
+    if (counter_first == counter_second)
+    {
+        return std::nullopt;
+    }
+    counted.bound = counter_first ? second : first;
+    // The IFZ goes back when the test is false, so it is the exit test
+    counted.exit_test = counter_first ? test->get_type() : mirrored_comparison(test->get_type());
+    const auto &bound = counted.bound;
+    if (bound->get_data_type() != TYPE_INT || (!is_int_literal(bound) && bound->is_literal()))
+    {
+        return std::nullopt;
+    }
+    for (const auto &tac : counted.iteration)
+    {
+        if (tac->get_definition() == bound)
+        {
+            return std::nullopt;
+        }
+    }
+    return counted;
+}
+
+bool keeps_temporaries_inside(const ControlFlowGraph &cfg, const CountedLoop &counted, std::map<SymbolTableEntry, size_t> &uses)
+{
+    std::set<SymbolTableEntry> defined;
+    std::map<SymbolTableEntry, size_t> loop_uses;
+    for (const auto &tac : cfg.blocks[counted.block].tacs)
+    {
+        const auto definition = tac->get_definition();
+        if (definition)
+        {
+            defined.insert(definition);
+        }
+        for (const auto &use : tac->get_uses())
+        {
+            loop_uses[use]++;
+        }
+    }
+    return std::all_of(defined.begin(), defined.end(), [&](const SymbolTableEntry &symbol) {
+        return !symbol->is_temporary() || uses[symbol] == loop_uses[symbol];
+    });
+}
+
+// Integer literal the counter always holds when the loop is entered
+std::optional<long> initial_value(const ControlFlowGraph &cfg, const CountedLoop &counted)
+{
+    std::vector<size_t> entries;
+    for (const auto predecessor : cfg.blocks[counted.block].predecessors)
+    {
+        if (predecessor != counted.block)
+        {
+            entries.push_back(predecessor);
+        }
+    }
+    if (entries.size() != 1)
+    {
+        return std::nullopt;
+    }
+
+    std::set<size_t> visited;
+    auto block = entries.front();
+    while (visited.insert(block).second)
+    {
+        const auto &tacs = cfg.blocks[block].tacs;
+        for (auto tac = tacs.rbegin(); tac != tacs.rend(); ++tac)
+        {
+            if ((*tac)->get_type() == TAC_CALL)
+            {
+                return std::nullopt;
+            }
+            if ((*tac)->get_definition() != counted.counter)
+            {
+                continue;
+            }
+            const auto value = (*tac)->get_first_operator();
+            if ((*tac)->get_type() != TAC_MOVE || !is_int_literal(value))
+            {
+                return std::nullopt;
+            }
+            return std::stol(value->get_text());
+        }
+        if (cfg.blocks[block].predecessors.size() != 1)
+        {
+            return std::nullopt;
+        }
+        block = cfg.blocks[block].predecessors.front();
+    }
+    return std::nullopt;
+}
+
+// Number of times the body runs once the loop is entered, if it is small enough to count
+std::optional<long> trip_count(const ControlFlowGraph &cfg, const CountedLoop &counted)
+{
+    const auto initial = initial_value(cfg, counted);
+    if (!initial || !is_int_literal(counted.bound))
+    {
+        return std::nullopt;
+    }
+    const auto bound = std::stol(counted.bound->get_text());
+    auto value = *initial;
+    for (long trips = 1; trips <= MAX_FULL_UNROLL_TRIPS; ++trips)
+    {
+        value += counted.step;
+        if (compare_values(counted.exit_test, value, bound))
+        {
+            return trips;
+        }
+    }
+    return std::nullopt;
+}
+
+// Copies the TACs with fresh temporaries for the ones they define, reads follow the latest copy.
+// With keep_names the original temporaries are written, so the values leave the copies in them.
+TACList copy_iteration(const TACList &tacs, std::map<SymbolTableEntry, SymbolTableEntry> &renamed, const bool keep_names)
+{
+    const auto rename = [&](const SymbolTableEntry &symbol) {
+        const auto found = symbol ? renamed.find(symbol) : renamed.end();
+        return found != renamed.end() ? found->second : symbol;
+    };
+
+    TACList copy;
+    for (const auto &tac : tacs)
+    {
+        const auto first = rename(tac->get_first_operator());
+        const auto second = rename(tac->get_second_operator());
+        auto result = tac->get_result();
+        const auto definition = tac->get_definition();
+        if (definition && definition->is_temporary())
+        {
+            if (keep_names)
+            {
+                renamed.erase(definition);
+            }
+            else
+            {
+                result = renamed[definition] = register_temp(definition->get_data_type());
+            }
+        }
+        else
+        {
+            result = rename(result);
+        }
+        copy.push_back(make_tac(tac->get_type(), result, first, second));
+    }
+    return copy;
+}
+
+void unroll_completely(ControlFlowGraph &cfg, const CountedLoop &counted, const long trips)
+{
+    auto &tacs = cfg.blocks[counted.block].tacs;
+    TACList unrolled{tacs.front()};
+    std::map<SymbolTableEntry, SymbolTableEntry> renamed;
+    for (long trip = 0; trip < trips; ++trip)
+    {
+        const auto copy = copy_iteration(counted.iteration, renamed, trip + 1 == trips);
+        unrolled.insert(unrolled.end(), copy.begin(), copy.end());
+    }
+    tacs = unrolled;
+    cfg.connect_blocks();
+}
+
+// Compares value with the bound and branches to the label when the comparison is false
+void emit_test(TACList &tacs, const TacType type, const SymbolTableEntry &value, const SymbolTableEntry &bound, const SymbolTableEntry &label)
+{
+    const auto condition = register_temp(TYPE_BOOL);
+    tacs.push_back(make_tac(type, condition, value, bound));
+    tacs.push_back(make_tac(TAC_IFZ, label, condition, SymbolTableEntry()));
+}
+
+SymbolTableEntry emit_offset(TACList &tacs, const SymbolTableEntry &counter, const long offset)
+{
+    const auto value = register_temp(TYPE_INT);
+    tacs.push_back(make_tac(TAC_ADD, value, counter, register_int_literal(offset)));
+    return value;
+}
+
+// The new loop runs while factor more iterations fit, the original loop runs the rest:
+//   preheader; setup; if exit(i + (factor - 1) * step) goto rest
+//   strip: body; i = i + factor * step; if !exit(i + (factor - 1) * step) goto strip
+//   rest: finish; if exit(i) goto end
+//   original loop
+//   end:
+void strip_mine_loop(ControlFlowGraph &cfg, const Loop &loop, const CountedLoop &counted, const long factor,
+                     const TACList &setup, const TACList &body, const TACList &finish)
+{
+    const auto preheader = cfg.insert_preheader(loop);
+    const auto original = preheader + 1;
+    if (original + 1 == cfg.blocks.size())
+    {
+        cfg.blocks.push_back(BasicBlock());
+    }
+    const auto end_label = cfg.ensure_label(original + 1);
+
+    const auto counter = counted.counter;
+    const auto last_offset = (factor - 1) * counted.step;
+    const auto keep_going = opposite_comparison(counted.exit_test);
+
+    const auto strip_label = make_tac_label();
+    const auto rest_label = make_tac_label();
+
+    BasicBlock check;
+    check.tacs = setup;
+    emit_test(check.tacs, keep_going, emit_offset(check.tacs, counter, last_offset), counted.bound, rest_label->get_result());
+
+    BasicBlock strip;
+    strip.tacs.push_back(strip_label);
+    strip.tacs.insert(strip.tacs.end(), body.begin(), body.end());
+    const auto next = emit_offset(strip.tacs, counter, factor * counted.step);
+    strip.tacs.push_back(make_tac(TAC_MOVE, counter, next, SymbolTableEntry()));
+    emit_test(strip.tacs, counted.exit_test, emit_offset(strip.tacs, counter, last_offset), counted.bound, strip_label->get_result());
+
+    BasicBlock rest;
+    rest.tacs.push_back(rest_label);
+    rest.tacs.insert(rest.tacs.end(), finish.begin(), finish.end());
+    emit_test(rest.tacs, keep_going, counter, counted.bound, end_label);
+
+    cfg.blocks.insert(cfg.blocks.begin() + static_cast<long>(original), {check, strip, rest});
+    cfg.connect_blocks();
+}
+
+void unroll_partially(ControlFlowGraph &cfg, const Loop &loop, const CountedLoop &counted, const long factor)
+{
+    TACList unrolled;
+    std::map<SymbolTableEntry, SymbolTableEntry> renamed;
+    const auto uses_next = reads_symbol(counted.body, counted.next);
+    for (long copy = 0; copy < factor; ++copy)
+    {
+        if (copy > 0)
+        {
+            renamed[counted.counter] = emit_offset(unrolled, counted.counter, copy * counted.step);
+        }
+        // The body may read the incremented counter, which the unrolled loop only computes at its end
+        if (uses_next)
+        {
+            renamed[counted.next] = emit_offset(unrolled, counted.counter, (copy + 1) * counted.step);
+        }
+        const auto body = copy_iteration(counted.body, renamed, copy + 1 == factor);
+        unrolled.insert(unrolled.end(), body.begin(), body.end());
+    }
+    strip_mine_loop(cfg, loop, counted, factor, TACList(), unrolled, TACList());
+}
+
+void unroll_loops(ControlFlowGraph &cfg, const unsigned factor, const std::set<SymbolTableEntry> &skipped)
+{
+    // Headers of the loops already handled, including the ones unrolling creates
+    std::set<SymbolTableEntry> done = skipped;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        auto uses = count_uses(cfg);
+        for (const auto &loop : cfg.find_loops())
+        {
+            const auto header = cfg.blocks[loop.header].get_label();
+            if (!header || done.count(header))
+            {
+                continue;
+            }
+            done.insert(header);
+            const auto counted = match_counted_loop(cfg, loop, uses);
+            if (!counted)
+            {
+                continue;
+            }
+
+            const auto iteration_size = counted->iteration.size() + 1;
+            const auto trips = trip_count(cfg, *counted);
+            if (trips && static_cast<size_t>(*trips) * iteration_size <= UNROLL_BUDGET)
+            {
+                unroll_completely(cfg, *counted, *trips);
+                changed = true;
+                break;
+            }
+
+            // The unrolled loop checks all its iterations at once, the counter must move towards the bound
+            const auto exit_test = counted->exit_test;
+            const auto increasing = counted->step > 0 && (exit_test == TAC_GE || exit_test == TAC_GT);
+            const auto decreasing = counted->step < 0 && (exit_test == TAC_LE || exit_test == TAC_LT);
+            const auto copies = std::min<size_t>(factor, UNROLL_BUDGET / iteration_size);
+            if ((!increasing && !decreasing) || copies < 2 || (trips && *trips < static_cast<long>(copies)))
+            {
+                continue;
+            }
+            unroll_partially(cfg, loop, *counted, static_cast<long>(copies));
+            changed = true;
+            break;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// unroll.hpp file made by Ian Kersz Amaral - 2025/1
+// Loop unrolling for single block loops counted by an integer with a constant step. Loops
+// with a small known trip count are replaced by copies of their body, others run the body
+// several times per test and finish the last iterations in the original loop.
+
+#include "cfg.hpp"
+
+#include <optional>
+
+typedef struct CountedLoop
+{
+    size_t block;
+    SymbolTableEntry counter;
+    // Temporary holding the counter plus the step, the body may read it after the increment
+    SymbolTableEntry next;
+    long step;
+    // Integer literal or a variable the loop does not change
+    SymbolTableEntry bound;
+    // The loop ends once this comparison of the incremented counter with the bound is true
+    TacType exit_test;
+    // TACs of one iteration, without the label, the loop test and the branch back
+    TACList iteration;
+    // Same as the iteration, without the increment of the counter
+    TACList body;
+} CountedLoop;
+
+TacType opposite_comparison(TacType type);
+
+// Same comparison with its operands swapped, a < b is b > a
+TacType mirrored_comparison(TacType type);
+
+std::map<SymbolTableEntry, size_t> count_uses(const ControlFlowGraph &cfg);
+
+bool reads_symbol(const TACList &tacs, const SymbolTableEntry &symbol);
+
+// Recognizes "LABEL L; ...; t = counter + step; ...; counter = t; c = test; IFZ L, c"
+std::optional<CountedLoop> match_counted_loop(const ControlFlowGraph &cfg, const Loop &loop, std::map<SymbolTableEntry, size_t> &uses);
+
+// True when no temporary defined in the loop is read after it, so the loop may leave other values in them
+bool keeps_temporaries_inside(const ControlFlowGraph &cfg, const CountedLoop &counted, std::map<SymbolTableEntry, size_t> &uses);
+
+// Number of times the body runs once the loop is entered, if it is small enough to count
+std::optional<long> trip_count(const ControlFlowGraph &cfg, const CountedLoop &counted);
+
+// Puts a loop running body, which does the work of factor iterations, before the original loop.
+// The setup TACs run once before it and the finish TACs once after it, the original loop runs
+// the iterations left over.
+void strip_mine_loop(ControlFlowGraph &cfg, const Loop &loop, const CountedLoop &counted, long factor,
+                     const TACList &setup, const TACList &body, const TACList &finish);
+
+// Loops whose header is in skipped are left alone
+void unroll_loops(ControlFlowGraph &cfg, unsigned factor, const std::set<SymbolTableEntry> &skipped);
@@ -0,0 +1,339 @@
+#include "value_numbering.hpp"
+
+// value_numbering.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include <tuple>
+#include <set>
+#include <algorithm>
+
+// Operation, result type, value numbers of the operands and the vector for loads
+typedef std::tuple<TacType, DataType, size_t, size_t, Symbol *> ExpressionKey;
+
+typedef struct ValueTable
+{
+    std::map<SymbolTableEntry, size_t> symbol_values;
+    std::map<ExpressionKey, size_t> expression_values;
+    // Symbols that were given a value number, they still hold it while symbol_values agrees
+    std::map<size_t, std::vector<SymbolTableEntry>> holders;
+} ValueTable;
+
+class ValueNumbering
+{
+private:
+    size_t next_value = 1;
+    const CallSummaries &summaries;
+    const std::string caller;
+
+    size_t fresh_value()
+    {
+        return next_value++;
+    }
+
+    size_t value_of(ValueTable &table, const SymbolTableEntry &symbol)
+    {
+        const auto found = table.symbol_values.find(symbol);
+        if (found != table.symbol_values.end())
+        {
+            return found->second;
+        }
+        // First time we see the symbol, its value is whatever it holds on entry
+        const auto value = fresh_value();
+        define(table, symbol, value);
+        return value;
+    }
+
+    void define(ValueTable &table, const SymbolTableEntry &symbol, const size_t value)
+    {
+        table.symbol_values[symbol] = value;
+        table.holders[value].push_back(symbol);
+    }
+
+    // Temporary of the given type that currently holds the value, if any
+    SymbolTableEntry leader(ValueTable &table, const size_t value, const DataType data_type)
+    {
+        const auto found = table.holders.find(value);
+        if (found == table.holders.end())
+        {
+            return nullptr;
+        }
+        for (const auto &holder : found->second)
+        {
+            if (holder->is_temporary() && holder->get_data_type() == data_type && table.symbol_values[holder] == value)
+            {
+                return holder;
+            }
+        }
+        return nullptr;
+    }
+
+    // Replaces temporaries by the oldest temporary holding the same value
+    SymbolTableEntry canonical(ValueTable &table, const SymbolTableEntry &symbol)
+    {
+        if (!symbol || !symbol->is_temporary())
+        {
+            return symbol;
+        }
+        const auto replacement = leader(table, value_of(table, symbol), symbol->get_data_type());
+        return replacement ? replacement : symbol;
+    }
+
+    // A null vector stands for a store through a pointer, which may write any vector
+    void forget_vector(ValueTable &table, const SymbolTableEntry &vector)
+    {
+        for (auto it = table.expression_values.begin(); it != table.expression_values.end();)
+        {
+            if (std::get<0>(it->first) == TAC_VECLOAD && (!vector || std::get<4>(it->first) == vector.get()))
+            {
+                it = table.expression_values.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // Calls may change any global, and in recursive functions even our temporaries.
+    // The summary of the callee tells which ones the others really change.
+    void forget_call_effects(ValueTable &table, const TACptr &call)
+    {
+        const auto summary = summaries.of_call(caller, call);
+        if (!summary)
+        {
+            table = ValueTable();
+            return;
+        }
+        for (const auto &written : summary->writes)
+        {
+            define(table, written, fresh_value());
+        }
+        if (summary->writes_any_vector)
+        {
+            forget_vector(table, nullptr);
+        }
+        for (const auto &vector : summary->written_vectors)
+        {
+            forget_vector(table, vector);
+        }
+    }
+
+    // Returns false if the TAC became useless and must be removed
+    bool number_tac(ValueTable &table, const TACptr &tac)
+    {
+        switch (tac->get_type())
+        {
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_LT:
+        case TAC_GT:
+        case TAC_LE:
+        case TAC_GE:
+        case TAC_EQ:
+        case TAC_DIF:
+        case TAC_AND:
+        case TAC_OR:
+        case TAC_NOT:
+        case TAC_VECLOAD:
+            {
+                const auto result = tac->get_result();
+                const auto is_load = tac->get_type() == TAC_VECLOAD;
+                if (!is_load)
+                {
+                    tac->set_first_operator(canonical(table, tac->get_first_operator()));
+                }
+                tac->set_second_operator(canonical(table, tac->get_second_operator()));
+
+                auto first_value = is_load ? 0 : value_of(table, tac->get_first_operator());
+                auto second_value = tac->get_second_operator() ? value_of(table, tac->get_second_operator()) : 0;
+                if (tac->is_commutative() && first_value > second_value)
+                {
+                    std::swap(first_value, second_value);
+                }
+                const auto vector = is_load ? tac->get_first_operator().get() : nullptr;
+                const ExpressionKey key{tac->get_type(), result->get_data_type(), first_value, second_value, vector};
+
+                const auto found = table.expression_values.find(key);
+                if (found == table.expression_values.end())
+                {
+                    const auto value = fresh_value();
+                    table.expression_values[key] = value;
+                    define(table, result, value);
+                    return true;
+                }
+
+                const auto holder = leader(table, found->second, result->get_data_type());
+                if (holder && holder != result)
+                {
+                    tac->set_type(TAC_MOVE);
+                    tac->set_first_operator(holder);
+                    tac->set_second_operator(nullptr);
+                }
+                define(table, result, found->second);
+                return true;
+            }
+        case TAC_ARG:
+            // The value goes to the callee, the parameter of the caller keeps its own
+            tac->set_first_operator(canonical(table, tac->get_first_operator()));
+            return true;
+        case TAC_MOVE:
+            {
+                const auto result = tac->get_result();
+                const auto source = canonical(table, tac->get_first_operator());
+                tac->set_first_operator(source);
+                if (result->get_data_type() != source->get_data_type())
+                {
+                    // Conversions between int and byte do not keep the value
+                    define(table, result, fresh_value());
+                    return true;
+                }
+                const auto value = value_of(table, source);
+                const auto current = table.symbol_values.find(result);
+                if (current != table.symbol_values.end() && current->second == value)
+                {
+                    return false; // Already holds the value
+                }
+                define(table, result, value);
+                return true;
+            }
+        case TAC_VECSTORE:
+            tac->set_first_operator(canonical(table, tac->get_first_operator()));
+            tac->set_second_operator(canonical(table, tac->get_second_operator()));
+            forget_vector(table, tac->get_result());
+            return true;
+        case TAC_PTRSTORE:
+            forget_vector(table, nullptr);
+            return true;
+        case TAC_CALL:
+            forget_call_effects(table, tac);
+            define(table, tac->get_result(), fresh_value());
+            return true;
+        case TAC_READ:
+            define(table, tac->get_result(), fresh_value());
+            return true;
+        case TAC_IFZ:
+            tac->set_first_operator(canonical(table, tac->get_first_operator()));
+            return true;
+        case TAC_RET:
+        case TAC_PRINT:
+            tac->set_result(canonical(table, tac->get_result()));
+            return true;
+        default:
+            {
+                // Anything else that writes a variable gives it an unknown value
+                const auto definition = tac->get_definition();
+                if (definition)
+                {
+                    define(table, definition, fresh_value());
+                }
+                return true;
+            }
+        }
+    }
+
+    // Invalidates what may change on the paths from the dominator to its child
+    void kill_between(ControlFlowGraph &cfg, ValueTable &table, const size_t dominator, const size_t block)
+    {
+        std::set<size_t> visited;
+        std::vector<size_t> stack;
+        for (const auto predecessor : cfg.blocks[block].predecessors)
+        {
+            if (predecessor != dominator)
+            {
+                stack.push_back(predecessor);
+            }
+        }
+        while (!stack.empty())
+        {
+            const auto current = stack.back();
+            stack.pop_back();
+            if (current == dominator || !cfg.is_reachable(current) || !visited.insert(current).second)
+            {
+                continue;
+            }
+            for (const auto predecessor : cfg.blocks[current].predecessors)
+            {
+                stack.push_back(predecessor);
+            }
+        }
+
+        for (const auto current : visited)
+        {
+            for (const auto &tac : cfg.blocks[current].tacs)
+            {
+                if (tac->get_type() == TAC_CALL)
+                {
+                    forget_call_effects(table, tac);
+                }
+                if (tac->get_type() == TAC_VECSTORE)
+                {
+                    forget_vector(table, tac->get_result());
+                }
+                if (tac->get_type() == TAC_PTRSTORE)
+                {
+                    forget_vector(table, nullptr);
+                }
+                const auto definition = tac->get_definition();
+                if (definition)
+                {
+                    table.symbol_values[definition] = fresh_value();
+                }
+            }
+        }
+    }
+
+public:
+    ValueNumbering(const CallSummaries &summaries, const std::string &caller) : summaries(summaries), caller(caller) {}
+
+    void number_block(ControlFlowGraph &cfg, const size_t block, ValueTable &table)
+    {
+        TACList kept;
+        for (const auto &tac : cfg.blocks[block].tacs)
+        {
+            if (number_tac(table, tac))
+            {
+                kept.push_back(tac);
+            }
+        }
+        cfg.blocks[block].tacs = kept;
+    }
+
+    void number_dominator_tree(ControlFlowGraph &cfg, const size_t block, ValueTable table)
+    {
+        number_block(cfg, block, table);
+        for (const auto child : cfg.dominator_children[block])
+        {
+            ValueTable child_table = table;
+            kill_between(cfg, child_table, block, child);
+            number_dominator_tree(cfg, child, child_table);
+        }
+    }
+};
+
+void local_value_numbering(ControlFlowGraph &cfg, const CallSummaries &summaries)
+{
+    ValueNumbering numbering(summaries, cfg.function_name());
+    for (size_t i = 0; i < cfg.blocks.size(); ++i)
+    {
+        ValueTable table;
+        numbering.number_block(cfg, i, table);
+    }
+}
+
+void global_value_numbering(ControlFlowGraph &cfg, const CallSummaries &summaries)
+{
+    ValueNumbering numbering(summaries, cfg.function_name());
+    numbering.number_dominator_tree(cfg, 0, ValueTable());
+
+    // Blocks the entry does not reach are still numbered locally
+    for (size_t i = 1; i < cfg.blocks.size(); ++i)
+    {
+        if (!cfg.is_reachable(i))
+        {
+            ValueTable table;
+            numbering.number_block(cfg, i, table);
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// value_numbering.hpp file made by Ian Kersz Amaral - 2025/1
+// Removes redundant expressions by giving equal values the same number.
+
+#include "cfg.hpp"
+#include "summaries.hpp"
+
+// Value numbering restarted at the beginning of every basic block
+void local_value_numbering(ControlFlowGraph &cfg, const CallSummaries &summaries);
+
+// Value numbering carried down the dominator tree, so blocks reuse values computed by their dominators
+void global_value_numbering(ControlFlowGraph &cfg, const CallSummaries &summaries);
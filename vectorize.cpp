@@ -0,0 +1,387 @@
+#include "vectorize.hpp"
+
+// vectorize.cpp file made by Ian Kersz Amaral - 2025/1
+
+#include "unroll.hpp"
+#include "induction.hpp"
+
+// What each TAC of the loop body becomes in the vector loop
+typedef struct VectorPlan
+{
+    // Iterations done by one run of the vector loop
+    long lanes;
+    // Temporaries holding the counter plus a constant, only used as vector indices
+    std::map<SymbolTableEntry, long> offsets;
+    // Temporaries that hold one element of a vector per lane
+    std::set<SymbolTableEntry> packed;
+    // Variables that sum, or keep the smallest or largest of, a value of every iteration, by
+    // the temporary holding their new value
+    std::map<SymbolTableEntry, SymbolTableEntry> reductions;
+} VectorPlan;
+
+DataType packed_type(const DataType element)
+{
+    switch (element)
+    {
+    case TYPE_INT: return TYPE_PACKED_INT;
+    case TYPE_REAL: return TYPE_PACKED_REAL;
+    case TYPE_CHAR: return TYPE_PACKED_CHAR;
+    default: return TYPE_INVALID;
+    }
+}
+
+// Elementwise operations with an instruction that keeps every lane the same as the scalar code
+bool has_packed_operation(const TacType type, const DataType element, const bool avx2)
+{
+    if (packed_type(element) == TYPE_INVALID)
+    {
+        return false;
+    }
+    switch (type)
+    {
+    case TAC_ADD:
+    case TAC_SUB:
+        return true;
+    case TAC_MUL:
+        // SSE2 can not multiply 32 bit lanes keeping the low half, that is pmulld from SSE4.1
+        return element == TYPE_REAL || (element == TYPE_INT && avx2);
+    case TAC_DIV:
+        return element == TYPE_REAL;
+    case TAC_MIN:
+    case TAC_MAX:
+        return element != TYPE_CHAR;
+    default:
+        return false;
+    }
+}
+
+// "t = s + x; s = t" where nothing else in the loop reads s, each lane keeps its own partial
+// result and they are combined after the vector loop. Reals only add up in another order with
+// fast math.
+bool is_reduction(const TACptr &operation, const TACptr &move, const SymbolTableEntry &counter,
+                  std::map<SymbolTableEntry, size_t> &uses, std::map<SymbolTableEntry, size_t> &loop_uses, const bool fast_math)
+{
+    const auto type = operation->get_type();
+    const auto result = operation->get_result();
+    const auto variable = move->get_result();
+    if (move->get_type() != TAC_MOVE || move->get_first_operator() != result || variable->is_temporary() || variable == counter
+        || !result->is_temporary() || uses[result] != 1 || loop_uses[variable] != 1)
+    {
+        return false;
+    }
+    const auto element = variable->get_data_type();
+    if (element != TYPE_INT && (element != TYPE_REAL || !fast_math))
+    {
+        return false;
+    }
+    const auto first = operation->get_first_operator();
+    const auto second = operation->get_second_operator();
+    switch (type)
+    {
+    case TAC_ADD:
+    case TAC_MIN:
+    case TAC_MAX:
+        return first == variable || second == variable;
+    case TAC_SUB:
+        return first == variable;
+    default:
+        return false;
+    }
+}
+
+// Checks that every TAC of the body has a packed form and that running the iterations of one
+// vector at once gives the same result. Vectors are globals of known size, so two accesses can
+// only overlap when they are to the same vector, and then their offsets tell how.
+std::optional<VectorPlan> plan_vectorization(const ControlFlowGraph &cfg, const CountedLoop &counted, std::map<SymbolTableEntry, size_t> &uses,
+                                             const std::map<SymbolTableEntry, long> &vector_sizes, const size_t vector_bytes, const bool avx2,
+                                             const bool fast_math)
+{
+    const auto &counter = counted.counter;
+    // The vector loop leaves other values in the temporaries, so nothing after the loop may read them
+    if (counted.step != 1 || (counted.exit_test != TAC_GE && counted.exit_test != TAC_GT) || !keeps_temporaries_inside(cfg, counted, uses))
+    {
+        return std::nullopt;
+    }
+
+    std::set<SymbolTableEntry> defined;
+    std::map<SymbolTableEntry, size_t> loop_uses;
+    for (const auto &tac : cfg.blocks[counted.block].tacs)
+    {
+        const auto definition = tac->get_definition();
+        if (definition)
+        {
+            defined.insert(definition);
+        }
+        for (const auto &use : tac->get_uses())
+        {
+            loop_uses[use]++;
+        }
+    }
+
+    VectorPlan plan{0, {{counter, 0}, {counted.next, counted.step}}, {}, {}};
+    int element_size = 0;
+    // A register holds as many lanes as it has elements, so every element must have the same size
+    const auto same_lanes = [&](const DataType element) {
+        if (element_size == 0)
+        {
+            element_size = get_data_type_size(element);
+        }
+        return get_data_type_size(element) == element_size;
+    };
+    const auto is_value = [&](const SymbolTableEntry &symbol, const DataType element) {
+        return symbol->get_data_type() == element && (plan.packed.count(symbol) || defined.count(symbol) == 0);
+    };
+
+    // Offsets from the counter each vector is stored at and loaded from
+    std::map<SymbolTableEntry, long> stores;
+    std::map<SymbolTableEntry, std::vector<long>> loads;
+    std::set<SymbolTableEntry> accessed;
+    const auto &body = counted.body;
+    for (size_t i = 0; i < body.size(); ++i)
+    {
+        const auto &tac = body[i];
+        const auto type = tac->get_type();
+        const auto result = tac->get_result();
+        const auto first = tac->get_first_operator();
+        const auto second = tac->get_second_operator();
+        if (type == TAC_ADD && result->is_temporary() && (first == counter || second == counter))
+        {
+            const auto offset = first == counter ? second : first;
+            if (!is_int_literal(offset) || std::stol(offset->get_text()) < 0)
+            {
+                return std::nullopt;
+            }
+            plan.offsets[result] = std::stol(offset->get_text());
+            continue;
+        }
+        if (type == TAC_MOVE && result->is_temporary() && plan.offsets.count(first))
+        {
+            plan.offsets[result] = plan.offsets.at(first);
+            continue;
+        }
+
+        if (type == TAC_VECLOAD || type == TAC_VECSTORE)
+        {
+            const auto vector = type == TAC_VECLOAD ? first : result;
+            const auto element = vector->get_data_type();
+            const auto offset = plan.offsets.find(second);
+            if (offset == plan.offsets.end() || packed_type(element) == TYPE_INVALID || !same_lanes(element))
+            {
+                return std::nullopt;
+            }
+            accessed.insert(vector);
+            if (type == TAC_VECLOAD)
+            {
+                // After a store, only the elements this iteration stored may be read again
+                const auto stored = stores.find(vector);
+                if (!result->is_temporary() || (stored != stores.end() && stored->second != offset->second))
+                {
+                    return std::nullopt;
+                }
+                loads[vector].push_back(offset->second);
+                plan.packed.insert(result);
+                continue;
+            }
+            // Every iteration stores one element, so all stores to a vector must agree on it
+            const auto stored = stores.emplace(vector, offset->second).first;
+            if (!is_value(first, element) || stored->second != offset->second)
+            {
+                return std::nullopt;
+            }
+            // Loads before the store must not read elements earlier iterations stored
+            for (const auto loaded : loads[vector])
+            {
+                if (loaded < offset->second)
+                {
+                    return std::nullopt;
+                }
+            }
+            continue;
+        }
+
+        if (i + 1 < body.size() && is_reduction(tac, body[i + 1], counter, uses, loop_uses, fast_math))
+        {
+            const auto variable = body[i + 1]->get_result();
+            const auto value = first == variable ? second : first;
+            if (!same_lanes(variable->get_data_type()) || !is_value(value, variable->get_data_type()))
+            {
+                return std::nullopt;
+            }
+            plan.reductions[variable] = result;
+            ++i;
+            continue;
+        }
+
+        // Comparisons give the 0 or 1 the reductions count with, reals only when NaNs do not matter,
+        // as the packed comparisons treat them differently from ucomiss
+        const auto is_comparison = tac->is_relational() && result->get_data_type() == TYPE_INT;
+        const auto element = is_comparison ? first->get_data_type() : result->get_data_type();
+        if (is_comparison && element != TYPE_INT && (element != TYPE_REAL || !fast_math))
+        {
+            return std::nullopt;
+        }
+        // Copies between temporaries just give the packed value another name
+        const auto is_copy = type == TAC_MOVE && packed_type(element) != TYPE_INVALID;
+        const auto is_operation = is_copy || is_comparison || has_packed_operation(type, element, avx2);
+        if (!result->is_temporary() || !is_operation || !same_lanes(element) || !is_value(first, element)
+            || (!is_copy && !is_value(second, element)))
+        {
+            return std::nullopt;
+        }
+        plan.packed.insert(result);
+    }
+    if (stores.empty() && plan.reductions.empty())
+    {
+        return std::nullopt;
+    }
+
+    // Vectors too small for one register are never worth it
+    plan.lanes = static_cast<long>(vector_bytes) / element_size;
+    for (const auto &vector : accessed)
+    {
+        const auto size = vector_sizes.find(vector);
+        if (size == vector_sizes.end() || size->second < plan.lanes)
+        {
+            return std::nullopt;
+        }
+    }
+    return plan;
+}
+
+void vectorize_loop(ControlFlowGraph &cfg, const Loop &loop, const CountedLoop &counted, const VectorPlan &plan)
+{
+    TACList setup;
+    // The indices only depend on the counter, computing them first keeps the packed code together
+    TACList indices;
+    TACList body;
+    // Combines the lanes of each reduction into its variable
+    TACList finish;
+    std::map<SymbolTableEntry, SymbolTableEntry> renamed;
+    const auto index = [&](const SymbolTableEntry &symbol) {
+        const auto found = renamed.find(symbol);
+        return found != renamed.end() ? found->second : symbol;
+    };
+    // Values the loop does not change are copied to every lane once, before it
+    const auto packed_value = [&](const SymbolTableEntry &symbol) {
+        const auto found = renamed.find(symbol);
+        if (found != renamed.end())
+        {
+            return found->second;
+        }
+        const auto broadcast = register_temp(packed_type(symbol->get_data_type()));
+        setup.push_back(make_tac(TAC_BROADCAST, broadcast, symbol, SymbolTableEntry()));
+        return renamed[symbol] = broadcast;
+    };
+
+    // The incremented counter only exists at the end of the vector loop, so it is computed again
+    if (reads_symbol(counted.body, counted.next))
+    {
+        const auto next = register_temp(TYPE_INT);
+        indices.push_back(make_tac(TAC_ADD, next, counted.counter, register_int_literal(counted.step)));
+        renamed[counted.next] = next;
+    }
+
+    for (size_t i = 0; i < counted.body.size(); ++i)
+    {
+        const auto &tac = counted.body[i];
+        const auto type = tac->get_type();
+        const auto result = tac->get_result();
+        const auto first = tac->get_first_operator();
+        const auto second = tac->get_second_operator();
+        const auto variable = i + 1 < counted.body.size() ? counted.body[i + 1]->get_result() : SymbolTableEntry();
+        const auto reduction = plan.reductions.find(variable);
+        if (reduction != plan.reductions.end() && reduction->second == result)
+        {
+            // Sums start every lane at zero, minimums and maximums at the value the variable already has
+            const auto element = variable->get_data_type();
+            const auto is_sum = type == TAC_ADD || type == TAC_SUB;
+            const auto zero = element == TYPE_REAL ? register_symbol(SYMBOL_REAL, "0/1", 0) : register_int_literal(0);
+            const auto accumulator = register_temp(packed_type(element));
+            setup.push_back(make_tac(TAC_BROADCAST, accumulator, is_sum ? zero : variable, SymbolTableEntry()));
+            const auto value = packed_value(first == variable ? second : first);
+            body.push_back(first == variable ? make_tac(type, accumulator, accumulator, value) : make_tac(type, accumulator, value, accumulator));
+
+            // The lanes of a subtraction hold what was taken away, so they are added to it too
+            for (long lane = 0; lane < plan.lanes; ++lane)
+            {
+                const auto part = register_temp(element);
+                finish.push_back(make_tac(TAC_EXTRACT, part, accumulator, register_int_literal(lane)));
+                const auto combined = register_temp(element);
+                finish.push_back(make_tac(is_sum ? TAC_ADD : type, combined, variable, part));
+                finish.push_back(make_tac(TAC_MOVE, variable, combined, SymbolTableEntry()));
+            }
+            ++i;
+        }
+        else if (plan.offsets.count(result) && type == TAC_MOVE)
+        {
+            renamed[result] = index(first);
+        }
+        else if (plan.offsets.count(result))
+        {
+            const auto offset = renamed[result] = register_temp(TYPE_INT);
+            indices.push_back(make_tac(TAC_ADD, offset, first, second));
+        }
+        else if (type == TAC_VECLOAD)
+        {
+            const auto value = renamed[result] = register_temp(packed_type(first->get_data_type()));
+            body.push_back(make_tac(TAC_PACKED_LOAD, value, first, index(second)));
+        }
+        else if (type == TAC_VECSTORE)
+        {
+            body.push_back(make_tac(TAC_PACKED_STORE, result, packed_value(first), index(second)));
+        }
+        else if (type == TAC_MOVE)
+        {
+            renamed[result] = packed_value(first);
+        }
+        else
+        {
+            const auto first_value = packed_value(first);
+            const auto second_value = packed_value(second);
+            const auto value = renamed[result] = register_temp(packed_type(result->get_data_type()));
+            body.push_back(make_tac(type, value, first_value, second_value));
+        }
+    }
+    indices.insert(indices.end(), body.begin(), body.end());
+    strip_mine_loop(cfg, loop, counted, plan.lanes, setup, indices, finish);
+}
+
+std::set<SymbolTableEntry> vectorize_loops(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &vector_sizes, const bool avx2,
+                                           const bool fast_math)
+{
+    const size_t vector_bytes = avx2 ? 32 : 16;
+    std::set<SymbolTableEntry> epilogues;
+    // Headers of the loops already looked at, the vector loops are never counted loops themselves
+    std::set<SymbolTableEntry> done;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        auto uses = count_uses(cfg);
+        for (const auto &loop : cfg.find_loops())
+        {
+            const auto header = cfg.blocks[loop.header].get_label();
+            if (!header || done.count(header))
+            {
+                continue;
+            }
+            done.insert(header);
+            const auto counted = match_counted_loop(cfg, loop, uses);
+            const auto plan = counted ? plan_vectorization(cfg, *counted, uses, vector_sizes, vector_bytes, avx2, fast_math) : std::nullopt;
+            if (!plan)
+            {
+                continue;
+            }
+            const auto trips = trip_count(cfg, *counted);
+            if (trips && *trips < plan->lanes)
+            {
+                continue;
+            }
+            vectorize_loop(cfg, loop, *counted, *plan);
+            epilogues.insert(header);
+            changed = true;
+            break;
+        }
+    }
+    return epilogues;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// vectorize.hpp file made by Ian Kersz Amaral - 2025/1
+// Loop vectorization: counted loops doing elementwise arithmetic on vectors, or summing,
+// counting or keeping the smallest or largest of their elements, run several iterations at
+// once with SSE2 (16 bytes) or AVX2 (32 bytes) instructions, and the original loop finishes
+// the iterations that do not fill a whole register. Real sums are only reordered like that
+// with fast math.
+
+#include "cfg.hpp"
+
+// Returns the headers of the original loops left to run the last iterations
+std::set<SymbolTableEntry> vectorize_loops(ControlFlowGraph &cfg, const std::map<SymbolTableEntry, long> &vector_sizes, bool avx2, bool fast_math);